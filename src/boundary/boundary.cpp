@@ -2,242 +2,280 @@
 
 namespace boundaries
 {
-  void applyBoundaryConditions(const int boundaryLeft, const int boundaryRight,
-                               const int boundaryTop, const int boundaryBottom,
-                               const int boundaryFront, const int boundaryBack,
-                               grid &prim
-                              )
+  copyDescriptors::copyDescriptors(const grid &prim)
   {
-    int numGhost = prim.numGhost;
-    
-    /* Domain of X1 boundaries */
-    af::seq domainX1LeftBoundary(0, numGhost-1);
-    af::seq domainX1RightBoundary(prim.N1Local+numGhost, 
-                                  prim.N1Local+2*numGhost-1
-                                 );
-    
-    /* Domain of X2 boundaries */
-    af::seq domainX2BottomBoundary(0, numGhost-1);
-    af::seq domainX2TopBoundary(prim.N2Local+numGhost,
-                                prim.N2Local+2*numGhost-1
-                               );
-
-    /* Domain of X3 boundaries */
-    af::seq domainX3BackBoundary(0, numGhost-1);
-    af::seq domainX3FrontBoundary(prim.N3Local+numGhost,
-                                  prim.N3Local+2*numGhost-1
-                                 );
-
-
-    /* X1 boundary conditions */
-    if (prim.iLocalStart == 0)
-    {
-      switch (boundaryLeft)
-      {
-        case (boundaries::MIRROR):
-        {
-          af::seq domainX1EdgeReversed(2*numGhost-1, numGhost, -1);
+    N1Total = prim.N1Total;
+    N2Total = prim.N2Total;
+    N3Total = prim.N3Total;
+    numVars = prim.numVars;
 
-          for (int var=0; var<prim.numVars; var++)
-          {
-            prim.vars[var](domainX1LeftBoundary, span, span) =
-              prim.vars[var](domainX1EdgeReversed, span, span);
-          }
+    isFinalized = false;
+  }
 
-          break;
-        }
+  dim_t copyDescriptors::index(const int i, const int j, const int k,
+                               const int var
+                              ) const
+  {
+    return i + N1Total*(j + N2Total*(k + (dim_t)N3Total*var));
+  }
 
-        case (boundaries::OUTFLOW):
-        {
-          for (int var=0; var<prim.numVars; var++)
-          {
-            gfor (af::seq i, 0, numGhost-1)
-            {
-              prim.vars[var](i, span, span) =
-                prim.vars[var](numGhost, span, span);
-            }
-          }
+  void copyDescriptors::addCopy(const dim_t dest, const dim_t source,
+                                const double weight
+                               )
+  {
+    std::pair<dim_t, double> copy(source, weight);
 
-          break;
-        }
-      }
+    /* Follow the source back if it was set by an earlier copy */
+    std::map<dim_t, std::pair<dim_t, double> >::iterator it
+      = copies.find(source);
+    if (it != copies.end())
+    {
+      copy.first   = it->second.first;
+      copy.second *= it->second.second;
     }
 
-    if (prim.iLocalEnd == prim.N1)
+    if (copy.first == dest && copy.second == 1.)
     {
-      switch (boundaryRight)
-      {
-        case (boundaries::MIRROR):
-        {
-          af::seq domainX1EdgeReversed(prim.N1Local+numGhost-1, prim.N1Local, -1);
-
-          for (int var=0; var<prim.numVars; var++)
-          {
-            prim.vars[var](domainX1RightBoundary, span, span) =
-              prim.vars[var](domainX1EdgeReversed, span, span);
-          }
-
-          break;
-        }
+      copies.erase(dest);
+    }
+    else
+    {
+      copies[dest] = copy;
+    }
+    isFinalized = false;
+  }
+
+  void copyDescriptors::addLayerCopy(const int dir,
+                                     const int destLayer,
+                                     const int sourceLayer,
+                                     const int var,
+                                     const double weight,
+                                     const double *scale
+                                    )
+  {
+    /* (a, b) run over the two directions other than dir */
+    int NA, NB;
+    switch (dir)
+    {
+      case directions::X1:
+        NA = N2Total; NB = N3Total;
+        break;
 
-        case (boundaries::OUTFLOW):
-        {
-          for (int var=0; var<prim.numVars; var++)
-          {
-            gfor (af::seq i, prim.N1Local+numGhost, 
-                             prim.N1Local+2*numGhost-1
-                 )
-            {
-              prim.vars[var](i, span, span) =
-                prim.vars[var](prim.N1Local+numGhost-1, span, span);
-            }
-          }
+      case directions::X2:
+        NA = N1Total; NB = N3Total;
+        break;
 
-          break;
-        }
-      }
+      case directions::X3:
+        NA = N1Total; NB = N2Total;
+        break;
     }
 
-    /* X2 boundary conditions */
-    if (prim.jLocalStart == 0 && prim.dim >= 2)
+    for (int b=0; b < NB; b++)
     {
-      switch (boundaryBottom)
+      for (int a=0; a < NA; a++)
       {
-        case (boundaries::MIRROR):
+        dim_t dest, source;
+        switch (dir)
         {
-          af::seq domainX2EdgeReversed(2*numGhost-1, numGhost, -1);
-
-          for (int var=0; var<prim.numVars; var++)
-          {
-            prim.vars[var](span, domainX2BottomBoundary, span)
-              = prim.vars[var](span, domainX2EdgeReversed, span);
-          }
-
-          break;
+          case directions::X1:
+            dest   = index(destLayer,   a, b, var);
+            source = index(sourceLayer, a, b, var);
+            break;
+
+          case directions::X2:
+            dest   = index(a, destLayer,   b, var);
+            source = index(a, sourceLayer, b, var);
+            break;
+
+          case directions::X3:
+            dest   = index(a, b, destLayer,   var);
+            source = index(a, b, sourceLayer, var);
+            break;
         }
 
-        case (boundaries::OUTFLOW):
+        double zoneWeight = weight;
+        if (scale != NULL)
         {
-          for (int var=0; var<prim.numVars; var++)
-          {
-            gfor (af::seq j, 0, numGhost-1)
-            {
-              prim.vars[var](span, j, span)
-                = prim.vars[var](span, numGhost, span);
-            }
-          }
-
-          break;
+          const dim_t zonesPerVar = (dim_t)N1Total*N2Total*N3Total;
+          zoneWeight *=   scale[dest   - zonesPerVar*var]
+                        / scale[source - zonesPerVar*var];
         }
+
+        addCopy(dest, source, zoneWeight);
       }
     }
+  }
 
-    if (prim.jLocalEnd == prim.N2 && prim.dim >= 2)
+  void copyDescriptors::finalize()
+  {
+    if (isFinalized)
     {
-      switch (boundaryTop)
-      {
-        case (boundaries::MIRROR):
-        {
-          af::seq domainX2EdgeReversed(prim.N2Local+numGhost-1, prim.N2Local, -1);
-
-          for (int var=0; var<prim.numVars; var++)
-          {
-            prim.vars[var](span, domainX2TopBoundary, span) =
-              prim.vars[var](span, domainX2EdgeReversed, span);
-          
-          }
-
-          break;
-        }
+      return;
+    }
 
-        case (boundaries::OUTFLOW):
-        {
-          for (int var=0; var<prim.numVars; var++)
-          {
-            gfor (af::seq j, prim.N2Local+numGhost, 
-                             prim.N2Local+2*numGhost-1
-                 )
-            {
-              prim.vars[var](span, j, span) =
-                prim.vars[var](span, prim.N2Local+numGhost-1, span);
-            }
-          }
+    /* Host lists of the copies of every (destVar, sourceVar) pair */
+    struct hostCopies
+    {
+      std::vector<unsigned int> dest, source;
+      std::vector<double> weights;
+    };
+    std::map<std::pair<int, int>, hostCopies> hostPairs;
+
+    const dim_t zonesPerVar = (dim_t)N1Total*N2Total*N3Total;
+    std::map<dim_t, std::pair<dim_t, double> >::iterator it;
+    for (it = copies.begin(); it != copies.end(); it++)
+    {
+      const int destVar   = it->first/zonesPerVar;
+      const int sourceVar = it->second.first/zonesPerVar;
 
-          break;
-        }
-      }
+      hostCopies &pair = hostPairs[std::make_pair(destVar, sourceVar)];
+      pair.dest.push_back(it->first        - zonesPerVar*destVar);
+      pair.source.push_back(it->second.first - zonesPerVar*sourceVar);
+      pair.weights.push_back(it->second.second);
     }
 
-    /* X3 boundary conditions */
-    if (prim.kLocalStart == 0 && prim.dim >= 3)
+    std::map<std::pair<int, int>, hostCopies>::iterator pairIt;
+    for (pairIt = hostPairs.begin(); pairIt != hostPairs.end(); pairIt++)
     {
-      switch (boundaryBack)
-      {
-        case (boundaries::MIRROR):
-        {
-          af::seq domainX3EdgeReversed(2*numGhost-1, numGhost, -1);
+      const hostCopies &host = pairIt->second;
+      const int numCopies = host.dest.size();
+
+      varCopies pair;
+      pair.destVar       = pairIt->first.first;
+      pair.sourceVar     = pairIt->first.second;
+      pair.destIndices   = array(numCopies, &host.dest[0]);
+      pair.sourceIndices = array(numCopies, &host.source[0]);
+      pair.weights       = array(numCopies, &host.weights[0]);
+      varPairs.push_back(pair);
+    }
 
-          for (int var=0; var<prim.numVars; var++)
-          {
-            prim.vars[var](span, span, domainX3BackBoundary)
-              = prim.vars[var](span, span, domainX3EdgeReversed);
-          }
+    copies.clear();
+    isFinalized = true;
+  }
 
-          break;
-        }
+  bool copyDescriptors::empty() const
+  {
+    if (!isFinalized)
+    {
+      return copies.empty();
+    }
 
-        case (boundaries::OUTFLOW):
-        {
-          for (int var=0; var<prim.numVars; var++)
-          {
-            gfor (af::seq k, 0, numGhost-1)
-            {
-              prim.vars[var](span, span, k)
-                = prim.vars[var](span, span, numGhost);
-            }
-          }
+    dim_t numCopies = 0;
+    for (unsigned int n=0; n < varPairs.size(); n++)
+    {
+      numCopies += varPairs[n].destIndices.elements();
+    }
+    return (numCopies == 0);
+  }
 
-          break;
-        }
-      }
+  void copyDescriptors::apply(grid &prim)
+  {
+    if (!isFinalized)
+    {
+      finalize();
+    }
+    const int numPairs = varPairs.size();
+    if (numPairs == 0)
+    {
+      return;
     }
 
-    if (prim.kLocalEnd == prim.N3 && prim.dim >= 3)
+    /* All the sources are gathered before anything is written, see the
+     * class description. vars[var](indices) indexes the zones of var
+     * linearly, in the order of index() */
+    std::vector<array> values(numPairs);
+    for (int n=0; n < numPairs; n++)
     {
-      switch (boundaryFront)
+      values[n] =   prim.vars[varPairs[n].sourceVar](varPairs[n].sourceIndices)
+                  * varPairs[n].weights;
+      values[n].eval();
+    }
+    for (int n=0; n < numPairs; n++)
+    {
+      prim.vars[varPairs[n].destVar](varPairs[n].destIndices) = values[n];
+    }
+  }
+
+  void addBoundaryCopies(const int boundaryLeft, const int boundaryRight,
+                         const int boundaryTop, const int boundaryBottom,
+                         const int boundaryFront, const int boundaryBack,
+                         const grid &prim,
+                         copyDescriptors &copies
+                        )
+  {
+    const int numGhost = prim.numGhost;
+
+    /* Boundary types and whether this rank owns the face, in the order
+     * left, right, bottom, top, back, front */
+    const int boundaryType[] = {boundaryLeft,   boundaryRight,
+                                boundaryBottom, boundaryTop,
+                                boundaryBack,   boundaryFront
+                               };
+    const bool ownsFace[] = {prim.iLocalStart == 0,
+                             prim.iLocalEnd == prim.N1,
+                             prim.jLocalStart == 0 && prim.dim >= 2,
+                             prim.jLocalEnd == prim.N2 && prim.dim >= 2,
+                             prim.kLocalStart == 0 && prim.dim >= 3,
+                             prim.kLocalEnd == prim.N3 && prim.dim >= 3
+                            };
+    const int NLocal[] = {prim.N1Local, prim.N2Local, prim.N3Local};
+
+    for (int face=0; face < 6; face++)
+    {
+      if (!ownsFace[face])
       {
-        case (boundaries::MIRROR):
-        {
-          af::seq domainX3EdgeReversed(prim.N3Local+numGhost-1, prim.N3Local, -1);
-
-          for (int var=0; var<prim.numVars; var++)
-          {
-            prim.vars[var](span, span, domainX3FrontBoundary) =
-              prim.vars[var](span, span, domainX3EdgeReversed);
-          
-          }
+        continue;
+      }
+      const int dir   = face/2;
+      const bool left = (face%2 == 0);
 
-          break;
+      for (int n=0; n < numGhost; n++)
+      {
+        /* n'th ghost zone away from the domain and the n'th zone in */
+        int ghost, interior, edge;
+        if (left)
+        {
+          ghost    = numGhost-1-n;
+          interior = numGhost+n;
+          edge     = numGhost;
+        }
+        else
+        {
+          ghost    = NLocal[dir]+numGhost+n;
+          interior = NLocal[dir]+numGhost-1-n;
+          edge     = NLocal[dir]+numGhost-1;
         }
 
-        case (boundaries::OUTFLOW):
+        for (int var=0; var < prim.numVars; var++)
         {
-          for (int var=0; var<prim.numVars; var++)
+          switch (boundaryType[face])
           {
-            gfor (af::seq k, prim.N3Local+numGhost, 
-                             prim.N3Local+2*numGhost-1
-                 )
-            {
-              prim.vars[var](span, span, k) =
-                prim.vars[var](span, span, prim.N3Local+numGhost-1);
-            }
-          }
+            case (boundaries::MIRROR):
+              copies.addLayerCopy(dir, ghost, interior, var, 1.);
+              break;
 
-          break;
+            case (boundaries::OUTFLOW):
+              copies.addLayerCopy(dir, ghost, edge, var, 1.);
+              break;
+          }
         }
       }
     }
+  }
 
+  void applyBoundaryConditions(const int boundaryLeft, const int boundaryRight,
+                               const int boundaryTop, const int boundaryBottom,
+                               const int boundaryFront, const int boundaryBack,
+                               grid &prim
+                              )
+  {
+    copyDescriptors copies(prim);
+    addBoundaryCopies(boundaryLeft, boundaryRight,
+                      boundaryTop,  boundaryBottom,
+                      boundaryFront, boundaryBack,
+                      prim, copies
+                     );
+    copies.apply(prim);
   } /* End of applyBoundaryConditions() */
 
 } /* namespace boundaries */
@@ -1,11 +1,81 @@
 #ifndef GRIM_BOUNDARY_H_
 #define GRIM_BOUNDARY_H_
 
+#include <map>
+#include <vector>
+#include <utility>
 #include "../params.hpp"
 #include "../grid/grid.hpp"
 
 namespace boundaries
 {
+  /* Boundary conditions written as a list of copies between zones,
+   *
+   *   dest = weight * source,
+   *
+   * over every variable of a grid at once. The copies are added in the order
+   * in which they would be done one after the other; a copy whose source was
+   * itself set by an earlier copy is followed back to the original zone, so
+   * that apply() gathers every source before it writes any destination,
+   * with the same result as the sequential copies. The gathers and scatters
+   * index grid::vars[] in place, one pair of variables at a time, so the
+   * variables that have no copies are not touched.
+   * Build once and apply every time step: all the copies are added before
+   * the first apply(), as finalize() moves them to the device and drops the
+   * host list. */
+  class copyDescriptors
+  {
+    std::map<dim_t, std::pair<dim_t, double> > copies;
+
+    /* Copies into destVar from sourceVar, indices within one variable */
+    struct varCopies
+    {
+      int destVar, sourceVar;
+      array destIndices, sourceIndices, weights;
+    };
+    std::vector<varCopies> varPairs;
+    bool isFinalized;
+
+    public:
+      int N1Total, N2Total, N3Total, numVars;
+
+      copyDescriptors(const grid &prim);
+
+      /* Key of zone (i, j, k) of var: its linear index into vars[var],
+       * offset by var grids. finalize() splits it back into the variable
+       * and the index within vars[var] */
+      dim_t index(const int i, const int j, const int k, const int var) const;
+
+      void addCopy(const dim_t dest, const dim_t source, const double weight);
+
+      /* Copies the whole layer sourceLayer to destLayer along dir, for one
+       * variable. With scale (a host array of one grid, for ex a metric
+       * component) the weight of every zone is multiplied by
+       * scale[dest]/scale[source] */
+      void addLayerCopy(const int dir,
+                        const int destLayer, const int sourceLayer,
+                        const int var,
+                        const double weight,
+                        const double *scale = NULL
+                       );
+
+      /* Moves the copies to the device. Called by apply() if needed */
+      void finalize();
+
+      bool empty() const;
+
+      void apply(grid &prim);
+  };
+
+  /* MIRROR and OUTFLOW copies on the faces owned by this rank, in the order
+   * X1, X2, X3 */
+  void addBoundaryCopies(const int boundaryLeft, const int boundaryRight,
+                         const int boundaryTop, const int boundaryBottom,
+                         const int boundaryFront, const int boundaryBack,
+                         const grid &prim,
+                         copyDescriptors &copies
+                        );
+
   void applyBoundaryConditions(const int boundaryLeft, const int boundaryRight,
                                const int boundaryTop, const int boundaryBottom,
                                const int boundaryFront, const int boundaryBack,
@@ -1,10 +1,87 @@
 #include "geometry.hpp"
 #include "CoordinateChangeFunctionsArray.hpp"
+#include "../grid/stencil.hpp"
+#include <cstring>
+#include <cstddef>
+#include <cstdio>
+#include <fstream>
+
+namespace
+{
+  const char MAGIC[8] = {'G', 'R', 'I', 'M', 'G', 'E', 'O', '1'};
+
+  /* Everything the metric and the connection depend on. The coordinates
+   * enter through a hash of XCoords, which also covers the location of the
+   * points and the decomposition */
+  struct geometryCacheHeader
+  {
+    char magic[8];
+    int metric, dim, numGhost;
+    int N1, N2, N3;
+    int N1Total, N2Total, N3Total;
+    int DerefineThetaHorizon, DoCylindrify;
+    double blackHoleSpin, hSlope, gammaEps;
+    double X1Start, X1cyl, X2cyl;
+    unsigned long long int XCoordsHash;
+
+    /* Not part of the key */
+    int hasConnection;
+  };
+
+  geometryCacheHeader cacheHeaderOf(const int metric, const int dim,
+                                    const int numGhost,
+                                    const int N1, const int N2, const int N3,
+                                    const double blackHoleSpin,
+                                    const double hSlope,
+                                    const double gammaEps,
+                                    const array XCoords[3]
+                                   )
+  {
+    geometryCacheHeader header;
+    memset(&header, 0, sizeof(geometryCacheHeader));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+
+    header.metric   = metric;
+    header.dim      = dim;
+    header.numGhost = numGhost;
+    header.N1       = N1;
+    header.N2       = N2;
+    header.N3       = N3;
+    header.N1Total  = XCoords[0].dims(0);
+    header.N2Total  = XCoords[0].dims(1);
+    header.N3Total  = XCoords[0].dims(2);
+    header.DerefineThetaHorizon = params::DerefineThetaHorizon;
+    header.DoCylindrify         = params::DoCylindrify;
+    header.blackHoleSpin = blackHoleSpin;
+    header.hSlope        = hSlope;
+    header.gammaEps      = gammaEps;
+    header.X1Start       = params::X1Start;
+    header.X1cyl         = params::X1cyl;
+    header.X2cyl         = params::X2cyl;
+
+    /* FNV-1a */
+    unsigned long long int hash = 14695981039346656037ULL;
+    for (int d=0; d<3; d++)
+    {
+      std::vector<double> coords(XCoords[d].elements());
+      XCoords[d].host(&coords[0]);
+      const unsigned char *bytes = (const unsigned char *)&coords[0];
+      for (size_t n=0; n<coords.size()*sizeof(double); n++)
+      {
+        hash = (hash ^ bytes[n])*1099511628211ULL;
+      }
+    }
+    header.XCoordsHash = hash;
+
+    return header;
+  }
+}
 
 geometry::geometry(const int metric,
                    const double blackHoleSpin,
                    const double hSlope,
-                   const coordinatesGrid &XCoordsGrid
+                   const coordinatesGrid &XCoordsGrid,
+                   const std::string cacheFileBase
                   )
 {
   /* Differencing parameter for computing connections */
@@ -25,29 +102,44 @@ geometry::geometry(const int metric,
 
   XCoordsToxCoords(XCoords,xCoords);
 
-  /* Allocate space */
-  zero       = 0.*XCoords[0];
-  g          = zero;
-  array gDet = zero;
-  for (int mu=0; mu<NDIM; mu++)
+  cacheFile = "";
+  if (!cacheFileBase.empty() && metric != metrics::MINKOWSKI)
   {
-    for (int nu=0; nu<NDIM; nu++)
+    int rank;
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), ".rank%05d.bin", rank);
+    cacheFile = cacheFileBase + suffix;
+  }
+
+  zero = 0.*XCoords[0];
+  if (!readCache())
+  {
+    /* Allocate space */
+    g          = zero;
+    array gDet = zero;
+    for (int mu=0; mu<NDIM; mu++)
     {
-      gCov[mu][nu] = zero;
-      gCon[mu][nu] = zero;
-      dxdX[mu][nu] = zero;
-      dXdx[mu][nu] = zero;
+      for (int nu=0; nu<NDIM; nu++)
+      {
+        gCov[mu][nu] = zero;
+        gCon[mu][nu] = zero;
+        dxdX[mu][nu] = zero;
+        dXdx[mu][nu] = zero;
+      }
     }
-  }
   
-  setgCovInXCoords(XCoords, gCov);
-  setgDetAndgConFromgCov(gCov, gDet, gCon);
-  computeTransformationMatrices();
+    setgCovInXCoords(XCoords, gCov);
+    setgDetAndgConFromgCov(gCov, gDet, gCon);
+    computeTransformationMatrices();
 
-  g = af::sqrt(-gDet);
-  alpha = 1./af::sqrt(-gCon[0][0]);
-  g.eval();
-  alpha.eval();
+    g = af::sqrt(-gDet);
+    alpha = 1./af::sqrt(-gCon[0][0]);
+    g.eval();
+    alpha.eval();
+
+    writeCache();
+  }
 
   setgCovGrid();
   setgConGrid();
@@ -58,8 +150,167 @@ geometry::geometry(const int metric,
   af::sync();
 }
 
+/* Empty geometry, filled by stackFaces(). The host grids used by the Python
+ * interface are not created. */
+geometry::geometry()
+{
+  gCovGrid = gConGrid = gGrid = alphaGrid = NULL;
+  gammaUpDownDownGrid = xCoordsGrid = NULL;
+}
+
+/* Metric of two sets of points stacked along the 4th array dimension:
+ * [..., 0] is first and [..., 1] is second. Used to evaluate the fluid
+ * element at both states of the faces in one pass, so only what it reads
+ * there is joined: alpha, g, gCov, gCon[0][mu] and the diagonal of gCon (for
+ * the char speeds), plus the coordinates when the EMHD closure needs them.
+ * gCov and gCon are symmetric, so gCov[nu][mu] and gCon[mu][0] share the
+ * arrays of gCov[mu][nu] and gCon[0][mu]. The other components are left
+ * empty. */
+void geometry::stackFaces(const geometry &first, const geometry &second)
+{
+  GAMMA_EPS = first.GAMMA_EPS;
+  N1        = first.N1;
+  N2        = first.N2;
+  N3        = first.N3;
+  dim       = first.dim;
+  numGhost  = first.numGhost;
+
+  metric        = first.metric;
+  blackHoleSpin = first.blackHoleSpin;
+  hSlope        = first.hSlope;
+
+  alpha = af::join(3, first.alpha, second.alpha);
+  g     = af::join(3, first.g,     second.g);
+
+  for (int mu=0; mu<NDIM; mu++)
+  {
+    for (int nu=mu; nu<NDIM; nu++)
+    {
+      gCov[mu][nu] = af::join(3, first.gCov[mu][nu], second.gCov[mu][nu]);
+      gCov[nu][mu] = gCov[mu][nu];
+    }
+    if (mu == 0)
+    {
+      for (int nu=0; nu<NDIM; nu++)
+      {
+        gCon[0][nu] = af::join(3, first.gCon[0][nu], second.gCon[0][nu]);
+        gCon[nu][0] = gCon[0][nu];
+      }
+    }
+    else
+    {
+      gCon[mu][mu] = af::join(3, first.gCon[mu][mu], second.gCon[mu][mu]);
+    }
+  }
+
+  if (params::conduction || params::viscosity)
+  {
+    for (int d=0; d<3; d++)
+    {
+      XCoords[d] = af::join(3, first.XCoords[d], second.XCoords[d]);
+      xCoords[d] = af::join(3, first.xCoords[d], second.xCoords[d]);
+    }
+  }
+}
+
+/* Replaces the components joined by stackFaces() with views of the slab
+ * [..., face] of faces, which then holds the only copy of them */
+void geometry::viewFace(const geometry &faces, const int face)
+{
+  alpha = faces.alpha(span, span, span, face);
+  g     = faces.g(span, span, span, face);
+
+  for (int mu=0; mu<NDIM; mu++)
+  {
+    for (int nu=mu; nu<NDIM; nu++)
+    {
+      gCov[mu][nu] = faces.gCov[mu][nu](span, span, span, face);
+      gCov[nu][mu] = gCov[mu][nu];
+    }
+    if (mu == 0)
+    {
+      for (int nu=0; nu<NDIM; nu++)
+      {
+        gCon[0][nu] = faces.gCon[0][nu](span, span, span, face);
+        gCon[nu][0] = gCon[0][nu];
+      }
+    }
+    else
+    {
+      gCon[mu][mu] = faces.gCon[mu][mu](span, span, span, face);
+    }
+  }
+
+  if (params::conduction || params::viscosity)
+  {
+    for (int d=0; d<3; d++)
+    {
+      XCoords[d] = faces.XCoords[d](span, span, span, face);
+      xCoords[d] = faces.xCoords[d](span, span, span, face);
+    }
+  }
+}
+
+/* The components of faces, joined by stackFaces(), restricted to the zones
+ * first <= n <= last along dir. N1, N2, N3 are those of faces: the views are
+ * not a full grid of their own */
+void geometry::viewRows(const geometry &faces, const int dir,
+                        const int first, const int last
+                       )
+{
+  GAMMA_EPS = faces.GAMMA_EPS;
+  N1        = faces.N1;
+  N2        = faces.N2;
+  N3        = faces.N3;
+  dim       = faces.dim;
+  numGhost  = faces.numGhost;
+
+  metric        = faces.metric;
+  blackHoleSpin = faces.blackHoleSpin;
+  hSlope        = faces.hSlope;
+
+  alpha = stencil::rows(faces.alpha, dir, first, last);
+  g     = stencil::rows(faces.g,     dir, first, last);
+
+  for (int mu=0; mu<NDIM; mu++)
+  {
+    for (int nu=mu; nu<NDIM; nu++)
+    {
+      gCov[mu][nu] = stencil::rows(faces.gCov[mu][nu], dir, first, last);
+      gCov[nu][mu] = gCov[mu][nu];
+    }
+    if (mu == 0)
+    {
+      for (int nu=0; nu<NDIM; nu++)
+      {
+        gCon[0][nu] = stencil::rows(faces.gCon[0][nu], dir, first, last);
+        gCon[nu][0] = gCon[0][nu];
+      }
+    }
+    else
+    {
+      gCon[mu][mu] = stencil::rows(faces.gCon[mu][mu], dir, first, last);
+    }
+  }
+
+  if (params::conduction || params::viscosity)
+  {
+    for (int d=0; d<3; d++)
+    {
+      XCoords[d] = stencil::rows(faces.XCoords[d], dir, first, last);
+      xCoords[d] = stencil::rows(faces.xCoords[d], dir, first, last);
+    }
+  }
+}
+
 void geometry::computeConnectionCoeffs()
 {
+  /* Already read from the cache */
+  if (!gammaUpDownDown[0][0][0].isempty())
+  {
+    return;
+  }
+
   array gammaDownDownDown[NDIM][NDIM][NDIM];
   array gCovPlus[NDIM-1][NDIM][NDIM];
   array gCovMinus[NDIM-1][NDIM][NDIM];
@@ -115,9 +366,158 @@ void geometry::computeConnectionCoeffs()
     }
   }
 
+  writeCache();
+
   af::sync();
 }
 
+/* The arrays saved in the cache, in order. Only the independent components
+ * of the symmetric gCov, gCon and gammaUpDownDown (in its lower indices) are
+ * stored */
+void geometry::cachedArrays(std::vector<array *> &arrays,
+                            const bool withConnection
+                           )
+{
+  arrays.clear();
+  arrays.push_back(&alpha);
+  arrays.push_back(&g);
+  for (int mu=0; mu<NDIM; mu++)
+  {
+    for (int nu=mu; nu<NDIM; nu++)
+    {
+      arrays.push_back(&gCov[mu][nu]);
+      arrays.push_back(&gCon[mu][nu]);
+    }
+  }
+  for (int mu=0; mu<NDIM; mu++)
+  {
+    for (int nu=0; nu<NDIM; nu++)
+    {
+      arrays.push_back(&dxdX[mu][nu]);
+      arrays.push_back(&dXdx[mu][nu]);
+    }
+  }
+  if (withConnection)
+  {
+    for (int mu=0; mu<NDIM; mu++)
+    {
+      for (int nu=0; nu<NDIM; nu++)
+      {
+        for (int lamda=nu; lamda<NDIM; lamda++)
+        {
+          arrays.push_back(&gammaUpDownDown[mu][nu][lamda]);
+        }
+      }
+    }
+  }
+}
+
+bool geometry::readCache()
+{
+  if (cacheFile.empty())
+  {
+    return false;
+  }
+
+  std::ifstream file(cacheFile.c_str(), std::ios::binary);
+  geometryCacheHeader header;
+  if (!file.read((char *)&header, sizeof(geometryCacheHeader)))
+  {
+    return false;
+  }
+  const geometryCacheHeader expected
+    = cacheHeaderOf(metric, dim, numGhost, N1, N2, N3,
+                    blackHoleSpin, hSlope, GAMMA_EPS, XCoords
+                   );
+  if (memcmp(&header, &expected,
+             offsetof(geometryCacheHeader, hasConnection)
+            ) != 0
+     )
+  {
+    return false;
+  }
+
+  std::vector<array *> arrays;
+  cachedArrays(arrays, header.hasConnection);
+  const size_t numZones = (size_t)header.N1Total*header.N2Total
+                          *header.N3Total;
+  std::vector<double> data(arrays.size()*numZones);
+  if (!file.read((char *)&data[0], data.size()*sizeof(double)))
+  {
+    return false;
+  }
+
+  for (int n=0; n<arrays.size(); n++)
+  {
+    *arrays[n] = array(header.N1Total, header.N2Total, header.N3Total,
+                       &data[n*numZones]
+                      );
+  }
+  for (int mu=0; mu<NDIM; mu++)
+  {
+    for (int nu=0; nu<mu; nu++)
+    {
+      gCov[mu][nu] = gCov[nu][mu];
+      gCon[mu][nu] = gCon[nu][mu];
+    }
+  }
+  if (header.hasConnection)
+  {
+    for (int mu=0; mu<NDIM; mu++)
+    {
+      for (int nu=0; nu<NDIM; nu++)
+      {
+        for (int lamda=0; lamda<nu; lamda++)
+        {
+          gammaUpDownDown[mu][nu][lamda] = gammaUpDownDown[mu][lamda][nu];
+        }
+      }
+    }
+  }
+
+  return true;
+}
+
+void geometry::writeCache()
+{
+  if (cacheFile.empty())
+  {
+    return;
+  }
+
+  geometryCacheHeader header
+    = cacheHeaderOf(metric, dim, numGhost, N1, N2, N3,
+                    blackHoleSpin, hSlope, GAMMA_EPS, XCoords
+                   );
+  header.hasConnection = !gammaUpDownDown[0][0][0].isempty();
+
+  std::vector<array *> arrays;
+  cachedArrays(arrays, header.hasConnection);
+  const size_t numZones = (size_t)header.N1Total*header.N2Total
+                          *header.N3Total;
+  std::vector<double> data(arrays.size()*numZones);
+  for (int n=0; n<arrays.size(); n++)
+  {
+    /* Components set to a constant are not arrays over the grid */
+    if (arrays[n]->elements() != numZones)
+    {
+      return;
+    }
+    arrays[n]->host(&data[n*numZones]);
+  }
+
+  /* Renamed once complete, so that an interrupted write is never read */
+  const std::string partialFile = cacheFile + ".partial";
+  std::ofstream file(partialFile.c_str(), std::ios::binary);
+  file.write((const char *)&header, sizeof(geometryCacheHeader));
+  file.write((const char *)&data[0], data.size()*sizeof(double));
+  file.close();
+  if (file)
+  {
+    rename(partialFile.c_str(), cacheFile.c_str());
+  }
+}
+
 /* Inverse of a 4 x 4 matrix :
  * WARNING: ONLY WORKS FOR SYMMETRIC MATRICES */
 void geometry::setgDetAndgConFromgCov(const array gCov[NDIM][NDIM],
@@ -3,6 +3,8 @@
 
 #include "../params.hpp"
 #include "../grid/grid.hpp"
+#include <string>
+#include <vector>
 
 class geometry
 {
@@ -25,6 +27,14 @@ class geometry
                                  );
     // Change in coord value when computing metric derivatives
     double GAMMA_EPS;
+
+    // Per-rank file of the cache of the geometry, empty if not cached
+    std::string cacheFile;
+    void cachedArrays(std::vector<array *> &arrays,
+                      const bool withConnection
+                     );
+    bool readCache();
+    void writeCache();
   
   public:
     int N1, N2, N3, dim, numGhost;
@@ -42,13 +52,31 @@ class geometry
 
     array gammaUpDownDown[NDIM][NDIM][NDIM];
 
+    /* With a cacheFileBase, the metric and the connection coefficients are
+     * read from the per-rank file cacheFileBase.rankNNNNN.bin when it was
+     * written for the same coordinates and metric parameters, and saved to
+     * it otherwise. The Minkowski metric is not cached */
     geometry(const int metric,
              const double blackHoleSpin,
              const double hSlope,
-             const coordinatesGrid &XCoordsGrid
+             const coordinatesGrid &XCoordsGrid,
+             const std::string cacheFileBase = ""
             );
+    geometry();
     ~geometry();
 
+    /* Both face states of the Riemann solver, stacked along the 4th
+     * dimension. The timeStepper stacks its face geometries once, and
+     * makes first and second views of the slabs with viewFace(), so that
+     * the metric is not kept twice */
+    void stackFaces(const geometry &first, const geometry &second);
+    void viewFace(const geometry &faces, const int face);
+    /* Views of the zones first <= n <= last along dir of the components
+     * stacked in faces, for the tiles of timeStepper::computeDivOfFluxes() */
+    void viewRows(const geometry &faces, const int dir,
+                  const int first, const int last
+                 );
+
     void computeConnectionCoeffs();
     void conXTox(const array conX[NDIM], array conx[NDIM]);
     void getXCoords(array tXCoords[3]) const
@@ -0,0 +1,924 @@
+#include "dumpwriter.hpp"
+#include <hdf5.h>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace
+{
+  const int NUM_BUFFERS = 2;
+
+  /* One dump: the zones of this rank in the window, one variable after the
+   * other, and where they go */
+  struct dumpJob
+  {
+    std::vector<double> data;
+    std::string varsName, fileName;
+
+    int numVars, rank;
+    hsize_t dims[3], offset[3], count[3];
+
+    /* Empty for an exact dump */
+    dumpWriter::errorBounds bounds;
+
+    /* X1Start, X1End, ..., X3End of the run */
+    double domain[6];
+
+    bool inUse;
+  };
+
+  dumpJob jobs[NUM_BUFFERS];
+  std::deque<int> pendingJobs;
+  int jobsInFlight = 0;
+
+  std::mutex lock;
+  std::condition_variable jobQueued, jobDone;
+  std::thread ioThread;
+  bool isAsync = false;
+  bool shutdownRequested = false;
+  bool isInitialized = false;
+
+  MPI_Comm ioComm;
+
+  /* Filters need collective writes with HDF5 >= 1.10.2 in parallel */
+#if defined(H5_HAVE_PARALLEL) && !H5_VERSION_GE(1, 10, 2)
+  const bool compressionAvailable = false;
+#else
+  const bool compressionAvailable = true;
+#endif
+
+  /* Shape of one variable of the grid in the file: N3 x N2 x N1, without
+   * the directions beyond dim. offset and count are the part of this rank */
+  int fileSpaceDims(const int dim,
+                    const int N1, const int N2, const int N3,
+                    const int iLocalStart, const int jLocalStart,
+                    const int kLocalStart,
+                    const int N1Local, const int N2Local, const int N3Local,
+                    hsize_t dims[], hsize_t offset[], hsize_t count[]
+                   )
+  {
+    int rank = 0;
+    if (dim == 3)
+    {
+      dims[rank] = N3; offset[rank] = kLocalStart; count[rank] = N3Local;
+      rank++;
+    }
+    if (dim > 1)
+    {
+      dims[rank] = N2; offset[rank] = jLocalStart; count[rank] = N2Local;
+      rank++;
+    }
+    dims[rank] = N1; offset[rank] = iLocalStart; count[rank] = N1Local;
+    rank++;
+
+    return rank;
+  }
+
+  /* Zones of the window in [localStart, localEnd) along one direction:
+   * first local index (ghost zones included), count, and the offset in the
+   * dump, in strides */
+  void windowPart(const int start, const int end, const int stride,
+                  const int localStart, const int localEnd,
+                  const int numGhost,
+                  int &first, int &count, int &offset, int &size
+                 )
+  {
+    size = std::max(0, (end - start + stride - 1)/stride);
+
+    /* First zone of the window at or after localStart */
+    int firstGlobal = std::max(start, localStart);
+    firstGlobal += (stride - (firstGlobal - start)%stride)%stride;
+    const int lastGlobal = std::min(end, localEnd);
+
+    first  = firstGlobal - localStart + numGhost;
+    count  = std::max(0, (lastGlobal - firstGlobal + stride - 1)/stride);
+    offset = (firstGlobal - start)/stride;
+  }
+
+  /* Rounds every value to the fewest bits of mantissa that keep it within
+   * max(absolute, relative*|value|) */
+  void roundMantissas(double *data, const size_t numValues,
+                      const double relative, const double absolute
+                     )
+  {
+    const int MANTISSA_BITS = 52;
+    for (size_t n=0; n<numValues; n++)
+    {
+      const double value = data[n];
+      const double bound = std::max(absolute, relative*std::fabs(value));
+      if (value == 0. || !std::isfinite(value) || !(bound > 0.))
+      {
+        continue;
+      }
+      if (bound >= std::fabs(value))
+      {
+        data[n] = 0.;
+        continue;
+      }
+
+      /* 2^(exponent-1) <= |value| < 2^exponent: keeping k bits, the
+       * rounding error is at most 2^(exponent-2-k) */
+      int exponent;
+      std::frexp(value, &exponent);
+      const int keep
+        = std::max(0, (int)std::ceil(exponent - 2 - std::log2(bound)));
+      if (keep >= MANTISSA_BITS)
+      {
+        continue;
+      }
+
+      const int drop = MANTISSA_BITS - keep;
+      uint64_t bits;
+      memcpy(&bits, &value, sizeof(double));
+      bits += (uint64_t)1 << (drop - 1);
+      bits &= ~(((uint64_t)1 << drop) - 1);
+      memcpy(&data[n], &bits, sizeof(double));
+    }
+  }
+
+  void writeAttribute(const hid_t dataset, const std::string name,
+                      const double value
+                     )
+  {
+    hid_t space     = H5Screate(H5S_SCALAR);
+    hid_t attribute = H5Acreate2(dataset, name.c_str(), H5T_NATIVE_DOUBLE,
+                                 space, H5P_DEFAULT, H5P_DEFAULT
+                                );
+    H5Awrite(attribute, H5T_NATIVE_DOUBLE, &value);
+    H5Aclose(attribute);
+    H5Sclose(space);
+  }
+
+  /* false if object has no attribute name */
+  bool readAttribute(const hid_t object, const std::string name,
+                     double &value
+                    )
+  {
+    if (H5Aexists(object, name.c_str()) <= 0)
+    {
+      return false;
+    }
+    hid_t attribute = H5Aopen(object, name.c_str(), H5P_DEFAULT);
+    H5Aread(attribute, H5T_NATIVE_DOUBLE, &value);
+    H5Aclose(attribute);
+    return true;
+  }
+
+  const char *domainNames[6] = {"X1Start", "X1End",
+                                "X2Start", "X2End",
+                                "X3Start", "X3End"
+                               };
+
+  /* The domain of the run is kept with every dump. Files that have it are
+   * only read over the same domain, along the directions of the file and of
+   * the run; a mismatch aborts */
+  void checkDomain(const hid_t group, const std::string fileName,
+                   const int dim
+                  )
+  {
+    const double domain[6] = {params::X1Start, params::X1End,
+                              params::X2Start, params::X2End,
+                              params::X3Start, params::X3End
+                             };
+    for (int d=0; d<dim; d++)
+    {
+      double fileStart, fileEnd;
+      if (   !readAttribute(group, domainNames[2*d],     fileStart)
+          || !readAttribute(group, domainNames[2*d + 1], fileEnd)
+         )
+      {
+        continue;
+      }
+      const double tolerance = 1e-10*std::fabs(domain[2*d+1] - domain[2*d]);
+      if (   std::fabs(fileStart - domain[2*d])     > tolerance
+          || std::fabs(fileEnd   - domain[2*d + 1]) > tolerance
+         )
+      {
+        PetscPrintf(PETSC_COMM_WORLD,
+                    "  %s is over %g <= X%d <= %g, the run over %g <= X%d <= %g\n",
+                    fileName.c_str(), fileStart, d+1, fileEnd,
+                    domain[2*d], d+1, domain[2*d + 1]
+                   );
+        MPI_Abort(PETSC_COMM_WORLD, 1);
+      }
+    }
+  }
+
+  /* Zones of the datasets of varsName in each direction, 1 beyond the dim
+   * of the file, which is returned */
+  int fileSize(const hid_t file, const std::string varsName, int N[3])
+  {
+    hid_t dataset   = H5Dopen2(file,
+                               dumpWriter::datasetName(varsName, 0).c_str(),
+                               H5P_DEFAULT
+                              );
+    hid_t fileSpace = H5Dget_space(dataset);
+    hsize_t fileDims[3];
+    const int fileRank = H5Sget_simple_extent_dims(fileSpace, fileDims,
+                                                   NULL
+                                                  );
+    H5Sclose(fileSpace);
+    H5Dclose(dataset);
+
+    for (int d=0; d<3; d++)
+    {
+      N[d] = d < fileRank ? fileDims[fileRank - 1 - d] : 1;
+    }
+    return fileRank;
+  }
+
+  /* Monotonized central slope */
+  double limitedSlope(const double left, const double center,
+                      const double right
+                     )
+  {
+    const double dLeft  = center - left;
+    const double dRight = right - center;
+    if (dLeft*dRight <= 0.)
+    {
+      return 0.;
+    }
+    const double slope = std::min(std::min(2.*std::fabs(dLeft),
+                                           2.*std::fabs(dRight)
+                                          ),
+                                  0.5*std::fabs(dLeft + dRight)
+                                 );
+    return dLeft > 0. ? slope : -slope;
+  }
+
+  /* Resamples block (n[0] x n[1] x n[2], X1 the fastest) along direction d.
+   * The block holds the zones sourceStart <= i < sourceStart + n[d] of a
+   * grid of sourceN zones, and is replaced by the zones targetStart <= i <
+   * targetStart + targetCount of a grid of targetN zones over the same
+   * extent. A target zone gets the mean over it of the piecewise linear,
+   * limited reconstruction of the source zones: the sum of the values times
+   * the widths of the zones is conserved. The slopes of the first and last
+   * zones of the block are 0, so the block must hold one more source zone
+   * on each side than the target zones overlap, where there is one */
+  void resampleDirection(std::vector<double> &block, int n[3], const int d,
+                         const int sourceStart, const int sourceN,
+                         const int targetStart, const int targetCount,
+                         const int targetN
+                        )
+  {
+    const double ratio = (double)sourceN/targetN;
+
+    int m[3] = {n[0], n[1], n[2]};
+    m[d] = targetCount;
+    const size_t stride[3]    = {1, (size_t)n[0], (size_t)n[0]*n[1]};
+    const size_t outStride[3] = {1, (size_t)m[0], (size_t)m[0]*m[1]};
+    std::vector<double> out((size_t)m[0]*m[1]*m[2]);
+
+    /* Lines along d */
+    const int a = (d + 1)%3;
+    const int b = (d + 2)%3;
+    for (int lineB=0; lineB<n[b]; lineB++)
+    {
+      for (int lineA=0; lineA<n[a]; lineA++)
+      {
+        const double *line = &block[lineA*stride[a] + lineB*stride[b]];
+        double *outLine    = &out[lineA*outStride[a] + lineB*outStride[b]];
+
+        for (int t=0; t<targetCount; t++)
+        {
+          /* Extent of the target zone, in source zones */
+          const double lo = (targetStart + t)*ratio;
+          const double hi = (targetStart + t + 1)*ratio;
+
+          double sum = 0.;
+          for (int c=(int)std::floor(lo); c < hi && c < sourceN; c++)
+          {
+            const int i = c - sourceStart;
+            const double q = line[i*stride[d]];
+            double slope = 0.;
+            if (i > 0 && i < n[d]-1)
+            {
+              slope = limitedSlope(line[(i-1)*stride[d]], q,
+                                   line[(i+1)*stride[d]]
+                                  );
+            }
+            const double from = std::max(lo, (double)c);
+            const double to   = std::min(hi, c + 1.);
+            sum += (to - from)*(q + slope*(0.5*(from + to) - (c + 0.5)));
+          }
+          outLine[t*outStride[d]] = sum/ratio;
+        }
+      }
+    }
+
+    block.swap(out);
+    n[d] = targetCount;
+  }
+
+  /* Interior of this rank, from the datasets of file at another resolution
+   * (sourceN zones in each direction, 1 beyond sourceDim). Every rank reads
+   * the source zones under its own zones, and one more on each side for
+   * the slopes. A direction with a single source zone is extruded, and the
+   * directions of the file beyond layout.dim are averaged over */
+  void readResampled(const grid &layout, const hid_t file,
+                     const hid_t transfer, const std::string varsName,
+                     const int sourceDim, const int sourceN[3],
+                     double *globalAoS
+                    )
+  {
+    const int targetN[3]     = {layout.N1, layout.N2, layout.N3};
+    const int targetStart[3] = {layout.iLocalStart, layout.jLocalStart,
+                                layout.kLocalStart
+                               };
+    const int targetCount[3] = {layout.N1Local, layout.N2Local,
+                                layout.N3Local
+                               };
+
+    int sourceStart[3], sourceCount[3];
+    for (int d=0; d<3; d++)
+    {
+      const double ratio = (double)sourceN[d]/targetN[d];
+      const int lo = (int)std::floor(targetStart[d]*ratio) - 1;
+      const int hi = (int)std::ceil((targetStart[d] + targetCount[d])*ratio)
+                     + 1;
+      sourceStart[d] = std::max(lo, 0);
+      sourceCount[d] = std::min(hi, sourceN[d]) - sourceStart[d];
+    }
+
+    hsize_t dims[3], offset[3], count[3];
+    const int rank = fileSpaceDims(sourceDim,
+                                   sourceN[0], sourceN[1], sourceN[2],
+                                   sourceStart[0], sourceStart[1],
+                                   sourceStart[2],
+                                   sourceCount[0], sourceCount[1],
+                                   sourceCount[2],
+                                   dims, offset, count
+                                  );
+    hid_t memSpace = H5Screate_simple(rank, count, NULL);
+
+    std::vector<double> block;
+    for (int var=0; var<layout.numVars; var++)
+    {
+      block.resize((size_t)sourceCount[0]*sourceCount[1]*sourceCount[2]);
+      hid_t dataset   = H5Dopen2(file,
+                                 dumpWriter::datasetName(varsName,
+                                                         var
+                                                        ).c_str(),
+                                 H5P_DEFAULT
+                                );
+      hid_t fileSpace = H5Dget_space(dataset);
+      H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, NULL, count,
+                          NULL
+                         );
+      H5Dread(dataset, H5T_NATIVE_DOUBLE, memSpace, fileSpace, transfer,
+              &block[0]
+             );
+      H5Sclose(fileSpace);
+      H5Dclose(dataset);
+
+      int n[3] = {sourceCount[0], sourceCount[1], sourceCount[2]};
+      for (int d=0; d<3; d++)
+      {
+        resampleDirection(block, n, d, sourceStart[d], sourceN[d],
+                          targetStart[d], targetCount[d], targetN[d]
+                         );
+      }
+
+      for (size_t zone=0; zone<block.size(); zone++)
+      {
+        globalAoS[var + layout.numVars*zone] = block[zone];
+      }
+    }
+
+    H5Sclose(memSpace);
+  }
+
+  void writeJob(dumpJob &job)
+  {
+    const int rank = job.rank;
+    hsize_t *dims = job.dims, *offset = job.offset, *count = job.count;
+
+    /* One chunk per rank: the largest local block of the decomposition */
+    int localSize[3], chunkSize[3];
+    for (int d=0; d<rank; d++)
+    {
+      localSize[d] = count[d];
+    }
+    MPI_Allreduce(localSize, chunkSize, rank, MPI_INT, MPI_MAX, ioComm);
+    hsize_t chunkDims[3];
+    for (int d=0; d<rank; d++)
+    {
+      chunkDims[d] = std::max(chunkSize[d], 1);
+    }
+
+    hid_t fileAccess = H5Pcreate(H5P_FILE_ACCESS);
+    hid_t transfer   = H5Pcreate(H5P_DATASET_XFER);
+    hid_t creation   = H5Pcreate(H5P_DATASET_CREATE);
+#ifdef H5_HAVE_PARALLEL
+    H5Pset_fapl_mpio(fileAccess, ioComm, MPI_INFO_NULL);
+    H5Pset_dxpl_mpio(transfer, H5FD_MPIO_COLLECTIVE);
+#endif
+    H5Pset_chunk(creation, rank, chunkDims);
+    if (compressionAvailable && params::dumpCompressionLevel > 0)
+    {
+      H5Pset_shuffle(creation);
+      H5Pset_deflate(creation, params::dumpCompressionLevel);
+    }
+
+    hid_t file = H5Fcreate(job.fileName.c_str(), H5F_ACC_TRUNC,
+                           H5P_DEFAULT, fileAccess
+                          );
+    hid_t group = H5Gcreate2(file, job.varsName.c_str(),
+                             H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT
+                            );
+    for (int n=0; n<6; n++)
+    {
+      writeAttribute(group, domainNames[n], job.domain[n]);
+    }
+    H5Gclose(group);
+
+    hid_t fileSpace = H5Screate_simple(rank, dims, NULL);
+    hid_t memSpace  = H5Screate_simple(rank, count, NULL);
+    const hsize_t zones = job.data.size()/job.numVars;
+    if (zones > 0)
+    {
+      H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, NULL, count,
+                          NULL
+                         );
+    }
+    else
+    {
+      /* Ranks outside of the window still take part in the collective
+       * writes */
+      H5Sselect_none(fileSpace);
+      H5Sselect_none(memSpace);
+    }
+
+    for (int var=0; var<job.numVars; var++)
+    {
+      hid_t dataset = H5Dcreate2(file,
+                                 dumpWriter::datasetName(job.varsName,
+                                                         var
+                                                        ).c_str(),
+                                 H5T_NATIVE_DOUBLE, fileSpace,
+                                 H5P_DEFAULT, creation, H5P_DEFAULT
+                                );
+
+      double relative = 0., absolute = 0.;
+      if (var < job.bounds.relative.size())
+      {
+        relative = job.bounds.relative[var];
+      }
+      if (var < job.bounds.absolute.size())
+      {
+        absolute = job.bounds.absolute[var];
+      }
+      if (relative > 0. || absolute > 0.)
+      {
+        roundMantissas(&job.data[var*zones], zones, relative, absolute);
+        writeAttribute(dataset, "relativeError", relative);
+        writeAttribute(dataset, "absoluteError", absolute);
+      }
+
+      H5Dwrite(dataset, H5T_NATIVE_DOUBLE, memSpace, fileSpace, transfer,
+               zones > 0 ? &job.data[var*zones] : NULL
+              );
+      H5Dclose(dataset);
+    }
+
+    H5Sclose(memSpace);
+    H5Sclose(fileSpace);
+    H5Fclose(file);
+    H5Pclose(creation);
+    H5Pclose(transfer);
+    H5Pclose(fileAccess);
+  }
+
+  void ioLoop()
+  {
+    while (true)
+    {
+      int jobIndex;
+      {
+        std::unique_lock<std::mutex> guard(lock);
+        jobQueued.wait(guard,
+                       [] { return shutdownRequested || !pendingJobs.empty(); }
+                      );
+        if (pendingJobs.empty())
+        {
+          return;
+        }
+        jobIndex = pendingJobs.front();
+        pendingJobs.pop_front();
+      }
+
+      writeJob(jobs[jobIndex]);
+
+      {
+        std::lock_guard<std::mutex> guard(lock);
+        jobs[jobIndex].inUse = false;
+        jobsInFlight--;
+      }
+      jobDone.notify_all();
+    }
+  }
+}
+
+std::string dumpWriter::datasetName(const std::string varsName,
+                                    const int var
+                                   )
+{
+  return varsName + "/var" + std::to_string(var);
+}
+
+void dumpWriter::initialize()
+{
+  if (isInitialized)
+  {
+    return;
+  }
+  MPI_Comm_dup(PETSC_COMM_WORLD, &ioComm);
+  for (int n=0; n<NUM_BUFFERS; n++)
+  {
+    jobs[n].inUse = false;
+  }
+
+  int threadLevel;
+  MPI_Query_thread(&threadLevel);
+  if (params::asyncIO && threadLevel == MPI_THREAD_MULTIPLE)
+  {
+    isAsync = true;
+    shutdownRequested = false;
+    ioThread = std::thread(ioLoop);
+  }
+  else if (params::asyncIO)
+  {
+    PetscPrintf(PETSC_COMM_WORLD,
+                "  MPI_THREAD_MULTIPLE not available, dumps are written synchronously\n"
+               );
+  }
+  if (params::dumpCompressionLevel > 0 && !compressionAvailable)
+  {
+    PetscPrintf(PETSC_COMM_WORLD,
+                "  Compressed parallel HDF5 needs HDF5 >= 1.10.2, dumps are not compressed\n"
+               );
+  }
+  isInitialized = true;
+}
+
+void dumpWriter::write(const grid &layout,
+                       const std::string varsName, const std::string fileName,
+                       const errorBounds *bounds
+                      )
+{
+  const int start[3]  = {0, 0, 0};
+  const int end[3]    = {layout.N1, layout.N2, layout.N3};
+  const int stride[3] = {1, 1, 1};
+
+  writeWindow(layout, start, end, stride, varsName, fileName, bounds);
+}
+
+void dumpWriter::writeWindow(const grid &layout,
+                             const int start[3], const int end[3],
+                             const int stride[3],
+                             const std::string varsName,
+                             const std::string fileName,
+                             const errorBounds *bounds
+                            )
+{
+  if (!isInitialized)
+  {
+    initialize();
+  }
+
+  const int localStart[3] = {layout.iLocalStart, layout.jLocalStart,
+                             layout.kLocalStart
+                            };
+  const int localEnd[3]   = {layout.iLocalEnd, layout.jLocalEnd,
+                             layout.kLocalEnd
+                            };
+  const int numGhost[3]   = {layout.numGhostX1, layout.numGhostX2,
+                             layout.numGhostX3
+                            };
+  int first[3], count[3], offset[3], size[3];
+  for (int d=0; d<3; d++)
+  {
+    windowPart(start[d], end[d], stride[d], localStart[d], localEnd[d],
+               numGhost[d], first[d], count[d], offset[d], size[d]
+              );
+  }
+  if (size[0]*size[1]*size[2] == 0)
+  {
+    PetscPrintf(PETSC_COMM_WORLD, "  Empty window, %s not written\n",
+                fileName.c_str()
+               );
+    return;
+  }
+
+  /* Only the zones of the window leave the device */
+  const size_t zones = (size_t)count[0]*count[1]*count[2];
+  array window;
+  if (zones > 0)
+  {
+    af::seq windowX1(first[0], first[0] + (count[0]-1)*stride[0], stride[0]);
+    af::seq windowX2(first[1], first[1] + (count[1]-1)*stride[1], stride[1]);
+    af::seq windowX3(first[2], first[2] + (count[2]-1)*stride[2], stride[2]);
+
+    window = array(count[0], count[1], count[2], layout.numVars, f64);
+    for (int var=0; var<layout.numVars; var++)
+    {
+      window(span, span, span, var)
+        = layout.vars[var](windowX1, windowX2, windowX3);
+    }
+  }
+
+  /* Back-pressure: wait for a free buffer */
+  int jobIndex = 0;
+  {
+    std::unique_lock<std::mutex> guard(lock);
+    jobDone.wait(guard, [&jobIndex]
+                        {
+                          for (int n=0; n<NUM_BUFFERS; n++)
+                          {
+                            if (!jobs[n].inUse)
+                            {
+                              jobIndex = n;
+                              return true;
+                            }
+                          }
+                          return false;
+                        }
+                );
+    jobs[jobIndex].inUse = true;
+  }
+
+  dumpJob &job = jobs[jobIndex];
+  job.varsName = varsName;
+  job.fileName = fileName;
+  job.numVars  = layout.numVars;
+  job.bounds   = bounds ? *bounds : errorBounds();
+
+  /* Extent of the window, the whole domain of the run beyond dim */
+  const double domain[6] = {params::X1Start, params::X1End,
+                            params::X2Start, params::X2End,
+                            params::X3Start, params::X3End
+                           };
+  const int N[3] = {layout.N1, layout.N2, layout.N3};
+  for (int d=0; d<3; d++)
+  {
+    job.domain[2*d]     = domain[2*d];
+    job.domain[2*d + 1] = domain[2*d + 1];
+    if (d < layout.dim)
+    {
+      const double dX = (domain[2*d + 1] - domain[2*d])/N[d];
+      job.domain[2*d]     = domain[2*d] + start[d]*dX;
+      job.domain[2*d + 1] =
+        domain[2*d] + std::min(start[d] + size[d]*stride[d], N[d])*dX;
+    }
+  }
+  job.rank     = fileSpaceDims(layout.dim, size[0], size[1], size[2],
+                               offset[0], offset[1], offset[2],
+                               count[0], count[1], count[2],
+                               job.dims, job.offset, job.count
+                              );
+
+  /* The buffers keep their capacity from one dump to the next */
+  job.data.resize(zones*layout.numVars);
+  if (zones > 0)
+  {
+    window.host(&job.data[0]);
+  }
+
+  if (!isAsync)
+  {
+    writeJob(job);
+    job.inUse = false;
+    return;
+  }
+
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    pendingJobs.push_back(jobIndex);
+    jobsInFlight++;
+  }
+  jobQueued.notify_one();
+}
+
+int dumpWriter::fileDim(const std::string varsName,
+                        const std::string fileName, int N[3]
+                       )
+{
+  wait();
+
+  /* A single read of the metadata, shared with the other ranks */
+  int rank, dim = 0;
+  int fileN[3] = {0, 0, 0};
+  MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+  if (rank == 0)
+  {
+    H5E_auto2_t errorHandler;
+    void *errorData;
+    H5Eget_auto2(H5E_DEFAULT, &errorHandler, &errorData);
+    H5Eset_auto2(H5E_DEFAULT, NULL, NULL);
+    hid_t file = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (file >= 0)
+    {
+      hid_t group = H5Gopen2(file, varsName.c_str(), H5P_DEFAULT);
+      if (group >= 0)
+      {
+        H5Gclose(group);
+        dim = fileSize(file, varsName, fileN);
+      }
+      H5Fclose(file);
+    }
+    H5Eset_auto2(H5E_DEFAULT, errorHandler, errorData);
+  }
+  MPI_Bcast(&dim, 1, MPI_INT, 0, PETSC_COMM_WORLD);
+  MPI_Bcast(fileN, 3, MPI_INT, 0, PETSC_COMM_WORLD);
+
+  if (N != NULL)
+  {
+    for (int d=0; d<3; d++)
+    {
+      N[d] = fileN[d];
+    }
+  }
+  return dim;
+}
+
+void dumpWriter::readBlock(const std::string varsName,
+                           const std::string fileName, const int var,
+                           const int start[3], const int count[3],
+                           double *block
+                          )
+{
+  wait();
+
+  /* Every rank opens the file on its own, without MPI-IO */
+  hid_t file = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+  int N[3];
+  const int sourceDim = fileSize(file, varsName, N);
+
+  hsize_t dims[3], offset[3], blockCount[3];
+  const int rank = fileSpaceDims(sourceDim, N[0], N[1], N[2],
+                                 start[0], start[1], start[2],
+                                 count[0], count[1], count[2],
+                                 dims, offset, blockCount
+                                );
+  hid_t memSpace  = H5Screate_simple(rank, blockCount, NULL);
+  hid_t dataset   = H5Dopen2(file, datasetName(varsName, var).c_str(),
+                             H5P_DEFAULT
+                            );
+  hid_t fileSpace = H5Dget_space(dataset);
+  H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, NULL, blockCount,
+                      NULL
+                     );
+  H5Dread(dataset, H5T_NATIVE_DOUBLE, memSpace, fileSpace, H5P_DEFAULT,
+          block
+         );
+
+  H5Sclose(fileSpace);
+  H5Dclose(dataset);
+  H5Sclose(memSpace);
+  H5Fclose(file);
+}
+
+void dumpWriter::windowSize(const int start[3], const int end[3],
+                            const int stride[3], int size[3]
+                           )
+{
+  for (int d=0; d<3; d++)
+  {
+    int first, count, offset;
+    windowPart(start[d], end[d], stride[d], start[d], end[d], 0,
+               first, count, offset, size[d]
+              );
+  }
+}
+
+void dumpWriter::wait()
+{
+  std::unique_lock<std::mutex> guard(lock);
+  jobDone.wait(guard, [] { return jobsInFlight == 0; });
+}
+
+void dumpWriter::finalize()
+{
+  if (!isInitialized)
+  {
+    return;
+  }
+  if (isAsync)
+  {
+    {
+      std::lock_guard<std::mutex> guard(lock);
+      shutdownRequested = true;
+    }
+    jobQueued.notify_one();
+    ioThread.join();
+    isAsync = false;
+  }
+  MPI_Comm_free(&ioComm);
+  isInitialized = false;
+}
+
+bool dumpWriter::read(const grid &layout,
+                      const std::string varsName, const std::string fileName,
+                      double *globalAoS
+                     )
+{
+  wait();
+  if (!isInitialized)
+  {
+    initialize();
+  }
+
+  hid_t fileAccess = H5Pcreate(H5P_FILE_ACCESS);
+  hid_t transfer   = H5Pcreate(H5P_DATASET_XFER);
+#ifdef H5_HAVE_PARALLEL
+  H5Pset_fapl_mpio(fileAccess, PETSC_COMM_WORLD, MPI_INFO_NULL);
+  H5Pset_dxpl_mpio(transfer, H5FD_MPIO_COLLECTIVE);
+#endif
+  hid_t file = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, fileAccess);
+
+  /* Files from VecView() hold a single dataset instead of a group */
+  H5E_auto2_t errorHandler;
+  void *errorData;
+  H5Eget_auto2(H5E_DEFAULT, &errorHandler, &errorData);
+  H5Eset_auto2(H5E_DEFAULT, NULL, NULL);
+  hid_t group = H5Gopen2(file, varsName.c_str(), H5P_DEFAULT);
+  H5Eset_auto2(H5E_DEFAULT, errorHandler, errorData);
+
+  if (group < 0)
+  {
+    H5Fclose(file);
+    H5Pclose(transfer);
+    H5Pclose(fileAccess);
+    return false;
+  }
+
+  /* Resolution of the file */
+  int sourceN[3];
+  const int sourceDim = fileSize(file, varsName, sourceN);
+  checkDomain(group, fileName, std::min(sourceDim, layout.dim));
+  H5Gclose(group);
+  if (   sourceN[0] != layout.N1 || sourceN[1] != layout.N2
+      || sourceN[2] != layout.N3
+     )
+  {
+    PetscPrintf(PETSC_COMM_WORLD,
+                "  Resampling %s from %d x %d x %d to %d x %d x %d zones\n",
+                fileName.c_str(), sourceN[0], sourceN[1], sourceN[2],
+                layout.N1, layout.N2, layout.N3
+               );
+    readResampled(layout, file, transfer, varsName, sourceDim, sourceN,
+                  globalAoS
+                 );
+
+    H5Fclose(file);
+    H5Pclose(transfer);
+    H5Pclose(fileAccess);
+    return true;
+  }
+
+  hsize_t dims[3], offset[3], count[3];
+  const int rank = fileSpaceDims(layout.dim, layout.N1, layout.N2, layout.N3,
+                                 layout.iLocalStart, layout.jLocalStart,
+                                 layout.kLocalStart,
+                                 layout.N1Local, layout.N2Local,
+                                 layout.N3Local,
+                                 dims, offset, count
+                                );
+  hid_t memSpace = H5Screate_simple(rank, count, NULL);
+
+  const int numVars = layout.numVars;
+  std::vector<double> interior((size_t)layout.N1Local
+                               *layout.N2Local*layout.N3Local
+                              );
+  for (int var=0; var<numVars; var++)
+  {
+    hid_t dataset   = H5Dopen2(file, datasetName(varsName, var).c_str(),
+                               H5P_DEFAULT
+                              );
+    hid_t fileSpace = H5Dget_space(dataset);
+    H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, NULL, count, NULL);
+    H5Dread(dataset, H5T_NATIVE_DOUBLE, memSpace, fileSpace, transfer,
+            &interior[0]
+           );
+    H5Sclose(fileSpace);
+    H5Dclose(dataset);
+
+    for (size_t zone=0; zone<interior.size(); zone++)
+    {
+      globalAoS[var + numVars*zone] = interior[zone];
+    }
+  }
+
+  H5Sclose(memSpace);
+  H5Fclose(file);
+  H5Pclose(transfer);
+  H5Pclose(fileAccess);
+
+  return true;
+}
@@ -0,0 +1,114 @@
+#ifndef GRIM_DUMPWRITER_H_
+#define GRIM_DUMPWRITER_H_
+
+#include <string>
+#include <vector>
+#include "grid.hpp"
+
+/* Writer of the HDF5 dumps made by grid::dump(). The calling thread only
+ * copies the vars of its rank (or of a window of the grid) into one of two
+ * pre-allocated host buffers and goes on with the time step; a background
+ * I/O thread writes the buffer with parallel HDF5 on its own duplicate of
+ * PETSC_COMM_WORLD. If both buffers are
+ * still waiting to be written, the caller blocks until one is free.
+ *
+ * Layout of a file: a group varsName with one dataset per variable,
+ * varsName/var0, varsName/var1, ..., each N3 x N2 x N1 (without the
+ * directions beyond dim), so that a single variable can be read on its own.
+ * The datasets are chunked with one chunk per rank of the decomposition and,
+ * with params::dumpCompressionLevel > 0, compressed with shuffle + deflate.
+ * Every rank must issue the same dumps in the same order.
+ *
+ * The background thread needs MPI_THREAD_MULTIPLE. Without it, or with
+ * params::asyncIO = 0, the dumps are written synchronously from the same
+ * buffers. */
+namespace dumpWriter
+{
+  /* Path of variable var in a file written by write() */
+  std::string datasetName(const std::string varsName, const int var);
+
+  /* Called once after MPI is initialized */
+  void initialize();
+
+  /* Error bounds of a lossy dump, per variable. Every value is rounded to
+   * the fewest bits of mantissa that keep it within
+   * max(absolute[var], relative[var]*|value|) of the original, and the
+   * zeroed bits are then squeezed out by shuffle + deflate (so it needs
+   * params::dumpCompressionLevel > 0 to save space). Variables with both
+   * bounds 0, or beyond the size of the vectors, are written exactly. The
+   * bounds are stored as the attributes relativeError and absoluteError of
+   * the datasets. Not meant for restart files */
+  struct errorBounds
+  {
+    std::vector<double> relative, absolute;
+  };
+
+  /* Interior of layout.vars. Lossy with bounds */
+  void write(const grid &layout,
+             const std::string varsName, const std::string fileName,
+             const errorBounds *bounds = NULL
+            );
+
+  /* Part of layout.vars: the zones start[d] <= i < end[d] (global indices,
+   * d = 0, 1, 2 for X1, X2, X3), every stride[d]-th one from start[d]. The
+   * zones are picked on the device, so only the window is copied to the
+   * host. Read with the dims of the window, not those of layout */
+  void writeWindow(const grid &layout,
+                   const int start[3], const int end[3], const int stride[3],
+                   const std::string varsName, const std::string fileName,
+                   const errorBounds *bounds = NULL
+                  );
+
+  /* Zones of the window along each direction */
+  void windowSize(const int start[3], const int end[3], const int stride[3],
+                  int size[3]
+                 );
+
+  /* Reads the interior of this rank from a file written by write() into
+   * globalAoS, numVars x N1Local x N2Local x N3Local, the layout of the
+   * PETSc global vector. Returns false if fileName is in the older layout
+   * of VecView() (a single dataset varsName), which VecLoad() reads.
+   *
+   * A file at another resolution is resampled onto layout, one direction
+   * after the other: every zone gets the mean over it of the piecewise
+   * linear reconstruction of the file, with MC limited slopes. This
+   * conserves the integral of every variable over the coordinates for any
+   * ratio of resolutions. A 2D file is extruded along X3 onto a 3D layout
+   * the same way, and a 3D file averaged over X3 onto a 2D layout; every
+   * rank only reads its own part of it. Only the conserved variables are
+   * conserved this way, and nothing keeps the magnetic field divergence
+   * free: the timeStepper resamples restart files itself (see
+   * timeStepper::loadPrimitives()).
+   *
+   * Every dump holds its extent in the coordinates as attributes of
+   * varsName: the domain of the run (params::X1Start...X3End), or the part
+   * of it covered by a window. A file over another domain is not read: the
+   * run is aborted */
+  bool read(const grid &layout,
+            const std::string varsName, const std::string fileName,
+            double *globalAoS
+           );
+
+  /* Number of directions of the datasets of varsName in fileName, 0 if it
+   * is not a file written by write(). With N, also their zones in each
+   * direction, 1 beyond the dim of the file. Collective */
+  int fileDim(const std::string varsName, const std::string fileName,
+              int N[3] = NULL
+             );
+
+  /* The zones start[d] <= i < start[d] + count[d] of variable var in a
+   * file written by write(), into block, X1 the fastest. start is 0 and
+   * count 1 beyond the dim of the file. Every rank reads on its own: not
+   * collective */
+  void readBlock(const std::string varsName, const std::string fileName,
+                 const int var, const int start[3], const int count[3],
+                 double *block
+                );
+
+  /* Blocks until every dump issued so far is on disk */
+  void wait();
+
+  void finalize();
+}
+
+#endif /* GRIM_DUMPWRITER_H_ */
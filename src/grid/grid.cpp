@@ -1,4 +1,6 @@
 #include "grid.hpp"
+#include "dumpwriter.hpp"
+#include "memoryarena.hpp"
 
 grid::grid(const int N1,
            const int N2,
@@ -8,9 +10,11 @@ grid::grid(const int N1,
            const int numGhost,
            const int periodicBoundariesX1,
            const int periodicBoundariesX2,
-           const int periodicBoundariesX3
+           const int periodicBoundariesX3,
+           const MPI_Comm comm
           )
 {
+  this->comm     = comm;
   this->numVars  = numVars;
   this->numGhost = numGhost;
   this->N1 = N1;
@@ -32,7 +36,6 @@ grid::grid(const int N1,
   }
 
   hasHostPtrBeenAllocated = 0;
-  havexCoordsBeenSet = 0; // Needed for VTS output
 
   /* Implementations for MIRROR, OUTFLOW in boundary.cpp and DIRICHLET in
    * problem.cpp */
@@ -69,7 +72,7 @@ grid::grid(const int N1,
       domainX2 = new af::seq(span);
       domainX3 = new af::seq(span);
 
-      DMDACreate1d(PETSC_COMM_WORLD, DMBoundaryLeft, 
+      DMDACreate1d(comm, DMBoundaryLeft, 
                    N1, numVars, numGhostX1, NULL,
                    &dm
                   );
@@ -85,7 +88,7 @@ grid::grid(const int N1,
       domainX2 = new af::seq(numGhost, af::end - numGhost);
       domainX3 = new af::seq(span);
 
-      DMDACreate2d(PETSC_COMM_WORLD, 
+      DMDACreate2d(comm, 
                    DMBoundaryLeft, DMBoundaryBottom,
                    DMDA_STENCIL_BOX,
                    N1, N2,
@@ -106,7 +109,7 @@ grid::grid(const int N1,
       domainX2 = new af::seq(numGhost, af::end - numGhost);
       domainX3 = new af::seq(numGhost, af::end - numGhost);
 
-      DMDACreate3d(PETSC_COMM_WORLD, 
+      DMDACreate3d(comm, 
                    DMBoundaryLeft, DMBoundaryBottom, DMBoundaryBack,
                    DMDA_STENCIL_BOX,
                    N1, N2, N3,
@@ -127,6 +130,7 @@ grid::grid(const int N1,
   N1Total = N1Local + 2*numGhostX1;
   N2Total = N2Local + 2*numGhostX2;
   N3Total = N3Local + 2*numGhostX3;
+  memoryArena::setGridSize(N1Total, N2Total, N3Total);
 
   DMCreateGlobalVector(dm, &globalVec);
   DMCreateLocalVector(dm, &localVec);
@@ -261,11 +265,7 @@ void grid::copyLocalVecToVars()
 
   VecRestoreArray(localVec, &pointerToLocalVec);
 
-  varsSoA = af::reorder(varsCopiedFromLocalVec, 1, 2, 3, 0);
-  for (int var=0; var<numVars; var++)
-  {
-    vars[var] = varsSoA(span, span, span, var);
-  }
+  setVarsFromSoA(af::reorder(varsCopiedFromLocalVec, 1, 2, 3, 0));
 }
 
 void grid::copyVarsToHostPtr()
@@ -291,10 +291,30 @@ void grid::copyVarsToHostPtr()
 
 void grid::copyHostPtrToVars(const double *hostPtr)
 {
-  varsSoA = array(N1Total, N2Total, N3Total, numVars,
-                  hostPtr
-                 );
+  setVarsFromSoA(array(N1Total, N2Total, N3Total, numVars,
+                       hostPtr
+                      )
+                );
+}
+
+/* Returns all the vars stacked along the 4th dimension,
+ * N1Total x N2Total x N3Total x numVars, for routines that work on every
+ * variable at once */
+array grid::getVarsSoA() const
+{
+  array soa(N1Total, N2Total, N3Total, numVars, f64);
+  for (int var=0; var < numVars; var++)
+  {
+    soa(span, span, span, var) = vars[var];
+  }
+
+  return soa;
+}
 
+/* Inverse of getVarsSoA(). vars[var] share the memory of soa */
+void grid::setVarsFromSoA(const array &soa)
+{
+  varsSoA = soa;
   for (int var=0; var < numVars; var++)
   {
     vars[var] = varsSoA(span, span, span, var);
@@ -362,133 +382,36 @@ coordinatesGrid::~coordinatesGrid()
 
 }
 
+/* Snapshot of the vars, written to fileName by the background writer (see
+ * dumpwriter.hpp). Returns as soon as the data is on the host */
 void grid::dump(const std::string varsName, const std::string fileName)
 {
-  copyVarsToGlobalVec();
-
-  PetscViewer viewer;
-  PetscViewerHDF5Open(PETSC_COMM_WORLD,
-                      fileName.c_str(), FILE_MODE_WRITE, &viewer
-                     );
-
-  /* Output the variables */
-  PetscObjectSetName((PetscObject) globalVec, varsName.c_str());
-  VecView(globalVec, viewer);
-
-  PetscViewerDestroy(&viewer);
+  dumpWriter::write(*this, varsName, fileName);
 }
 
-void grid::dumpVTS(const grid &xCoords,
-                   const std::string *varNames,
-                   const std::string fileName
-                  )
+void grid::load(const std::string varsName, const std::string fileName)
 {
-  if (havexCoordsBeenSet == 0)
-  {
-    DMDASetUniformCoordinates(dm,0.0,1.0,0.0,1.0,0.0,1.0);
-    DMGetCoordinateDM(dm, &coordDM);
-    DMGetCoordinates(dm, &coordVec);
-
-    double *x1HostPtr =  xCoords.vars[directions::X1].host<double>();
-    double *x2HostPtr =  xCoords.vars[directions::X2].host<double>();
-    double *x3HostPtr =  xCoords.vars[directions::X3].host<double>();
-
-    DMDACoor2d **coord2D;
-    DMDACoor3d ***coord3D;
-    if (dim==2)
-    {
-      DMDAVecGetArray(coordDM, coordVec, &coord2D);
-    }
-    else if (dim==3)
-    {
-      DMDAVecGetArray(coordDM, coordVec, &coord3D);
-    }
-
-    for (int k=0; k<N3Local; k++)
-    {
-      for (int j=0; j<N2Local; j++)
-      {
-        for (int i=0; i<N1Local; i++)
-        {
-          const int index  = (i + numGhostX1 
-                                + N1Total*(j + numGhostX2
-                                             + N2Total*(k + numGhostX3)
-                                          ) 
-                             );
-
-          const int iPetsc = i + iLocalStart;
-          const int jPetsc = j + jLocalStart;
-          const int kPetsc = k + kLocalStart;
-
-          if (dim==2)
-          {
-            coord2D[jPetsc][iPetsc].x = x1HostPtr[index];
-            coord2D[jPetsc][iPetsc].y = x2HostPtr[index];
-          }
-          else if (dim==3)
-          {
-            coord3D[kPetsc][jPetsc][iPetsc].x = x1HostPtr[index];
-            coord3D[kPetsc][jPetsc][iPetsc].y = x2HostPtr[index];
-            coord3D[kPetsc][jPetsc][iPetsc].z = x3HostPtr[index];
-          }
-        }
-      }
-    }
-    if (dim==2)
-    {
-      DMDAVecRestoreArray(coordDM, coordVec, &coord2D);
-    }
-    else if (dim==3)
-    {
-      DMDAVecRestoreArray(coordDM, coordVec, &coord3D);
-    }
-    delete x1HostPtr;
-    delete x2HostPtr;
-    delete x3HostPtr;
+  double *pointerToGlobalVec;
+  VecGetArray(globalVec, &pointerToGlobalVec);
+  const bool isDumpLayout = dumpWriter::read(*this, varsName, fileName,
+                                             pointerToGlobalVec
+                                            );
+  VecRestoreArray(globalVec, &pointerToGlobalVec);
 
-    DMSetCoordinates(dm, coordVec);
-    havexCoordsBeenSet = 1;
+  /* Older files, written by VecView() */
+  if (!isDumpLayout)
+  {
+    PetscViewer viewer;
+    PetscViewerHDF5Open(PETSC_COMM_WORLD, 
+                        fileName.c_str(), FILE_MODE_READ, &viewer
+                       );
 
-    for (int var=0; var<numVars; var++)
-    {
-      if (varNames[var].empty())
-      {
-        PetscPrintf(PETSC_COMM_WORLD,
-                    "varNames[%d] not assigned a variable name\n", var
-                   );
-        exit(1);
-      }
-      DMDASetFieldName(dm, var, varNames[var].c_str());
-    }
+    PetscObjectSetName((PetscObject) globalVec, varsName.c_str());
+    VecLoad(globalVec, viewer);
 
+    PetscViewerDestroy(&viewer);
   }
 
-  copyVarsToGlobalVec();
-
-  PetscViewer viewer;
-  PetscViewerVTKOpen(PETSC_COMM_WORLD,
-                      fileName.c_str(), FILE_MODE_WRITE, &viewer
-                     );
-
-  /* Output the variables */
-  PetscObjectSetName((PetscObject) globalVec, "");
-  VecView(globalVec, viewer);
-
-  PetscViewerDestroy(&viewer);
-}
-
-void grid::load(const std::string varsName, const std::string fileName)
-{
-  PetscViewer viewer;
-  PetscViewerHDF5Open(PETSC_COMM_WORLD, 
-                      fileName.c_str(), FILE_MODE_READ, &viewer
-                     );
-
-  PetscObjectSetName((PetscObject) globalVec, varsName.c_str());
-  VecLoad(globalVec, viewer);
-
-  PetscViewerDestroy(&viewer);
-
   DMGlobalToLocalBegin(dm, globalVec, INSERT_VALUES, localVec);
   DMGlobalToLocalEnd(dm, globalVec, INSERT_VALUES, localVec);
 
@@ -15,8 +15,11 @@ class grid
   void copyLocalVecToVars();
 
   public:
-    DM dm, coordDM;
-    Vec globalVec, localVec, coordVec;
+    /* PETSC_COMM_WORLD, or PETSC_COMM_SELF for grids that only hold zones of
+     * this rank, as the tiles of timeStepper::computeDivOfFluxes() */
+    MPI_Comm comm;
+    DM dm;
+    Vec globalVec, localVec;
 
     int numGhost, numVars, dim;
          
@@ -44,7 +47,6 @@ class grid
     array indices[3];
     double *hostPtr;
     bool hasHostPtrBeenAllocated;
-    bool havexCoordsBeenSet;
 
     grid(const int N1, 
          const int N2,
@@ -54,7 +56,8 @@ class grid
          const int numGhost,
          const int periodicBoundariesX1,
          const int periodicBoundariesX2,
-         const int periodicBoundariesX3
+         const int periodicBoundariesX3,
+         const MPI_Comm comm = PETSC_COMM_WORLD
         );
     ~grid();
 
@@ -62,11 +65,9 @@ class grid
     void copyVarsToHostPtr();
     void copyVarsToGlobalVec();
     void copyHostPtrToVars(const double *hostPtr);
+    array getVarsSoA() const;
+    void setVarsFromSoA(const array &soa);
     void dump(const std::string varsName, const std::string filename);
-    void dumpVTS(const grid &xCoords,
-                 const std::string *varNames,
-                 const std::string filename
-                );
     void load(const std::string varsName, const std::string filename);
 };
 
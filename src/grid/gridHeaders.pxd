@@ -1,3 +1,5 @@
+from libcpp.string cimport string
+
 cdef extern from "grid.hpp":
   cdef enum:
     LOCATIONS_BACK   "locations::BACK"
@@ -40,6 +42,8 @@ cdef extern from "grid.hpp":
     void communicate()
     void copyVarsToHostPtr()
     void copyHostPtrToVars(const double *hostPtr)
+    void dump(const string varsName, const string fileName)
+    void load(const string varsName, const string fileName)
 
   cdef cppclass coordinatesGrid:
     coordinatesGrid(const int N1, 
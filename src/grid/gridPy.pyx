@@ -81,6 +81,12 @@ cdef class gridPy(object):
   def communicate(self):
     self.gridPtr.communicate()
 
+  def dump(self, varsName, fileName):
+    self.gridPtr.dump(varsName.encode(), fileName.encode())
+
+  def load(self, varsName, fileName):
+    self.gridPtr.load(varsName.encode(), fileName.encode())
+
   cdef grid* getGridPtr(self):
     return self.gridPtr
 
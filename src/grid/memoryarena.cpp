@@ -0,0 +1,445 @@
+#include "memoryarena.hpp"
+#include "../params.hpp"
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <petsc.h>
+#include <arrayfire.h>
+
+#if defined(AF_API_VERSION) && AF_API_VERSION >= 37
+  #define GRIM_MEMORY_ARENA_AVAILABLE
+#endif
+
+namespace
+{
+  struct phase
+  {
+    std::string name;
+    size_t peakBytes;
+  };
+
+  struct sizeClass
+  {
+    std::vector<void *> freeBlocks;
+    int numInUse;
+    int peakInUse; /* during the current time step */
+
+    sizeClass() : numInUse(0), peakInUse(0) {}
+  };
+
+  struct block
+  {
+    size_t size;
+    bool managerLock, userLock;
+  };
+
+  struct arenaState
+  {
+    std::mutex lock;
+
+    size_t gridBytes;
+    std::map<size_t, sizeClass> sizeClasses;
+    std::map<void *, block> blocks;
+
+    size_t bytesInUse, bytesReserved;
+
+    std::vector<phase> phases;
+    int currentPhase;
+
+    arenaState() : gridBytes(0), bytesInUse(0), bytesReserved(0),
+                   currentPhase(-1) {}
+  };
+
+  arenaState arena;
+  bool arenaActive = false;
+
+  void recordUsage(const size_t bytesInUse)
+  {
+    if (arena.currentPhase >= 0)
+    {
+      phase &current = arena.phases[arena.currentPhase];
+      if (bytesInUse > current.peakBytes)
+      {
+        current.peakBytes = bytesInUse;
+      }
+    }
+  }
+
+#ifdef GRIM_MEMORY_ARENA_AVAILABLE
+  af_memory_manager manager;
+
+  size_t getSizeClass(const size_t bytes)
+  {
+    if (arena.gridBytes > 0 && bytes % arena.gridBytes == 0)
+    {
+      return bytes;
+    }
+
+    size_t size = 256;
+    while (size < bytes)
+    {
+      size *= 2;
+    }
+    return size;
+  }
+
+  /* Called with arena.lock held */
+  void releaseFreeBlocks(af_memory_manager handle, sizeClass &sizes,
+                         const size_t size, const int numToKeep
+                        )
+  {
+    while (int(sizes.freeBlocks.size()) > numToKeep)
+    {
+      void *ptr = sizes.freeBlocks.back();
+      sizes.freeBlocks.pop_back();
+      arena.blocks.erase(ptr);
+      arena.bytesReserved -= size;
+      af_memory_manager_native_free(handle, ptr);
+    }
+  }
+
+  void releaseAllFreeBlocks(af_memory_manager handle)
+  {
+    std::map<size_t, sizeClass>::iterator it;
+    for (it = arena.sizeClasses.begin(); it != arena.sizeClasses.end(); it++)
+    {
+      releaseFreeBlocks(handle, it->second, it->first, 0);
+    }
+  }
+
+  af_err initializeFn(af_memory_manager handle)
+  {
+    return AF_SUCCESS;
+  }
+
+  af_err shutdownFn(af_memory_manager handle)
+  {
+    std::lock_guard<std::mutex> guard(arena.lock);
+    releaseAllFreeBlocks(handle);
+    return AF_SUCCESS;
+  }
+
+  af_err allocFn(af_memory_manager handle, void **ptr, int userLock,
+                 const unsigned ndims, dim_t *dims, const unsigned elementSize
+                )
+  {
+    size_t bytes = elementSize;
+    for (int d=0; d < ndims; d++)
+    {
+      bytes *= dims[d];
+    }
+
+    std::lock_guard<std::mutex> guard(arena.lock);
+
+    const size_t size = getSizeClass(bytes);
+    sizeClass &sizes  = arena.sizeClasses[size];
+
+    if (sizes.freeBlocks.size() > 0)
+    {
+      *ptr = sizes.freeBlocks.back();
+      sizes.freeBlocks.pop_back();
+    }
+    else
+    {
+      *ptr = NULL;
+      af_memory_manager_native_alloc(handle, ptr, size);
+      if (*ptr == NULL)
+      {
+        /* Out of memory: give back everything cached and try again */
+        releaseAllFreeBlocks(handle);
+        af_memory_manager_native_alloc(handle, ptr, size);
+        if (*ptr == NULL)
+        {
+          return AF_ERR_NO_MEM;
+        }
+      }
+      arena.bytesReserved += size;
+    }
+
+    block &allocated      = arena.blocks[*ptr];
+    allocated.size        = size;
+    allocated.managerLock = !userLock;
+    allocated.userLock    = userLock;
+
+    sizes.numInUse++;
+    if (sizes.numInUse > sizes.peakInUse)
+    {
+      sizes.peakInUse = sizes.numInUse;
+    }
+    arena.bytesInUse += size;
+    recordUsage(arena.bytesInUse);
+
+    return AF_SUCCESS;
+  }
+
+  af_err allocatedFn(af_memory_manager handle, size_t *size, void *ptr)
+  {
+    std::lock_guard<std::mutex> guard(arena.lock);
+
+    std::map<void *, block>::iterator it = arena.blocks.find(ptr);
+    *size = (it == arena.blocks.end() ? 0 : it->second.size);
+
+    return AF_SUCCESS;
+  }
+
+  af_err unlockFn(af_memory_manager handle, void *ptr, int userUnlock)
+  {
+    std::lock_guard<std::mutex> guard(arena.lock);
+
+    std::map<void *, block>::iterator it = arena.blocks.find(ptr);
+    if (it == arena.blocks.end())
+    {
+      return AF_SUCCESS;
+    }
+
+    block &released = it->second;
+    if (userUnlock)
+    {
+      released.userLock = false;
+    }
+    else
+    {
+      released.managerLock = false;
+    }
+
+    if (released.userLock || released.managerLock)
+    {
+      return AF_SUCCESS;
+    }
+
+    /* Back to the free list of its size class */
+    sizeClass &sizes = arena.sizeClasses[released.size];
+    sizes.freeBlocks.push_back(ptr);
+    sizes.numInUse--;
+    arena.bytesInUse -= released.size;
+
+    return AF_SUCCESS;
+  }
+
+  af_err signalMemoryCleanupFn(af_memory_manager handle)
+  {
+    std::lock_guard<std::mutex> guard(arena.lock);
+    releaseAllFreeBlocks(handle);
+    return AF_SUCCESS;
+  }
+
+  af_err printInfoFn(af_memory_manager handle, char *msg, int device)
+  {
+    std::lock_guard<std::mutex> guard(arena.lock);
+    PetscPrintf(PETSC_COMM_SELF,
+                "  Memory arena %s: %g MB in use, %g MB reserved\n",
+                msg, arena.bytesInUse/1e6, arena.bytesReserved/1e6
+               );
+    return AF_SUCCESS;
+  }
+
+  af_err userLockFn(af_memory_manager handle, void *ptr)
+  {
+    std::lock_guard<std::mutex> guard(arena.lock);
+
+    std::map<void *, block>::iterator it = arena.blocks.find(ptr);
+    if (it != arena.blocks.end())
+    {
+      it->second.userLock = true;
+    }
+    return AF_SUCCESS;
+  }
+
+  af_err userUnlockFn(af_memory_manager handle, void *ptr)
+  {
+    return unlockFn(handle, ptr, 1);
+  }
+
+  af_err isUserLockedFn(af_memory_manager handle, int *out, void *ptr)
+  {
+    std::lock_guard<std::mutex> guard(arena.lock);
+
+    std::map<void *, block>::iterator it = arena.blocks.find(ptr);
+    *out = (it != arena.blocks.end() && it->second.userLock);
+    return AF_SUCCESS;
+  }
+
+  af_err getMemoryPressureFn(af_memory_manager handle, float *pressure)
+  {
+    std::lock_guard<std::mutex> guard(arena.lock);
+    *pressure = (arena.bytesReserved > 0 ?
+                 float(arena.bytesInUse)/float(arena.bytesReserved) : 0.
+                );
+    return AF_SUCCESS;
+  }
+
+  /* Same criterion as the default ArrayFire memory manager */
+  af_err jitTreeExceedsMemoryPressureFn(af_memory_manager handle, int *out,
+                                        size_t bytes
+                                       )
+  {
+    std::lock_guard<std::mutex> guard(arena.lock);
+    *out = (2*bytes > arena.bytesInUse);
+    return AF_SUCCESS;
+  }
+
+  /* A single device per MPI rank: nothing to set up per device */
+  void addMemoryManagementFn(af_memory_manager handle, int id) {}
+  void removeMemoryManagementFn(af_memory_manager handle, int id) {}
+#endif /* GRIM_MEMORY_ARENA_AVAILABLE */
+}
+
+void memoryArena::initialize()
+{
+#ifdef GRIM_MEMORY_ARENA_AVAILABLE
+  if (!params::memoryArena)
+  {
+    return;
+  }
+
+  af_create_memory_manager(&manager);
+  af_memory_manager_set_initialize_fn(manager, initializeFn);
+  af_memory_manager_set_shutdown_fn(manager, shutdownFn);
+  af_memory_manager_set_alloc_fn(manager, allocFn);
+  af_memory_manager_set_allocated_fn(manager, allocatedFn);
+  af_memory_manager_set_unlock_fn(manager, unlockFn);
+  af_memory_manager_set_signal_memory_cleanup_fn(manager,
+                                                 signalMemoryCleanupFn
+                                                );
+  af_memory_manager_set_print_info_fn(manager, printInfoFn);
+  af_memory_manager_set_user_lock_fn(manager, userLockFn);
+  af_memory_manager_set_user_unlock_fn(manager, userUnlockFn);
+  af_memory_manager_set_is_user_locked_fn(manager, isUserLockedFn);
+  af_memory_manager_set_get_memory_pressure_fn(manager, getMemoryPressureFn);
+  af_memory_manager_set_jit_tree_exceeds_memory_pressure_fn
+    (manager, jitTreeExceedsMemoryPressureFn);
+  af_memory_manager_set_add_memory_management_fn(manager,
+                                                 addMemoryManagementFn
+                                                );
+  af_memory_manager_set_remove_memory_management_fn(manager,
+                                                    removeMemoryManagementFn
+                                                   );
+  af_set_memory_manager(manager);
+  arenaActive = true;
+#else
+  if (params::memoryArena)
+  {
+    PetscPrintf(PETSC_COMM_WORLD,
+                "  Memory arena needs ArrayFire >= 3.7, using the default manager\n"
+               );
+  }
+#endif
+}
+
+void memoryArena::setGridSize(const int N1Total,
+                              const int N2Total,
+                              const int N3Total
+                             )
+{
+  std::lock_guard<std::mutex> guard(arena.lock);
+  if (arena.gridBytes == 0)
+  {
+    arena.gridBytes = size_t(N1Total)*N2Total*N3Total*sizeof(double);
+  }
+}
+
+void memoryArena::beginPhase(const char *name)
+{
+  size_t bytesInUse;
+  if (arenaActive)
+  {
+    arena.lock.lock();
+    bytesInUse = arena.bytesInUse;
+  }
+  else
+  {
+    /* Default manager: only sampled at the phase boundaries */
+    size_t allocBytes, allocBuffers, lockBuffers;
+    af::deviceMemInfo(&allocBytes, &allocBuffers, &bytesInUse, &lockBuffers);
+    arena.lock.lock();
+    recordUsage(bytesInUse);
+  }
+
+  arena.currentPhase = -1;
+  for (int n=0; n < arena.phases.size(); n++)
+  {
+    if (arena.phases[n].name == name)
+    {
+      arena.currentPhase = n;
+    }
+  }
+  if (arena.currentPhase < 0)
+  {
+    phase newPhase;
+    newPhase.name      = name;
+    newPhase.peakBytes = 0;
+    arena.phases.push_back(newPhase);
+    arena.currentPhase = arena.phases.size() - 1;
+  }
+  recordUsage(bytesInUse);
+
+  arena.lock.unlock();
+}
+
+void memoryArena::endStep()
+{
+  if (!arenaActive)
+  {
+    size_t allocBytes, allocBuffers, lockBytes, lockBuffers;
+    af::deviceMemInfo(&allocBytes, &allocBuffers, &lockBytes, &lockBuffers);
+    std::lock_guard<std::mutex> guard(arena.lock);
+    recordUsage(lockBytes);
+    arena.bytesReserved = allocBytes;
+  }
+
+  std::lock_guard<std::mutex> guard(arena.lock);
+
+  if (params::printPerformanceReport)
+  {
+    PetscPrintf(PETSC_COMM_WORLD, "    ---Memory high-water marks--- \n");
+    for (int n=0; n < arena.phases.size(); n++)
+    {
+      PetscPrintf(PETSC_COMM_WORLD, "     %-20s: %g MB\n",
+                                    arena.phases[n].name.c_str(),
+                                    arena.phases[n].peakBytes/1e6
+                 );
+    }
+  }
+  for (int n=0; n < arena.phases.size(); n++)
+  {
+    arena.phases[n].peakBytes = 0;
+  }
+
+#ifdef GRIM_MEMORY_ARENA_AVAILABLE
+  if (arenaActive)
+  {
+    /* Keep only as many free blocks as the step needed */
+    std::map<size_t, sizeClass>::iterator it;
+    for (it = arena.sizeClasses.begin(); it != arena.sizeClasses.end(); it++)
+    {
+      sizeClass &sizes = it->second;
+      releaseFreeBlocks(manager, sizes, it->first,
+                        sizes.peakInUse - sizes.numInUse
+                       );
+      sizes.peakInUse = sizes.numInUse;
+    }
+  }
+#endif
+
+  if (params::printPerformanceReport)
+  {
+    PetscPrintf(PETSC_COMM_WORLD, "     Reserved            : %g MB\n",
+                                  arena.bytesReserved/1e6
+               );
+  }
+  arena.currentPhase = -1;
+}
+
+void memoryArena::finalize()
+{
+#ifdef GRIM_MEMORY_ARENA_AVAILABLE
+  if (arenaActive)
+  {
+    /* All arrays must have been released, see grim.cpp */
+    af_unset_memory_manager();
+    af_release_memory_manager(manager);
+    arenaActive = false;
+  }
+#endif
+}
@@ -0,0 +1,39 @@
+#ifndef GRIM_MEMORYARENA_H_
+#define GRIM_MEMORYARENA_H_
+
+#include <cstddef>
+
+/* Custom ArrayFire memory manager. Every residual evaluation creates many
+ * short-lived temporaries; this arena keeps the freed buffers in free lists
+ * of fixed size classes and hands them out again, so that malloc/free is
+ * taken out of the hot path. Buffers whose size is a multiple of one grid
+ * (N1Total x N2Total x N3Total doubles) get their own exact size class, all
+ * the others are rounded up to a power of two.
+ *
+ * The time step is split into named phases and the peak number of bytes in
+ * use is recorded for each of them. At the end of every time step the peaks
+ * are reported (with params::printPerformanceReport) and the free lists are
+ * trimmed back to what the step actually needed, which bounds the memory
+ * held by the arena.
+ *
+ * Needs the memory manager API of ArrayFire >= 3.7. With older versions, or
+ * with params::memoryArena = 0, ArrayFire's own manager is kept and the
+ * functions below only report what deviceMemInfo() gives. grim uses a single
+ * device per MPI rank, which is all that the arena supports. */
+namespace memoryArena
+{
+  /* Must be called before the first af::array is allocated */
+  void initialize();
+
+  /* Size class of grid-sized buffers, in zones. Set by the first grid that
+   * is created, before its vars are allocated; grids at another resolution
+   * created later do not change it */
+  void setGridSize(const int N1Total, const int N2Total, const int N3Total);
+
+  void beginPhase(const char *name);
+  void endStep();
+
+  void finalize();
+}
+
+#endif /* GRIM_MEMORYARENA_H_ */
@@ -0,0 +1,105 @@
+#ifndef GRIM_NATIVEBUFFERS_H_
+#define GRIM_NATIVEBUFFERS_H_
+
+#include <vector>
+#include <arrayfire.h>
+
+/* Access to the contiguous host buffers behind af::array on the CPU backend,
+ * used by the hand-fused OpenMP/SIMD kernels of the native backend (ARCH set
+ * to Native in CMakeLists.txt, which defines GRIM_NATIVE_KERNELS). The data
+ * stays in af::array containers so that the rest of the code is untouched;
+ * the kernels only borrow the buffers for the duration of a loop. */
+namespace native
+{
+  class bufferSet
+  {
+    std::vector<const af::array *> lockedArrays;
+
+    /* Kernels may still be queued: initially, and after every eval() */
+    bool isPending;
+
+    /* eval() only queues the JIT kernel on the (asynchronous) CPU backend,
+     * and af_get_raw_ptr() does not wait for it, unlike device() */
+    void queueEval(const af::array &a)
+    {
+      a.eval();
+      isPending = true;
+    }
+
+    /* The raw pointer is the start of the buffer of the parent array, with
+     * no copy; lock() keeps the memory manager from reusing it. Waits for
+     * the queued kernels first, so that no input is read before it is
+     * computed and no buffer is written while a kernel still writes it */
+    double *inPlace(const af::array &a)
+    {
+      if (isPending)
+      {
+        af::sync();
+        isPending = false;
+      }
+
+      void *base;
+      dim_t offset;
+      af_get_raw_ptr(&base, a.get());
+      af_get_offset(&offset, a.get());
+      a.lock();
+      lockedArrays.push_back(&a);
+      return (double *)base + offset;
+    }
+
+    public:
+      bufferSet() : isPending(true) {}
+
+      /* Pending JIT expressions in a are evaluated first. device() would
+       * deep copy a view (the vars of a grid set from its varsSoA) or a
+       * buffer shared with another array (q and qTilde) to give it a buffer
+       * of its own, which a read does not need: a contiguous array is read
+       * in place, from the buffer of its parent plus its offset */
+      const double *read(const af::array &a)
+      {
+        queueEval(a);
+        if (a.isLinear())
+        {
+          return inPlace(a);
+        }
+        lockedArrays.push_back(&a);
+        return a.device<double>();
+      }
+
+      /* Gives a a freshly allocated buffer so that no other array shares
+       * it, and returns it for writing */
+      double *write(af::array &a, const af::dim4 &dims)
+      {
+        a = af::array(dims, f64);
+        return inPlace(a);
+      }
+
+      /* Read-write access to the data of a, for kernels that only update
+       * some zones in place. Written in place when no other array shares
+       * the buffer of a; otherwise device() first gives a a buffer of its
+       * own, so that the update does not leak into the other arrays */
+      double *update(af::array &a)
+      {
+        queueEval(a);
+        int useCount = 0;
+        af_get_data_ref_count(&useCount, a.get());
+        if (a.isLinear() && useCount == 1)
+        {
+          return inPlace(a);
+        }
+        lockedArrays.push_back(&a);
+        return a.device<double>();
+      }
+
+      /* Hand the buffers back to ArrayFire */
+      ~bufferSet()
+      {
+        for (int i=0; i<lockedArrays.size(); i++)
+        {
+          lockedArrays[i]->unlock();
+        }
+      }
+  };
+}
+
+#endif /* GRIM_NATIVEBUFFERS_H_ */
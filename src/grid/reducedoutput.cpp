@@ -0,0 +1,285 @@
+#include "reducedoutput.hpp"
+#include "dumpwriter.hpp"
+#include <algorithm>
+#include <fstream>
+
+namespace
+{
+  /* H5Lexists() needs every group along path to exist */
+  bool linkExists(const hid_t file, const std::string path)
+  {
+    size_t end = 0;
+    do
+    {
+      end = path.find('/', end + 1);
+      if (H5Lexists(file, path.substr(0, end).c_str(), H5P_DEFAULT) <= 0)
+      {
+        return false;
+      }
+    } while (end != std::string::npos);
+
+    return true;
+  }
+
+  /* The dumps may be written by another thread at the same time */
+  void waitForDumpsIfNotThreadSafe()
+  {
+    hbool_t isThreadSafe = false;
+    H5is_library_threadsafe(&isThreadSafe);
+    if (!isThreadSafe)
+    {
+      dumpWriter::wait();
+    }
+  }
+}
+
+reducedOutputFile::reducedOutputFile(const std::string fileName,
+                                     const bool append
+                                    )
+{
+  this->fileName = fileName;
+  file = -1;
+
+  int rank;
+  MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+  isActive = (rank == 0);
+  if (!isActive)
+  {
+    return;
+  }
+
+  waitForDumpsIfNotThreadSafe();
+
+  if (append && std::ifstream(fileName.c_str()).good())
+  {
+    hid_t existing = H5Fopen(fileName.c_str(), H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (linkExists(existing, "time"))
+    {
+      hid_t dataset = H5Dopen2(existing, "time", H5P_DEFAULT);
+      hid_t space   = H5Dget_space(dataset);
+      times.resize(H5Sget_simple_extent_npoints(space));
+      if (times.size() > 0)
+      {
+        H5Dread(dataset, H5T_NATIVE_DOUBLE, H5S_ALL, H5S_ALL, H5P_DEFAULT,
+                &times[0]
+               );
+      }
+      H5Sclose(space);
+      H5Dclose(dataset);
+    }
+    H5Fclose(existing);
+    return;
+  }
+
+  file = H5Fcreate(fileName.c_str(), H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+  H5Fclose(file);
+  file = -1;
+}
+
+void reducedOutputFile::beginRow(const double time)
+{
+  if (!isActive)
+  {
+    return;
+  }
+
+  waitForDumpsIfNotThreadSafe();
+
+  /* Drop the rows this one replaces */
+  times.erase(std::lower_bound(times.begin(), times.end(), time),
+              times.end()
+             );
+  times.push_back(time);
+
+  file = H5Fopen(fileName.c_str(), H5F_ACC_RDWR, H5P_DEFAULT);
+  write("time", 0, NULL, &time);
+}
+
+void reducedOutputFile::write(const std::string datasetName,
+                              const int rowRank, const int rowDims[],
+                              const double *data
+                             )
+{
+  if (!isActive)
+  {
+    return;
+  }
+
+  const hsize_t row = times.size() - 1;
+  hsize_t dims[3], maxDims[3], chunkDims[3], offset[3], count[3];
+  dims[0] = row + 1; maxDims[0] = H5S_UNLIMITED; chunkDims[0] = 1;
+  offset[0] = row; count[0] = 1;
+  for (int d=0; d<rowRank; d++)
+  {
+    dims[d+1]   = rowDims[d];
+    maxDims[d+1] = rowDims[d];
+    chunkDims[d+1] = rowDims[d];
+    offset[d+1] = 0;
+    count[d+1]  = rowDims[d];
+  }
+  const int rank = rowRank + 1;
+
+  hid_t dataset;
+  if (linkExists(file, datasetName))
+  {
+    dataset = H5Dopen2(file, datasetName.c_str(), H5P_DEFAULT);
+    /* Shrinks the dataset as well, after a restart */
+    H5Dset_extent(dataset, dims);
+  }
+  else
+  {
+    hid_t links    = H5Pcreate(H5P_LINK_CREATE);
+    hid_t creation = H5Pcreate(H5P_DATASET_CREATE);
+    H5Pset_create_intermediate_group(links, 1);
+    H5Pset_chunk(creation, rank, chunkDims);
+    if (params::dumpCompressionLevel > 0)
+    {
+      H5Pset_shuffle(creation);
+      H5Pset_deflate(creation, params::dumpCompressionLevel);
+    }
+    hid_t space = H5Screate_simple(rank, dims, maxDims);
+    dataset = H5Dcreate2(file, datasetName.c_str(), H5T_NATIVE_DOUBLE, space,
+                         links, creation, H5P_DEFAULT
+                        );
+    H5Sclose(space);
+    H5Pclose(creation);
+    H5Pclose(links);
+  }
+
+  hid_t fileSpace = H5Dget_space(dataset);
+  hid_t memSpace  = H5Screate_simple(rank, count, NULL);
+  H5Sselect_hyperslab(fileSpace, H5S_SELECT_SET, offset, NULL, count, NULL);
+  H5Dwrite(dataset, H5T_NATIVE_DOUBLE, memSpace, fileSpace, H5P_DEFAULT,
+           data
+          );
+  H5Sclose(memSpace);
+  H5Sclose(fileSpace);
+  H5Dclose(dataset);
+}
+
+void reducedOutputFile::endRow()
+{
+  if (!isActive)
+  {
+    return;
+  }
+
+  /* Closed after every row, so that the file is complete if the run stops */
+  H5Fclose(file);
+  file = -1;
+}
+
+std::vector<double> reductions::shellSums(const grid &layout,
+                                          const int numIntegrands,
+                                          const array integrands[]
+                                         )
+{
+  const af::seq domainX1 = *layout.domainX1;
+  const af::seq domainX2 = *layout.domainX2;
+  const af::seq domainX3 = *layout.domainX3;
+
+  /* All the sums in one transfer to the host */
+  array sums(layout.N1Local, numIntegrands, f64);
+  for (int n=0; n<numIntegrands; n++)
+  {
+    sums(span, n) = af::sum(af::sum(integrands[n](domainX1,
+                                                  domainX2,
+                                                  domainX3
+                                                 ), 2
+                                   ), 1
+                           );
+  }
+  std::vector<double> localSums(sums.elements());
+  sums.host(&localSums[0]);
+
+  std::vector<double> profiles((size_t)numIntegrands*layout.N1, 0.);
+  for (int n=0; n<numIntegrands; n++)
+  {
+    for (int i=0; i<layout.N1Local; i++)
+    {
+      profiles[n*layout.N1 + layout.iLocalStart + i]
+        = localSums[i + n*layout.N1Local];
+    }
+  }
+
+  int rank;
+  MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+  MPI_Reduce(rank == 0 ? MPI_IN_PLACE : &profiles[0], &profiles[0],
+             profiles.size(), MPI_DOUBLE, MPI_SUM, 0, PETSC_COMM_WORLD
+            );
+
+  return profiles;
+}
+
+std::vector<double> reductions::planes(const grid &layout,
+                                       const int numVars, const array vars[],
+                                       const int direction,
+                                       const int planeIndex
+                                      )
+{
+  const af::seq domainX1 = *layout.domainX1;
+
+  /* Second direction of the plane */
+  int N, NLocal, localStart;
+  bool hasPlane;
+  if (direction == directions::X2)
+  {
+    N = layout.N3; NLocal = layout.N3Local; localStart = layout.kLocalStart;
+    hasPlane =    planeIndex >= layout.jLocalStart
+               && planeIndex <  layout.jLocalEnd;
+  }
+  else
+  {
+    N = layout.N2; NLocal = layout.N2Local; localStart = layout.jLocalStart;
+    hasPlane =    planeIndex >= layout.kLocalStart
+               && planeIndex <  layout.kLocalEnd;
+  }
+
+  /* The zones of a rank that does not hold the plane stay 0 in the sum */
+  std::vector<double> slices((size_t)numVars*N*layout.N1, 0.);
+  if (hasPlane)
+  {
+    array localSlices(layout.N1Local, NLocal, numVars, f64);
+    for (int var=0; var<numVars; var++)
+    {
+      if (direction == directions::X2)
+      {
+        const int j = planeIndex - layout.jLocalStart + layout.numGhostX2;
+        localSlices(span, span, var)
+          = af::moddims(vars[var](domainX1, j, *layout.domainX3),
+                        layout.N1Local, NLocal
+                       );
+      }
+      else
+      {
+        const int k = planeIndex - layout.kLocalStart + layout.numGhostX3;
+        localSlices(span, span, var)
+          = vars[var](domainX1, *layout.domainX2, k);
+      }
+    }
+    std::vector<double> local(localSlices.elements());
+    localSlices.host(&local[0]);
+
+    for (int var=0; var<numVars; var++)
+    {
+      for (int n=0; n<NLocal; n++)
+      {
+        for (int i=0; i<layout.N1Local; i++)
+        {
+          slices[  layout.iLocalStart + i
+                 + layout.N1*(localStart + n + (size_t)N*var)
+                ]
+            = local[i + layout.N1Local*(n + (size_t)NLocal*var)];
+        }
+      }
+    }
+  }
+
+  int rank;
+  MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+  MPI_Reduce(rank == 0 ? MPI_IN_PLACE : &slices[0], &slices[0],
+             slices.size(), MPI_DOUBLE, MPI_SUM, 0, PETSC_COMM_WORLD
+            );
+
+  return slices;
+}
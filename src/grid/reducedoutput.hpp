@@ -0,0 +1,60 @@
+#ifndef GRIM_REDUCEDOUTPUT_H_
+#define GRIM_REDUCEDOUTPUT_H_
+
+#include <string>
+#include <vector>
+#include <hdf5.h>
+#include "grid.hpp"
+
+/* Small outputs reduced in situ from the grid (radial profiles, slices, time
+ * series of scalars), cheap enough to be written far more often than the full
+ * dumps. The reductions run on the device; only their result goes through MPI
+ * to rank 0, which alone writes the file.
+ *
+ * Every dataset of the file is appendable: its first dimension is the row,
+ * one per output, and the dataset "time" holds the time of every row. A
+ * restarted run appends to the file of the run it continues; the rows at or
+ * after the time it restarts from are overwritten, so the file never holds
+ * two histories. */
+class reducedOutputFile
+{
+  std::string fileName;
+  bool isActive;
+  hid_t file;
+  std::vector<double> times;
+
+  public:
+    /* With append, rows are added to an existing fileName */
+    reducedOutputFile(const std::string fileName, const bool append);
+
+    void beginRow(const double time);
+
+    /* One row of datasetName ("profiles/rho" creates the group profiles),
+     * shape rowDims[0] x ... x rowDims[rowRank-1] with the last the fastest.
+     * data is only read on rank 0 */
+    void write(const std::string datasetName,
+               const int rowRank, const int rowDims[], const double *data
+              );
+
+    void endRow();
+};
+
+namespace reductions
+{
+  /* Sums over X2 and X3 of the interior of every integrand (N1Total x
+   * N2Total x N3Total), for every zone in X1: numIntegrands x N1 on rank 0,
+   * integrand n in [n*N1, (n+1)*N1) */
+  std::vector<double> shellSums(const grid &layout, const int numIntegrands,
+                                const array integrands[]
+                               );
+
+  /* Interior of every var on the plane at global index planeIndex along
+   * direction (directions::X2 or directions::X3): numVars x N3 x N1 or
+   * numVars x N2 x N1 on rank 0, N1 the fastest */
+  std::vector<double> planes(const grid &layout, const int numVars,
+                             const array vars[],
+                             const int direction, const int planeIndex
+                            );
+}
+
+#endif /* GRIM_REDUCEDOUTPUT_H_ */
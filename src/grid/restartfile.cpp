@@ -0,0 +1,181 @@
+#include "restartfile.hpp"
+#include <cstring>
+#include <cstddef>
+#include <cstdio>
+#include <vector>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace
+{
+  const char MAGIC[8] = {'G', 'R', 'I', 'M', 'R', 'S', 'T', '1'};
+
+  /* Everything that has to match for the data to be reused as it is */
+  struct restartHeader
+  {
+    char magic[8];
+    int numProcs, rank;
+    int dim, numVars, numGhost;
+    int N1, N2, N3;
+    int iLocalStart, jLocalStart, kLocalStart;
+    int N1Local, N2Local, N3Local;
+    int N1Total, N2Total, N3Total;
+    int padding;
+
+    double time, dt;
+    long long int step;
+  };
+
+  restartHeader headerOf(const grid &prim)
+  {
+    restartHeader header;
+    memset(&header, 0, sizeof(restartHeader));
+    memcpy(header.magic, MAGIC, sizeof(MAGIC));
+
+    MPI_Comm_size(PETSC_COMM_WORLD, &header.numProcs);
+    MPI_Comm_rank(PETSC_COMM_WORLD, &header.rank);
+    header.dim         = prim.dim;
+    header.numVars     = prim.numVars;
+    header.numGhost    = prim.numGhost;
+    header.N1          = prim.N1;
+    header.N2          = prim.N2;
+    header.N3          = prim.N3;
+    header.iLocalStart = prim.iLocalStart;
+    header.jLocalStart = prim.jLocalStart;
+    header.kLocalStart = prim.kLocalStart;
+    header.N1Local     = prim.N1Local;
+    header.N2Local     = prim.N2Local;
+    header.N3Local     = prim.N3Local;
+    header.N1Total     = prim.N1Total;
+    header.N2Total     = prim.N2Total;
+    header.N3Total     = prim.N3Total;
+
+    return header;
+  }
+
+  /* Compares the layout part of the header, up to time */
+  bool sameLayout(const restartHeader &a, const restartHeader &b)
+  {
+    return memcmp(&a, &b, offsetof(restartHeader, time)) == 0;
+  }
+}
+
+std::string restartFile::fileBaseOf(const std::string fileName)
+{
+  const size_t extension = fileName.rfind(".h5");
+  if (extension == std::string::npos)
+  {
+    return fileName;
+  }
+  return fileName.substr(0, extension);
+}
+
+std::string restartFile::rankFileName(const std::string fileBase)
+{
+  int rank;
+  MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+
+  char suffix[32];
+  snprintf(suffix, sizeof(suffix), ".rank%05d.bin", rank);
+
+  return fileBase + suffix;
+}
+
+void restartFile::write(const grid &prim, const std::string fileBase,
+                        const double time, const double dt,
+                        const long long int step
+                       )
+{
+  restartHeader header = headerOf(prim);
+  header.time = time;
+  header.dt   = dt;
+  header.step = step;
+
+  const size_t numData = (size_t)prim.N1Total*prim.N2Total*prim.N3Total
+                         *prim.numVars;
+  const size_t numBytes = sizeof(restartHeader) + numData*sizeof(double);
+
+  /* Header and data are put together so that one pwrite() does it all */
+  std::vector<char> buffer(numBytes);
+  memcpy(&buffer[0], &header, sizeof(restartHeader));
+  prim.getVarsSoA().host(&buffer[sizeof(restartHeader)]);
+
+  const std::string fileName = rankFileName(fileBase);
+  int fd = open(fileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    printf("Could not open %s for writing\n", fileName.c_str());
+    return;
+  }
+  size_t numWritten = 0;
+  while (numWritten < numBytes)
+  {
+    const ssize_t n = pwrite(fd, &buffer[numWritten], numBytes - numWritten,
+                             numWritten
+                            );
+    if (n <= 0)
+    {
+      printf("Could not write %s\n", fileName.c_str());
+      break;
+    }
+    numWritten += n;
+  }
+  close(fd);
+}
+
+bool restartFile::read(grid &prim, const std::string fileBase,
+                       double &time, double &dt, long long int &step
+                      )
+{
+  const restartHeader expected = headerOf(prim);
+  const size_t numData = (size_t)prim.N1Total*prim.N2Total*prim.N3Total
+                         *prim.numVars;
+  const size_t numBytes = sizeof(restartHeader) + numData*sizeof(double);
+
+  const std::string fileName = rankFileName(fileBase);
+  void *mapped = MAP_FAILED;
+  int fd = open(fileName.c_str(), O_RDONLY);
+  if (fd >= 0)
+  {
+    struct stat fileInfo;
+    if (fstat(fd, &fileInfo) == 0 && (size_t)fileInfo.st_size == numBytes)
+    {
+      mapped = mmap(NULL, numBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);
+  }
+
+  int isUsable = 0;
+  restartHeader header;
+  if (mapped != MAP_FAILED)
+  {
+    memcpy(&header, mapped, sizeof(restartHeader));
+    isUsable = sameLayout(header, expected);
+  }
+
+  /* Either every rank uses its file or none does */
+  int allUsable;
+  MPI_Allreduce(&isUsable, &allUsable, 1, MPI_INT, MPI_MIN, PETSC_COMM_WORLD);
+
+  if (allUsable)
+  {
+    const double *data = (const double *)((const char *)mapped
+                                          + sizeof(restartHeader)
+                                         );
+    prim.setVarsFromSoA(array(prim.N1Total, prim.N2Total, prim.N3Total,
+                              prim.numVars, data
+                             )
+                       );
+    time = header.time;
+    dt   = header.dt;
+    step = header.step;
+  }
+  if (mapped != MAP_FAILED)
+  {
+    munmap(mapped, numBytes);
+  }
+
+  return allUsable;
+}
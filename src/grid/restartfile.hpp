@@ -0,0 +1,34 @@
+#ifndef GRIM_RESTARTFILE_H_
+#define GRIM_RESTARTFILE_H_
+
+#include <string>
+#include "grid.hpp"
+
+/* N-to-N raw restart files: every rank writes its own file,
+ *
+ *   fileBase.rankNNNNN.bin = header + vars of the rank (SoA, ghost zones
+ *                            included, N1Total x N2Total x N3Total x numVars)
+ *
+ * with a single pwrite(), and a restart with the same decomposition maps it
+ * back with mmap() instead of the collective HDF5 read of grid::load(). The
+ * header records the decomposition, so read() can tell whether the files can
+ * be used; if any rank cannot, all of them return false and the caller falls
+ * back to the HDF5 restart file, which must therefore be written as well. */
+namespace restartFile
+{
+  /* fileBase of the HDF5 restart file fileName: fileName without .h5 */
+  std::string fileBaseOf(const std::string fileName);
+
+  std::string rankFileName(const std::string fileBase);
+
+  void write(const grid &prim, const std::string fileBase,
+             const double time, const double dt, const long long int step
+            );
+
+  /* Collective */
+  bool read(grid &prim, const std::string fileBase,
+            double &time, double &dt, long long int &step
+           );
+}
+
+#endif /* GRIM_RESTARTFILE_H_ */
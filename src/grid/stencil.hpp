@@ -0,0 +1,447 @@
+#ifndef GRIM_STENCIL_H_
+#define GRIM_STENCIL_H_
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <arrayfire.h>
+#include "../params.hpp"
+#ifdef GRIM_NATIVE_KERNELS
+  #include "nativebuffers.hpp"
+#endif
+
+/* Stencil expressions. A stencil kernel is a functor with a templated
+ *
+ *   template <typename field, typename T>
+ *   void operator()(const field in[], T out[]) const
+ *
+ * which reads in[n](di, dj, dk), the n'th input at offset (di, dj, dk) from
+ * the zone being computed, and writes out[m]. The kernel also declares its
+ * counts as compile-time constants,
+ *
+ *   static const int numInputs, numOutputs;
+ *
+ * which size the field and result arrays of every zone; kernels whose counts
+ * depend on dim or on the number of variables are templated on them.
+ * stencil::apply() lowers the kernel in one of two ways:
+ *
+ *  1) ArrayFire (default): T is af::array and in[n](di, dj, dk) is
+ *     af::shift(in, -di, -dj, -dk). Nothing is evaluated until all the
+ *     outputs are evaluated together, so the whole stencil becomes a single
+ *     JIT kernel and no shifted copy is materialised.
+ *
+ *  2) Native (GRIM_NATIVE_KERNELS): T is double and the kernel is called
+ *     once per zone inside one OpenMP loop over the interior plus the ghost
+ *     width. Neighbours are plain loads at fixed strides; only the outer
+ *     layer of width radius takes the slower periodic-wrap path, which
+ *     matches the af::shift semantics of the other lowering.
+ *
+ * Directions of size 1 ignore offsets, like af::shift. A 4th array
+ * dimension (for ex, variables stacked by grid::varsSoA) is carried along
+ * and never mixed by the stencil.
+ *
+ * Kernels should use the functions below (stencil::min, max, abs, sqrt) and
+ * arithmetic on comparisons, e.g. (x > 0.)*y, so that both lowerings
+ * compile from the same source. */
+namespace stencil
+{
+  inline double min(const double a, const double b) { return a < b ? a : b; }
+  inline double max(const double a, const double b) { return a > b ? a : b; }
+  inline double abs(const double a)  { return std::fabs(a); }
+  inline double sqrt(const double a) { return std::sqrt(a); }
+
+  inline af::array min(const af::array &a, const af::array &b)
+  {
+    return af::min(a, b);
+  }
+  inline af::array min(const af::array &a, const double b)
+  {
+    return af::min(a, b);
+  }
+  inline af::array max(const af::array &a, const af::array &b)
+  {
+    return af::max(a, b);
+  }
+  inline af::array max(const af::array &a, const double b)
+  {
+    return af::max(a, b);
+  }
+  inline af::array abs(const af::array &a)  { return af::abs(a);  }
+  inline af::array sqrt(const af::array &a) { return af::sqrt(a); }
+
+  /* Offsets (di, dj, dk) of a point that is offset away along dir */
+  inline int offsetX1(const int dir, const int offset)
+  {
+    return (dir==directions::X1 ? offset : 0);
+  }
+  inline int offsetX2(const int dir, const int offset)
+  {
+    return (dir==directions::X2 ? offset : 0);
+  }
+  inline int offsetX3(const int dir, const int offset)
+  {
+    return (dir==directions::X3 ? offset : 0);
+  }
+
+  /* Zones first <= n <= last of in along dir, with all of them along the
+   * other directions and the 4th dimension */
+  inline af::array rows(const af::array &in, const int dir,
+                        const int first, const int last
+                       )
+  {
+    const af::seq range(first, last);
+    switch (dir)
+    {
+      case directions::X1:
+        return in(range, af::span, af::span, af::span);
+      case directions::X2:
+        return in(af::span, range, af::span, af::span);
+      default:
+        return in(af::span, af::span, range, af::span);
+    }
+  }
+
+  class arrayField
+  {
+    const af::array *in;
+
+    public:
+      arrayField() : in(NULL) {}
+      arrayField(const af::array &in_) : in(&in_) {}
+
+      af::array operator()(const int di, const int dj, const int dk) const
+      {
+        if (di==0 && dj==0 && dk==0)
+        {
+          return *in;
+        }
+        return af::shift(*in, -di, -dj, -dk);
+      }
+
+      af::array at(const int dir, const int offset) const
+      {
+        return (*this)(offsetX1(dir, offset),
+                       offsetX2(dir, offset),
+                       offsetX3(dir, offset)
+                      );
+      }
+  };
+
+  /* Zone away from the outer layer: neighbours at fixed strides. A stride of
+   * 0 is used for directions of size 1. */
+  class directField
+  {
+    const double *in;
+    int s1, s2, s3;
+
+    public:
+      /* Left uninitialized: the arrays of fields are filled right away */
+      directField() {}
+      directField(const double *in_,
+                  const int s1_, const int s2_, const int s3_
+                 ) : in(in_), s1(s1_), s2(s2_), s3(s3_) {}
+
+      /* Same field, centered i zones further along X1 */
+      directField shifted(const int i) const
+      {
+        return directField(in + i, s1, s2, s3);
+      }
+
+      double operator()(const int di, const int dj, const int dk) const
+      {
+        return in[di*s1 + dj*s2 + dk*s3];
+      }
+
+      double at(const int dir, const int offset) const
+      {
+        return (*this)(offsetX1(dir, offset),
+                       offsetX2(dir, offset),
+                       offsetX3(dir, offset)
+                      );
+      }
+  };
+
+  /* Zone in the outer layer: periodic wrap, as af::shift */
+  class wrappedField
+  {
+    const double *in;
+    int i, j, k, N1, N2, N3;
+
+    static int wrap(const int i, const int N)
+    {
+      return ((i % N) + N) % N;
+    }
+
+    public:
+      wrappedField() {}
+      wrappedField(const double *in_,
+                   const int i_, const int j_, const int k_,
+                   const int N1_, const int N2_, const int N3_
+                  ) : in(in_), i(i_), j(j_), k(k_),
+                      N1(N1_), N2(N2_), N3(N3_) {}
+
+      double operator()(const int di, const int dj, const int dk) const
+      {
+        return in[  wrap(i + di, N1)
+                  + N1*(wrap(j + dj, N2) + N2*wrap(k + dk, N3))
+                 ];
+      }
+
+      double at(const int dir, const int offset) const
+      {
+        return (*this)(offsetX1(dir, offset),
+                       offsetX2(dir, offset),
+                       offsetX3(dir, offset)
+                      );
+      }
+  };
+
+  namespace detail
+  {
+    template <typename kernel>
+    inline void wrappedZone(const kernel &k,
+                            const double * const inPtrs[],
+                            double * const outPtrs[],
+                            const int slabOffset,
+                            const int outSlabOffset,
+                            const int i, const int j, const int kk,
+                            const int N1, const int N2, const int N3
+                           )
+    {
+      wrappedField fields[kernel::numInputs];
+      double results[kernel::numOutputs];
+      for (int n=0; n<kernel::numInputs; n++)
+      {
+        fields[n] = wrappedField(inPtrs[n] + slabOffset,
+                                 i, j, kk, N1, N2, N3
+                                );
+      }
+      k(fields, results);
+
+      const int zone = outSlabOffset + i + N1*(j + N2*kk);
+      for (int n=0; n<kernel::numOutputs; n++)
+      {
+        outPtrs[n][zone] = results[n];
+      }
+    }
+
+#ifdef GRIM_NATIVE_KERNELS
+    /* Native lowering of apply() and applyInterleaved(). Slab l of output n
+     * starts at outPtrs[n] + l*outSlabStride */
+    template <typename kernel>
+    void applyNative(const kernel &k,
+                     const int radius,
+                     const double * const inPtrs[],
+                     double * const outPtrs[],
+                     const af::dim4 &dims,
+                     const int outSlabStride
+                    )
+    {
+      const int N1 = dims[0], N2 = dims[1], N3 = dims[2];
+      const int numSlabs   = dims[3];
+      const int slabStride = N1*N2*N3;
+
+      /* Width of the layer needing the wrapped path, per direction */
+      const int r1 = (N1 > 1 ? radius : 0);
+      const int r2 = (N2 > 1 ? radius : 0);
+      const int r3 = (N3 > 1 ? radius : 0);
+      const int s1 = (N1 > 1 ? 1     : 0);
+      const int s2 = (N2 > 1 ? N1    : 0);
+      const int s3 = (N3 > 1 ? N1*N2 : 0);
+
+      const int iStart = std::min(r1, N1);
+      const int iEnd   = std::max(N1 - r1, iStart);
+
+      #pragma omp parallel for collapse(3)
+      for (int l=0; l<numSlabs; l++)
+      {
+        for (int kk=0; kk<N3; kk++)
+        {
+          for (int j=0; j<N2; j++)
+          {
+            const int rowOffset    = l*slabStride    + N1*(j + N2*kk);
+            const int outRowOffset = l*outSlabStride + N1*(j + N2*kk);
+            const bool interiorRow =    j  >= r2 && j  < N2 - r2
+                                     && kk >= r3 && kk < N3 - r3;
+
+            if (!interiorRow)
+            {
+              for (int i=0; i<N1; i++)
+              {
+                detail::wrappedZone(k, inPtrs, outPtrs,
+                                    l*slabStride, l*outSlabStride,
+                                    i, j, kk, N1, N2, N3
+                                   );
+              }
+              continue;
+            }
+
+            for (int i=0; i<iStart; i++)
+            {
+              detail::wrappedZone(k, inPtrs, outPtrs,
+                                  l*slabStride, l*outSlabStride,
+                                  i, j, kk, N1, N2, N3
+                                 );
+            }
+
+            /* Direct path for the bulk of the row. The fields are set up once
+             * per row; every zone only offsets them by i */
+            directField rowFields[kernel::numInputs];
+            double *rowOut[kernel::numOutputs];
+            for (int n=0; n<kernel::numInputs; n++)
+            {
+              rowFields[n] = directField(inPtrs[n] + rowOffset, s1, s2, s3);
+            }
+            for (int n=0; n<kernel::numOutputs; n++)
+            {
+              rowOut[n] = outPtrs[n] + outRowOffset;
+            }
+
+            #pragma omp simd
+            for (int i=iStart; i<iEnd; i++)
+            {
+              directField fields[kernel::numInputs];
+              double results[kernel::numOutputs];
+              for (int n=0; n<kernel::numInputs; n++)
+              {
+                fields[n] = rowFields[n].shifted(i);
+              }
+              k(fields, results);
+              for (int n=0; n<kernel::numOutputs; n++)
+              {
+                rowOut[n][i] = results[n];
+              }
+            }
+
+            for (int i=iEnd; i<N1; i++)
+            {
+              detail::wrappedZone(k, inPtrs, outPtrs,
+                                  l*slabStride, l*outSlabStride,
+                                  i, j, kk, N1, N2, N3
+                                 );
+            }
+          }
+        }
+      }
+    }
+#endif
+  }
+
+  /* Evaluates kernel on in[0..kernel::numInputs-1] into
+   * out[0..kernel::numOutputs-1]. All inputs must have the same dimensions.
+   * radius is the largest offset used by the kernel in any direction.
+   * Outputs must not alias inputs. */
+  template <typename kernel>
+  void apply(const kernel &k,
+             const int radius,
+             const af::array * const in[],
+             af::array * const out[]
+            )
+  {
+#ifndef GRIM_NATIVE_KERNELS
+    arrayField fields[kernel::numInputs];
+    af::array  results[kernel::numOutputs];
+    for (int n=0; n<kernel::numInputs; n++)
+    {
+      fields[n] = arrayField(*in[n]);
+    }
+
+    k(fields, results);
+
+    for (int n=0; n<kernel::numOutputs; n++)
+    {
+      *out[n] = results[n];
+    }
+    af::eval(kernel::numOutputs, const_cast<af::array **>(out));
+#else
+    const af::dim4 dims = in[0]->dims();
+    const int slabStride = dims[0]*dims[1]*dims[2];
+
+    native::bufferSet buffers;
+    const double *inPtrs[kernel::numInputs];
+    double *outPtrs[kernel::numOutputs];
+    for (int n=0; n<kernel::numInputs; n++)
+    {
+      inPtrs[n] = buffers.read(*in[n]);
+    }
+    for (int n=0; n<kernel::numOutputs; n++)
+    {
+      outPtrs[n] = buffers.write(*out[n], dims);
+    }
+
+    detail::applyNative(k, radius, inPtrs, outPtrs, dims, slabStride);
+#endif
+  }
+
+  /* As apply(), with the outputs interleaved in a single array along the
+   * 4th dimension: output n of slab l of the inputs is out(.., .., ..,
+   * n + kernel::numOutputs*l). For ex, the two face states of every variable
+   * of a varsSoA end up next to each other, so that the states of one
+   * variable are a contiguous view of out. */
+  template <typename kernel>
+  void applyInterleaved(const kernel &k,
+                        const int radius,
+                        const af::array * const in[],
+                        af::array &out
+                       )
+  {
+    const af::dim4 dims = in[0]->dims();
+    const int numSlabs   = dims[3];
+    const int slabStride = dims[0]*dims[1]*dims[2];
+#ifndef GRIM_NATIVE_KERNELS
+    arrayField fields[kernel::numInputs];
+    af::array  results[kernel::numOutputs];
+    for (int n=0; n<kernel::numInputs; n++)
+    {
+      fields[n] = arrayField(*in[n]);
+    }
+
+    k(fields, results);
+
+    /* (zone, output, slab) is the interleaved order */
+    out = af::moddims(results[0], slabStride, 1, numSlabs);
+    for (int n=1; n<kernel::numOutputs; n++)
+    {
+      out = af::join(1, out, af::moddims(results[n], slabStride, 1, numSlabs));
+    }
+    out = af::moddims(out, dims[0], dims[1], dims[2],
+                      kernel::numOutputs*numSlabs
+                     );
+    out.eval();
+#else
+    native::bufferSet buffers;
+    const double *inPtrs[kernel::numInputs];
+    double *outPtrs[kernel::numOutputs];
+    for (int n=0; n<kernel::numInputs; n++)
+    {
+      inPtrs[n] = buffers.read(*in[n]);
+    }
+    double *outBase = buffers.write(out, af::dim4(dims[0], dims[1], dims[2],
+                                                  kernel::numOutputs*numSlabs
+                                                 )
+                                   );
+    for (int n=0; n<kernel::numOutputs; n++)
+    {
+      outPtrs[n] = outBase + n*slabStride;
+    }
+
+    detail::applyNative(k, radius, inPtrs, outPtrs, dims,
+                        kernel::numOutputs*slabStride
+                       );
+#endif
+  }
+
+  /* Single input, single output */
+  template <typename kernel>
+  af::array apply(const kernel &k, const int radius, const af::array &in)
+  {
+    const af::array *inPtrs[] = {&in};
+    af::array out;
+    af::array *outPtrs[] = {&out};
+    apply(k, radius, inPtrs, outPtrs);
+
+    return out;
+  }
+}
+
+#endif /* GRIM_STENCIL_H_ */
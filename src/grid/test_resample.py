@@ -0,0 +1,96 @@
+import os
+import mpi4py, petsc4py
+import numpy as np
+import pytest
+import gridPy
+
+petsc4py.init()
+petscComm  = petsc4py.PETSc.COMM_WORLD
+comm = petscComm.tompi4py()
+rank = comm.Get_rank()
+numProcs = comm.Get_size()
+
+N1  = int(pytest.config.getoption('N1'))
+N2  = int(pytest.config.getoption('N2'))
+N3  = int(pytest.config.getoption('N3'))
+dim = int(pytest.config.getoption('dim'))
+numVars = 2
+numGhost = 3
+# The domain stored with the dumps is the one of the params, the same for
+# all the grids below
+X1Start = 0.; X1End = 1.
+X2Start = 0.; X2End = 1.
+X3Start = 0.; X3End = 1.
+
+def makeGrid(N1, N2, N3):
+  return gridPy.gridPy(N1, N2, N3, dim, numVars, numGhost, 0, 0, 0)
+
+def interior(grid):
+  kStart = numGhost if dim > 2 else 0
+  jStart = numGhost if dim > 1 else 0
+  return grid.getVars()[:,
+                        kStart:kStart + grid.N3Local,
+                        jStart:jStart + grid.N2Local,
+                        numGhost:numGhost + grid.N1Local
+                       ]
+
+def globalSum(grid):
+  return comm.allreduce(np.sum(interior(grid), axis=(1, 2, 3)))
+
+# A smooth variable and a step, for which the MC slopes are limited
+coarse = makeGrid(N1, N2, N3)
+XCoords = gridPy.coordinatesGridPy(N1, N2, N3,
+                                   dim, numGhost,
+                                   X1Start, X1End,
+                                   X2Start, X2End,
+                                   X3Start, X3End
+                                  )
+X1Coords, X2Coords, X3Coords = XCoords.getCoords(gridPy.CENTER)
+coarseVars = np.zeros(coarse.shape)
+coarseVars[0] = 1. + 0.5*np.sin(2.*np.pi*X1Coords) \
+                         *np.cos(2.*np.pi*X2Coords) \
+                         *np.cos(2.*np.pi*X3Coords)
+coarseVars[1] = np.where(X1Coords + X2Coords + X3Coords < 0.8, 1., 10.)
+coarse.setVars(coarseVars)
+
+coarseFile = "resampleCoarse.h5"
+fineFile   = "resampleFine.h5"
+coarse.dump("primitives", coarseFile)
+
+def refined(N, factor, d):
+  return factor*N if d < dim else N
+
+def test_prolong_restrict_round_trip():
+  fine = makeGrid(refined(N1, 2, 0), refined(N2, 2, 1), refined(N3, 2, 2))
+  fine.load("primitives", coarseFile)
+  fine.dump("primitives", fineFile)
+
+  restricted = makeGrid(N1, N2, N3)
+  restricted.load("primitives", fineFile)
+
+  np.testing.assert_allclose(interior(restricted), interior(coarse),
+                             rtol=1e-12, atol=1e-12
+                            )
+  comm.Barrier()
+  if (rank == 0):
+    os.remove(fineFile)
+
+def test_resample_conserves_integral():
+  # Not a multiple of the coarse resolution: target zones straddle the
+  # source ones
+  fine = makeGrid(refined(N1, 3, 0)//2, refined(N2, 3, 1)//2,
+                  refined(N3, 3, 2)//2
+                 )
+  fine.load("primitives", coarseFile)
+
+  zoneVolumeRatio = (  float(coarse.N1*coarse.N2*coarse.N3)
+                     / (fine.N1*fine.N2*fine.N3)
+                    )
+  np.testing.assert_allclose(globalSum(fine)*zoneVolumeRatio,
+                             globalSum(coarse), rtol=1e-12
+                            )
+
+def teardown_module(module):
+  comm.Barrier()
+  if (rank == 0):
+    os.remove(coarseFile)
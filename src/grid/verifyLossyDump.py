@@ -0,0 +1,65 @@
+"""Round-trip check of the lossy dumps of dumpWriter.
+
+  python verifyLossyDump.py exact.h5 lossy.h5
+
+exact.h5 and lossy.h5 hold the same state, written without and with error
+bounds (for ex, restart twice from the same checkpoint, with LossyPrimVars
+set to 0 and to 1). Every dataset of lossy.h5 that has the attributes
+relativeError and absoluteError is compared with the same dataset of
+exact.h5. The script prints the largest error as a fraction of its bound and
+the size of both datasets on disk. It exits with 1 if a bound is exceeded.
+"""
+import sys
+import h5py
+import numpy as np
+
+if len(sys.argv) != 3:
+  print(__doc__)
+  sys.exit(2)
+
+exactFile = h5py.File(sys.argv[1], 'r')
+lossyFile = h5py.File(sys.argv[2], 'r')
+
+lossyNames = []
+def findLossy(name, obj):
+  if isinstance(obj, h5py.Dataset) and 'relativeError' in obj.attrs:
+    lossyNames.append(name)
+lossyFile.visititems(findLossy)
+
+if len(lossyNames) == 0:
+  print("No dataset of %s was written with error bounds" % sys.argv[2])
+  sys.exit(2)
+
+exactBytes = 0
+lossyBytes = 0
+isWithinBounds = True
+for name in lossyNames:
+  lossy = lossyFile[name]
+  exact = exactFile[name]
+  relative = lossy.attrs['relativeError']
+  absolute = lossy.attrs['absoluteError']
+
+  exactValues = exact[...]
+  bound = np.maximum(absolute, relative*np.abs(exactValues))
+  error = np.abs(lossy[...] - exactValues)
+  worst = np.max(error/np.where(bound > 0., bound, np.inf))
+
+  exactSize = exact.id.get_storage_size()
+  lossySize = lossy.id.get_storage_size()
+  exactBytes += exactSize
+  lossyBytes += lossySize
+
+  print("%-24s rel %.1e abs %.1e  max error/bound %.3f  %d -> %d bytes (%.2fx)"
+        % (name, relative, absolute, worst,
+           exactSize, lossySize, exactSize/float(max(lossySize, 1))
+          )
+       )
+  if worst > 1.:
+    isWithinBounds = False
+
+print("Lossy datasets: %d -> %d bytes (%.2fx)"
+      % (exactBytes, lossyBytes, exactBytes/float(max(lossyBytes, 1)))
+     )
+if not isWithinBounds:
+  print("Error bound exceeded")
+  sys.exit(1)
@@ -0,0 +1,163 @@
+#include "xdmf.hpp"
+#include "dumpwriter.hpp"
+#include <fstream>
+
+namespace
+{
+  const std::string trailer =   "    </Grid>\n"
+                                "  </Domain>\n"
+                                "</Xdmf>\n";
+}
+
+xdmfSeries::xdmfSeries(const std::string fileName, const grid &layout,
+                       const std::string coordinatesFile,
+                       const std::string coordinatesName,
+                       const bool append
+                      )
+  : xdmfSeries(fileName, layout.dim, layout.N1, layout.N2, layout.N3,
+               coordinatesFile, coordinatesName, append
+              )
+{
+}
+
+xdmfSeries::xdmfSeries(const std::string fileName,
+                       const int dim, const int N1, const int N2, const int N3,
+                       const std::string coordinatesFile,
+                       const std::string coordinatesName,
+                       const bool append
+                      )
+{
+  this->fileName = fileName;
+
+  int rank;
+  MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+  isActive = (rank == 0 && dim >= 2);
+  if (dim < 2)
+  {
+    PetscPrintf(PETSC_COMM_WORLD,
+                "  XDMF output needs dim >= 2, %s not written\n",
+                fileName.c_str()
+               );
+  }
+  if (!isActive)
+  {
+    return;
+  }
+
+  /* Slowest direction first, as the datasets */
+  std::stringstream dims;
+  if (dim == 3)
+  {
+    dims << N3 << " ";
+  }
+  dims << N2 << " " << N1;
+  dimensions = dims.str();
+
+  /* Mesh shared by every step */
+  std::stringstream xml;
+  xml << "        <Topology TopologyType=\""
+      << (dim == 3 ? "3DSMesh" : "2DSMesh")
+      << "\" Dimensions=\"" << dimensions << "\"/>\n"
+      << "        <Geometry GeometryType=\""
+      << (dim == 3 ? "X_Y_Z" : "X_Y") << "\">\n";
+  for (int d=0; d<dim; d++)
+  {
+    xml << "  ";
+    dataItem(xml, coordinatesFile,
+             dumpWriter::datasetName(coordinatesName, d)
+            );
+  }
+  xml << "        </Geometry>\n";
+  gridXML = xml.str();
+
+  /* Start a new index unless there is a complete one to append to */
+  if (append)
+  {
+    std::ifstream existing(fileName.c_str(), std::ios::binary);
+    std::stringstream contents;
+    contents << existing.rdbuf();
+    const std::string text = contents.str();
+    if (   text.size() >= trailer.size()
+        && text.compare(text.size() - trailer.size(), trailer.size(),
+                        trailer
+                       ) == 0
+       )
+    {
+      return;
+    }
+  }
+
+  std::ofstream index(fileName.c_str());
+  index << "<?xml version=\"1.0\" ?>\n"
+        << "<!DOCTYPE Xdmf SYSTEM \"Xdmf.dtd\" []>\n"
+        << "<Xdmf Version=\"2.0\">\n"
+        << "  <Domain>\n"
+        << "    <Grid Name=\"TimeSeries\" GridType=\"Collection\""
+        << " CollectionType=\"Temporal\">\n"
+        << trailer;
+}
+
+void xdmfSeries::dataItem(std::stringstream &xml,
+                          const std::string dataFile,
+                          const std::string dataset
+                         ) const
+{
+  xml << "          <DataItem Dimensions=\"" << dimensions << "\""
+      << " NumberType=\"Float\" Precision=\"8\" Format=\"HDF\">"
+      << dataFile << ":/" << dataset
+      << "</DataItem>\n";
+}
+
+void xdmfSeries::beginStep(const double time)
+{
+  if (!isActive)
+  {
+    return;
+  }
+
+  step.str("");
+  step.precision(17);
+  step << "      <Grid Name=\"mesh\" GridType=\"Uniform\">\n"
+       << "        <Time Value=\"" << time << "\"/>\n"
+       << gridXML;
+}
+
+void xdmfSeries::addVars(const std::string dataFile,
+                         const std::string varsName,
+                         const int numVars, const std::string varNames[]
+                        )
+{
+  if (!isActive)
+  {
+    return;
+  }
+
+  for (int var=0; var<numVars; var++)
+  {
+    if (varNames[var].empty())
+    {
+      continue;
+    }
+    step << "        <Attribute Name=\"" << varNames[var] << "\""
+         << " AttributeType=\"Scalar\" Center=\"Node\">\n"
+         << "  ";
+    dataItem(step, dataFile, dumpWriter::datasetName(varsName, var));
+    step << "        </Attribute>\n";
+  }
+}
+
+void xdmfSeries::endStep()
+{
+  if (!isActive)
+  {
+    return;
+  }
+  step << "      </Grid>\n";
+
+  /* Overwrite the trailer, so that the file is complete again afterwards */
+  std::fstream index(fileName.c_str(),
+                     std::ios::in | std::ios::out | std::ios::binary
+                    );
+  index.seekp(-(std::streamoff)trailer.size(), std::ios::end);
+  index << step.str() << trailer;
+}
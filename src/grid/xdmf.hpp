@@ -0,0 +1,58 @@
+#ifndef GRIM_XDMF_H_
+#define GRIM_XDMF_H_
+
+#include <string>
+#include <sstream>
+#include "grid.hpp"
+
+/* XDMF index of a time series of dumps, for ParaView/VisIt. Every step only
+ * references the datasets of the HDF5 files written by grid::dump(); the
+ * curvilinear mesh comes from a single coordinates file, written once (for
+ * ex, xCoords.h5 from geometry::xCoordsGrid), instead of being repeated in
+ * every output as with VTS files.
+ *
+ * Only rank 0 writes the index. The file is kept valid after every step, so
+ * that a run can be looked at while it goes on, and a restarted run appends
+ * to the index of the run it continues. Needs dim >= 2. */
+class xdmfSeries
+{
+  std::string fileName;
+  std::string dimensions;
+  std::string gridXML;
+  std::stringstream step;
+  bool isActive;
+
+  void dataItem(std::stringstream &xml, const std::string dataFile,
+                const std::string dataset
+               ) const;
+
+  public:
+    /* The coordinates are the datasets coordinatesName/var0, var1 (var2) of
+     * coordinatesFile. With append, steps are added to an existing
+     * fileName */
+    xdmfSeries(const std::string fileName, const grid &layout,
+               const std::string coordinatesFile,
+               const std::string coordinatesName,
+               const bool append
+              );
+
+    /* For dumps of a window of a grid, N1 x N2 x N3 zones */
+    xdmfSeries(const std::string fileName,
+               const int dim, const int N1, const int N2, const int N3,
+               const std::string coordinatesFile,
+               const std::string coordinatesName,
+               const bool append
+              );
+
+    void beginStep(const double time);
+
+    /* Variables of a dump written by grid::dump(varsName, dataFile). Those
+     * with an empty name are left out */
+    void addVars(const std::string dataFile, const std::string varsName,
+                 const int numVars, const std::string varNames[]
+                );
+
+    void endStep();
+};
+
+#endif /* GRIM_XDMF_H_ */
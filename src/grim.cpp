@@ -1,13 +1,64 @@
 #include "grim.hpp"
 #include "params.hpp"
+#include <cstdlib>
+#include <sstream>
+#include <sys/stat.h>
+
+/* Points the ArrayFire JIT kernel cache to a folder keyed by everything that
+ * changes the generated kernels, so that restarts of the same configuration
+ * reuse the kernels compiled by earlier runs. Must be called before the
+ * first ArrayFire call. Only the CUDA and OpenCL backends compile kernels at
+ * run time; the CPU backend ignores the cache. An existing
+ * AF_JIT_KERNEL_CACHE_DIRECTORY in the environment takes precedence. */
+static void setKernelCacheDirectory()
+{
+  if (params::kernelCacheDir.empty())
+  {
+    return;
+  }
+
+  std::stringstream configuration;
+#ifdef GRIM_NATIVE_KERNELS
+  configuration << "native";
+#else
+  configuration << "af";
+#endif
+  configuration << "_" << AF_VERSION_MAJOR << AF_VERSION_MINOR
+                << "_dim"  << params::dim
+                << "_ng"   << params::numGhost
+                << "_m"    << params::metric
+                << "_ts"   << params::timeStepper
+                << "_rec"  << params::reconstruction
+                << "_rs"   << params::riemannSolver
+                << "_emhd" << params::conduction
+                           << params::highOrderTermsConduction
+                           << params::viscosity
+                           << params::highOrderTermsViscosity;
+
+  std::string directory = params::kernelCacheDir;
+  mkdir(directory.c_str(), 0755);
+  directory += "/" + configuration.str();
+  mkdir(directory.c_str(), 0755);
+
+  setenv("AF_JIT_KERNEL_CACHE_DIRECTORY", directory.c_str(), 0);
+}
 
 int main(int argc, char **argv)
 { 
+  /* The background dump writer makes MPI calls from its own thread */
+  int mpiThreadLevel;
+  MPI_Init_thread(&argc, &argv,
+                  params::asyncIO ? MPI_THREAD_MULTIPLE : MPI_THREAD_SINGLE,
+                  &mpiThreadLevel
+                 );
   PetscInitialize(&argc, &argv, NULL, help);
 
   int world_rank;
   MPI_Comm_rank(PETSC_COMM_WORLD, &world_rank);
+  setKernelCacheDirectory();
   af::setDevice(world_rank%params::numDevices);
+  memoryArena::initialize();
+  dumpWriter::initialize();
 
   /* Local scope so that destructors of all classes are called before
    * PetscFinalize() */
@@ -24,9 +75,10 @@ int main(int argc, char **argv)
                    params::X3Start, params::X3End
                   );
      
+    /* Dry run: compiles the kernels without advancing the simulation */
     PetscPrintf(PETSC_COMM_WORLD, "  Generating compute kernels...\n\n");
     int numReads, numWrites;
-    ts.timeStep(numReads, numWrites);
+    ts.warmUp(numReads, numWrites);
 
     af::sync();
 
@@ -48,6 +100,11 @@ int main(int argc, char **argv)
     else
       PetscPrintf(PETSC_COMM_WORLD, "\n Termination reason: Final Time\n");
   }
+  dumpWriter::finalize();
+  timings::finalize();
+  memoryArena::finalize();
   PetscFinalize();  
+  /* MPI was initialized here, so PetscFinalize() leaves it running */
+  MPI_Finalize();
   return(0);
 }
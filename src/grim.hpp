@@ -4,6 +4,8 @@
 //#include <yaml-cpp/yaml.h>
 #include "params.hpp"
 #include "grid/grid.hpp"
+#include "grid/memoryarena.hpp"
+#include "grid/dumpwriter.hpp"
 #include "geometry/geometry.hpp"
 #include "physics/physics.hpp"
 #include "timestepper/timestepper.hpp"
@@ -73,7 +73,7 @@ namespace reconstructionOptions
 {
   enum
   {
-    MINMOD, WENO5, PPM
+    MINMOD, WENO5, PPM, WENOZ
   };
 };
 
@@ -96,6 +96,15 @@ namespace linearSolvers
 namespace params
 {
   extern int numDevices;
+  extern int memoryArena;
+  extern std::string kernelCacheDir;
+  extern std::string geometryCacheDir;
+  extern int fluxTileRows;
+  extern int asyncIO;
+  extern int dumpCompressionLevel;
+  extern int printPerformanceReport;
+  extern int timingReportEveryNSteps;
+  extern std::string timingLogFile;
 
   extern int N1;
   extern int N2;
@@ -117,6 +126,9 @@ namespace params
   extern std::string restartFile;
   extern std::string restartFileName;
   extern std::string restartFileTime;
+  extern int rawRestart;
+  extern double extrusionPerturbation;
+  extern int extrusionSeed;
   extern double MaxWallTime;
   extern int numDumpVars;
 
@@ -189,6 +201,24 @@ namespace params
   extern bool   UseMADdisk;
   extern double ObserveEveryDt;
   extern double WriteDataEveryDt;
+  extern int WriteDerivedVars;
+  extern int WriteReducedVars;
+  extern double WriteWindowEveryDt;
+  extern double WindowRadiusMin;
+  extern double WindowRadiusMax;
+  extern double WindowThetaMin;
+  extern double WindowThetaMax;
+  extern int WindowStrideX1;
+  extern int WindowStrideX2;
+  extern int WindowStrideX3;
+  extern int LossyPrimVars;
+  extern int LossyDerivedVars;
+  extern int LossyWindowVars;
+  extern double RhoErrorRel, RhoErrorAbs;
+  extern double UErrorRel, UErrorAbs;
+  extern double BErrorRel, BErrorAbs;
+  extern double QErrorRel, QErrorAbs;
+  extern double DPErrorRel, DPErrorAbs;
 
   /* Linear modes parameters */
   extern double Aw;
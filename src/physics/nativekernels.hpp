@@ -0,0 +1,381 @@
+#ifndef GRIM_NATIVEKERNELS_H_
+#define GRIM_NATIVEKERNELS_H_
+
+#include <cmath>
+#include "../params.hpp"
+#include "../grid/nativebuffers.hpp"
+
+/* Hand-fused OpenMP/SIMD versions of the pointwise fluidElement routines,
+ * used instead of the ArrayFire expressions when GRIM_NATIVE_KERNELS is
+ * defined. Every kernel is a single pass over the zones: inputs are read
+ * once, outputs written once, and nothing in between is materialised. The
+ * zone-level functions take plain doubles so that other fused loops can call
+ * them as well. */
+namespace native
+{
+  /* Metric quantities at a set of zones */
+  struct metricPtrs
+  {
+    const double *alpha, *g;
+    const double *gCov[NDIM][NDIM];
+    const double *gCon[NDIM][NDIM];
+    const double *gammaUpDownDown[NDIM][NDIM][NDIM];
+  };
+
+  /* Quantities set by fluidElement::set(). T is double for the kernel that
+   * fills them, const double for the kernels that consume them. */
+  template <typename T> struct elementPtrs
+  {
+    T *rho, *u, *pressure, *temperature, *soundSpeed;
+    T *gammaLorentzFactor;
+    T *uCon[NDIM], *uCov[NDIM];
+    T *bCon[NDIM], *bCov[NDIM];
+    T *bSqr, *bNorm;
+    T *qTilde, *deltaPTilde, *q, *deltaP;
+  };
+
+  /* T^mu_nu at zone i. Same expression as fluidElement::setTUpDownRow() */
+  template <typename config>
+  inline double TUpDown(const elementPtrs<const double> &e,
+                        const int i, const int mu, const int nu
+                       )
+  {
+    const double delta = (mu==nu ? 1. : 0.);
+
+    double T =   (  e.rho[i] + e.u[i] + e.pressure[i]
+                  + e.bSqr[i]
+                 )*e.uCon[mu][i]*e.uCov[nu][i]
+               + (e.pressure[i] + 0.5*e.bSqr[i])*delta
+               - e.bCon[mu][i]*e.bCov[nu][i];
+
+    if (config::conduction)
+    {
+      T +=   e.q[i]/e.bNorm[i]
+           * (  e.uCon[mu][i]*e.bCov[nu][i]
+              + e.bCon[mu][i]*e.uCov[nu][i]
+             );
+    }
+
+    if (config::viscosity)
+    {
+      T += (- e.deltaP[i])
+           * (  e.bCon[mu][i]*e.bCov[nu][i]/e.bSqr[i]
+              - (1./3.)*(delta + e.uCon[mu][i]*e.uCov[nu][i])
+             );
+    }
+
+    return T;
+  }
+
+  /* Ideal MHD state of a single zone */
+  struct zoneState
+  {
+    double rho, u, pressure, temperature, soundSpeed;
+    double gammaLorentzFactor;
+    double uCon[NDIM], uCov[NDIM];
+    double bCon[NDIM], bCov[NDIM];
+    double bSqr;
+  };
+
+  /* Same as fluidElement::set() for the ideal MHD part. prim holds the
+   * primitive variables of the zone, gCon0 the row g^{0 mu} */
+  template <typename config>
+  inline void setZone(const double prim[],
+                      const double alpha,
+                      const double gCov[NDIM][NDIM],
+                      const double gCon0[NDIM],
+                      zoneState &s
+                     )
+  {
+    const double gamma = params::adiabaticIndex;
+
+    s.rho = std::max(prim[vars::RHO], params::rhoFloorInFluidElement);
+    s.u   = std::max(prim[vars::U],   params::uFloorInFluidElement);
+    const double u1 = prim[vars::U1];
+    const double u2 = prim[vars::U2];
+    const double u3 = prim[vars::U3];
+    const double B1 = prim[config::B1];
+    const double B2 = prim[config::B2];
+    const double B3 = prim[config::B3];
+
+    s.pressure    = (gamma - 1.)*s.u;
+    s.temperature = std::max(s.pressure/s.rho,
+                             params::temperatureFloorInFluidElement
+                            );
+    s.soundSpeed  = std::sqrt(gamma*s.pressure/(s.rho + gamma*s.u));
+
+    s.gammaLorentzFactor =
+      std::sqrt(1. + gCov[1][1] * u1 * u1
+                   + gCov[2][2] * u2 * u2
+                   + gCov[3][3] * u3 * u3
+               + 2.*(  gCov[1][2] * u1 * u2
+                     + gCov[1][3] * u1 * u3
+                     + gCov[2][3] * u2 * u3
+                    )
+               );
+
+    s.uCon[0] = s.gammaLorentzFactor/alpha;
+    s.uCon[1] = u1 - s.gammaLorentzFactor*gCon0[1]*alpha;
+    s.uCon[2] = u2 - s.gammaLorentzFactor*gCon0[2]*alpha;
+    s.uCon[3] = u3 - s.gammaLorentzFactor*gCon0[3]*alpha;
+
+    for (int mu=0; mu<NDIM; mu++)
+    {
+      s.uCov[mu] =  gCov[mu][0] * s.uCon[0] + gCov[mu][1] * s.uCon[1]
+                  + gCov[mu][2] * s.uCon[2] + gCov[mu][3] * s.uCon[3];
+    }
+
+    s.bCon[0] =  B1*s.uCov[1] + B2*s.uCov[2] + B3*s.uCov[3];
+    s.bCon[1] = (B1 + s.bCon[0] * s.uCon[1])/s.uCon[0];
+    s.bCon[2] = (B2 + s.bCon[0] * s.uCon[2])/s.uCon[0];
+    s.bCon[3] = (B3 + s.bCon[0] * s.uCon[3])/s.uCon[0];
+
+    for (int mu=0; mu<NDIM; mu++)
+    {
+      s.bCov[mu] =  gCov[mu][0] * s.bCon[0] + gCov[mu][1] * s.bCon[1]
+                  + gCov[mu][2] * s.bCon[2] + gCov[mu][3] * s.bCon[3];
+    }
+
+    s.bSqr =  s.bCon[0]*s.bCov[0] + s.bCon[1]*s.bCov[1]
+            + s.bCon[2]*s.bCov[2] + s.bCon[3]*s.bCov[3]
+            + params::bSqrFloorInFluidElement;
+  }
+
+  /* Ideal MHD T^mu_nu of a single zone */
+  inline double TUpDown(const zoneState &s, const int mu, const int nu)
+  {
+    const double delta = (mu==nu ? 1. : 0.);
+
+    return   (s.rho + s.u + s.pressure + s.bSqr)*s.uCon[mu]*s.uCov[nu]
+           + (s.pressure + 0.5*s.bSqr)*delta
+           - s.bCon[mu]*s.bCov[nu];
+  }
+
+  /* Ideal MHD fluxes of a single zone along dir, or the conserved variables
+   * for dir=0 */
+  template <typename config>
+  inline void zoneFluxes(const int dir, const double g,
+                         const zoneState &s,
+                         double flux[]
+                        )
+  {
+    const double fluxRho = g*s.rho*s.uCon[dir];
+
+    flux[vars::RHO] = fluxRho;
+    flux[vars::U]   = g*TUpDown(s, dir, 0) + fluxRho;
+    flux[vars::U1]  = g*TUpDown(s, dir, 1);
+    flux[vars::U2]  = g*TUpDown(s, dir, 2);
+    flux[vars::U3]  = g*TUpDown(s, dir, 3);
+
+    flux[config::B1] = g*(s.bCon[1]*s.uCon[dir] - s.bCon[dir]*s.uCon[1]);
+    flux[config::B2] = g*(s.bCon[2]*s.uCon[dir] - s.bCon[dir]*s.uCon[2]);
+    flux[config::B3] = g*(s.bCon[3]*s.uCon[dir] - s.bCon[dir]*s.uCon[3]);
+  }
+
+  /* Roots of the dispersion relation for a wave speed squared csSqr, with
+   * A_mu = delta_mu^dir and B_mu = delta_mu^0 */
+  inline void charSpeeds(const double csSqr,
+                         const double ASqr,  const double BSqr,
+                         const double ADotU, const double BDotU,
+                         const double ADotB,
+                         double &minSpeed, double &maxSpeed
+                        )
+  {
+    const double A = (BDotU*BDotU) - (BSqr + BDotU*BDotU)*csSqr;
+    const double B = 2.*(ADotU*BDotU - (ADotB + ADotU*BDotU)*csSqr);
+    const double C = ADotU*ADotU - (ASqr + ADotU*ADotU)*csSqr;
+    const double discr = std::sqrt(std::max(B*B - 4.*A*C, 1.e-16));
+
+    minSpeed = std::min(-(-B + discr)/2./A, -1.e-15);
+    maxSpeed = std::max(-(-B - discr)/2./A,  1.e-15);
+  }
+
+  template <typename config>
+  void setFluidElement(const int numZones,
+                       const double * const prim[],
+                       const metricPtrs &geom,
+                       const elementPtrs<double> &e
+                      )
+  {
+    #pragma omp parallel for simd
+    for (int i=0; i<numZones; i++)
+    {
+      double primZone[config::dof];
+      for (int var=0; var<config::dof; var++)
+      {
+        primZone[var] = prim[var][i];
+      }
+
+      double gCov[NDIM][NDIM], gCon0[NDIM];
+      for (int mu=0; mu<NDIM; mu++)
+      {
+        gCon0[mu] = geom.gCon[0][mu][i];
+        for (int nu=0; nu<NDIM; nu++)
+        {
+          gCov[mu][nu] = geom.gCov[mu][nu][i];
+        }
+      }
+
+      zoneState s;
+      setZone<config>(primZone, geom.alpha[i], gCov, gCon0, s);
+
+      e.rho[i]                = s.rho;
+      e.u[i]                  = s.u;
+      e.pressure[i]           = s.pressure;
+      e.temperature[i]        = s.temperature;
+      e.soundSpeed[i]         = s.soundSpeed;
+      e.gammaLorentzFactor[i] = s.gammaLorentzFactor;
+      for (int mu=0; mu<NDIM; mu++)
+      {
+        e.uCon[mu][i] = s.uCon[mu];
+        e.uCov[mu][i] = s.uCov[mu];
+        e.bCon[mu][i] = s.bCon[mu];
+        e.bCov[mu][i] = s.bCov[mu];
+      }
+      e.bSqr[i]  = s.bSqr;
+      e.bNorm[i] = std::sqrt(s.bSqr);
+
+      if (config::highOrderTermsConduction)
+      {
+        e.q[i] =   prim[config::Q][i] * s.temperature
+                 * std::sqrt(  s.rho*params::ConductionAlpha
+                             * s.soundSpeed*s.soundSpeed
+                            );
+      }
+
+      if (config::highOrderTermsViscosity)
+      {
+        e.deltaP[i] =   prim[config::DP][i]
+                      * std::sqrt(  s.temperature*s.rho*params::ViscosityAlpha
+                                  * s.soundSpeed*s.soundSpeed
+                                 );
+      }
+    }
+  }
+
+  /* Fluxes along dir, or the conserved variables for dir=0 */
+  template <typename config>
+  void computeFluxes(const int numZones,
+                     const int dir,
+                     const double *g,
+                     const elementPtrs<const double> &e,
+                     double * const flux[]
+                    )
+  {
+    #pragma omp parallel for simd
+    for (int i=0; i<numZones; i++)
+    {
+      const double fluxRho = g[i]*e.rho[i]*e.uCon[dir][i];
+
+      flux[vars::RHO][i] = fluxRho;
+      flux[vars::U][i]   = g[i]*TUpDown<config>(e, i, dir, 0) + fluxRho;
+      flux[vars::U1][i]  = g[i]*TUpDown<config>(e, i, dir, 1);
+      flux[vars::U2][i]  = g[i]*TUpDown<config>(e, i, dir, 2);
+      flux[vars::U3][i]  = g[i]*TUpDown<config>(e, i, dir, 3);
+
+      flux[config::B1][i] = g[i]*(  e.bCon[1][i]*e.uCon[dir][i]
+                                  - e.bCon[dir][i]*e.uCon[1][i]
+                                 );
+      flux[config::B2][i] = g[i]*(  e.bCon[2][i]*e.uCon[dir][i]
+                                  - e.bCon[dir][i]*e.uCon[2][i]
+                                 );
+      flux[config::B3][i] = g[i]*(  e.bCon[3][i]*e.uCon[dir][i]
+                                  - e.bCon[dir][i]*e.uCon[3][i]
+                                 );
+
+      if (config::conduction)
+      {
+        flux[config::Q][i] = g[i]*(e.uCon[dir][i] * e.qTilde[i]);
+      }
+
+      if (config::viscosity)
+      {
+        flux[config::DP][i] = g[i]*(e.uCon[dir][i] * e.deltaPTilde[i]);
+      }
+    }
+  }
+
+  /* Ideal MHD geometric source terms -g T^kappa_lamda Gamma^lamda_kappa_nu,
+   * written into sources[vars::U + nu] */
+  template <typename config>
+  void computeGeometricSources(const int numZones,
+                               const metricPtrs &geom,
+                               const elementPtrs<const double> &e,
+                               double * const sources[]
+                              )
+  {
+    #pragma omp parallel for simd
+    for (int i=0; i<numZones; i++)
+    {
+      double T[NDIM][NDIM];
+      for (int kappa=0; kappa<NDIM; kappa++)
+      {
+        for (int lamda=0; lamda<NDIM; lamda++)
+        {
+          T[kappa][lamda] = TUpDown<config>(e, i, kappa, lamda);
+        }
+      }
+
+      for (int nu=0; nu<NDIM; nu++)
+      {
+        double source = 0.;
+        for (int kappa=0; kappa<NDIM; kappa++)
+        {
+          for (int lamda=0; lamda<NDIM; lamda++)
+          {
+            source -= T[kappa][lamda]*geom.gammaUpDownDown[lamda][kappa][nu][i];
+          }
+        }
+        sources[vars::U + nu][i] = geom.g[i]*source;
+      }
+    }
+  }
+
+  /* Same as fluidElement::computeMinMaxCharSpeeds(). With A_mu = delta_mu^dir
+   * and B_mu = delta_mu^0 the contractions reduce to components of gCon and
+   * uCon. tau, chiEMHD and nuEMHD are only read when the matching physics is
+   * on. */
+  inline void computeMinMaxCharSpeeds(const int numZones,
+                                      const int dir,
+                                      const metricPtrs &geom,
+                                      const elementPtrs<const double> &e,
+                                      const double *tau,
+                                      const double *chiEMHD,
+                                      const double *nuEMHD,
+                                      double *minSpeed,
+                                      double *maxSpeed
+                                     )
+  {
+    const double gamma = params::adiabaticIndex;
+    const int sdir = dir + 1;
+    const bool conduction = params::conduction;
+    const bool viscosity  = params::viscosity;
+
+    #pragma omp parallel for simd
+    for (int i=0; i<numZones; i++)
+    {
+      const double enthalpy  = e.rho[i] + gamma*e.u[i];
+      const double cAlvenSqr = e.bSqr[i]/(enthalpy + e.bSqr[i]);
+      double csSqr = e.soundSpeed[i]*e.soundSpeed[i];
+
+      const double cVisSqr
+        = viscosity  ? 4./3./enthalpy*e.rho[i]*nuEMHD[i]/tau[i] : 0.;
+      double cConSqr
+        = conduction ? (gamma - 1.)*chiEMHD[i]/tau[i] : 0.;
+
+      cConSqr = 0.5*(csSqr + cConSqr + std::sqrt(csSqr*csSqr + cConSqr*cConSqr));
+      csSqr   = cConSqr + cVisSqr;
+      csSqr   = csSqr + cAlvenSqr - csSqr*cAlvenSqr;
+      csSqr   = std::min(csSqr, 1.);
+
+      charSpeeds(csSqr,
+                 geom.gCon[sdir][sdir][i], geom.gCon[0][0][i],
+                 e.uCon[sdir][i], e.uCon[0][i],
+                 geom.gCon[sdir][0][i],
+                 minSpeed[i], maxSpeed[i]
+                );
+    }
+  }
+}
+
+#endif /* GRIM_NATIVEKERNELS_H_ */
@@ -7,34 +7,34 @@ fluidElement::fluidElement(const grid &prim,
                           )
 {
   this->geom = &geom_;
+
+  physicsKernels = selectPhysicsConfig<kernels, kernelTable>();
   
   /* Use this to set various fluid parameters. For ex: tau = 0.1*one etc..*/
-  one = af::constant(1, 
-                     prim.vars[0].dims(directions::X1),
-                     prim.vars[0].dims(directions::X2),
-                     prim.vars[0].dims(directions::X3),
-                     f64
-                    );
+  one = af::constant(1, prim.vars[0].dims(), f64);
 
   zero = 0.*one;
   gammaLorentzFactor = zero;
 
-  /* Allocate memory for gradients used in EMHD */
+  /* Allocate memory for gradients used in EMHD. gradT is only needed with
+   * conduction. The tetrads eCon, eCov are assigned in constructTetrads() and
+   * need no allocation here. */
   if (params::conduction || params::viscosity)
   {
     divuCov = zero;
     
     for(int mu=0;mu<NDIM;mu++)
     {
-      gradT[mu] = zero;
       dtuCov[mu] = zero;
 
+      if (params::conduction)
+      {
+        gradT[mu] = zero;
+      }
+
       for(int nu=0;nu<NDIM;nu++)
       {
         graduCov[nu][mu] = zero;
-        
-        eCov[mu][nu] = zero;
-        eCon[mu][nu] = zero;
       }
     }
     
@@ -50,6 +50,19 @@ fluidElement::~fluidElement()
   /* Nothing to be done */
 }
 
+template <typename config>
+fluidElement::kernels fluidElement::kernelTable<config>::get()
+{
+  kernels k;
+  k.set                     = &fluidElement::setImpl<config>;
+  k.computeFluxes           = &fluidElement::computeFluxesImpl<config>;
+  k.computeTimeDerivSources = &fluidElement::computeTimeDerivSourcesImpl<config>;
+  k.computeImplicitSources  = &fluidElement::computeImplicitSourcesImpl<config>;
+  k.computeExplicitSources  = &fluidElement::computeExplicitSourcesImpl<config>;
+
+  return k;
+}
+
 void fluidElement::set(const grid &prim,
                        geometry &geom_,
                        int &numReads,
@@ -57,14 +70,157 @@ void fluidElement::set(const grid &prim,
                       )
 {
   this->geom = &geom_;
+  (this->*physicsKernels.set)(prim, numReads, numWrites);
+}
+
+void fluidElement::computeFluxes(const int dir,
+                                 grid &flux,
+                                 int &numReads,
+                                 int &numWrites
+                                )
+{
+  (this->*physicsKernels.computeFluxes)(dir, flux, numReads, numWrites);
+}
+
+void fluidElement::computeTimeDerivSources(const fluidElement &elemOld,
+                                           const fluidElement &elemNew,
+                                           const double dt,
+                                           grid &sources,
+                                           int &numReads,
+                                           int &numWrites
+                                          )
+{
+  (this->*physicsKernels.computeTimeDerivSources)(elemOld, elemNew, dt,
+                                                   sources,
+                                                   numReads, numWrites
+                                                  );
+}
+
+void fluidElement::computeImplicitSources(grid &sources,
+                                          array &tauDamp,
+                                          int &numReads,
+                                          int &numWrites
+                                         )
+{
+  (this->*physicsKernels.computeImplicitSources)(sources, tauDamp,
+                                                  numReads, numWrites
+                                                 );
+}
+
+void fluidElement::computeExplicitSources(const double dX[3],
+                                          grid &sources,
+                                          int &numReads,
+                                          int &numWrites
+                                         )
+{
+  (this->*physicsKernels.computeExplicitSources)(dX, sources,
+                                                  numReads, numWrites
+                                                 );
+}
+
+template <typename config>
+void fluidElement::setImpl(const grid &prim,
+                           int &numReads,
+                           int &numWrites
+                          )
+{
+#ifdef GRIM_NATIVE_KERNELS
+  {
+    native::bufferSet buffers;
+    const af::dim4 dims = prim.vars[vars::RHO].dims();
+
+    const double *primPtrs[config::dof];
+    for (int var=0; var<config::dof; var++)
+    {
+      primPtrs[var] = buffers.read(prim.vars[var]);
+    }
+
+    native::elementPtrs<double> e;
+    e.qTilde = e.q = e.deltaPTilde = e.deltaP = NULL;
+    e.rho                = buffers.write(rho, dims);
+    e.u                  = buffers.write(u, dims);
+    e.pressure           = buffers.write(pressure, dims);
+    e.temperature        = buffers.write(temperature, dims);
+    e.soundSpeed         = buffers.write(soundSpeed, dims);
+    e.gammaLorentzFactor = buffers.write(gammaLorentzFactor, dims);
+    for (int mu=0; mu<NDIM; mu++)
+    {
+      e.uCon[mu] = buffers.write(uCon[mu], dims);
+      e.uCov[mu] = buffers.write(uCov[mu], dims);
+      e.bCon[mu] = buffers.write(bCon[mu], dims);
+      e.bCov[mu] = buffers.write(bCov[mu], dims);
+    }
+    e.bSqr  = buffers.write(bSqr, dims);
+    e.bNorm = buffers.write(bNorm, dims);
+
+    u1  = prim.vars[vars::U1 ];
+    u2  = prim.vars[vars::U2 ];
+    u3  = prim.vars[vars::U3 ];
+    B1  = prim.vars[config::B1 ];
+    B2  = prim.vars[config::B2 ];
+    B3  = prim.vars[config::B3 ];
+
+    numReads  = 8 + 12;
+    numWrites = 25;
+    if (config::conduction)
+    {
+      qTilde = prim.vars[config::Q];
+      q      = qTilde;
+      if (config::highOrderTermsConduction)
+      {
+        e.q = buffers.write(q, dims);
+        numWrites += 1;
+      }
+      numReads += 1;
+    }
+    if (config::viscosity)
+    {
+      deltaPTilde = prim.vars[config::DP];
+      deltaP      = deltaPTilde;
+      if (config::highOrderTermsViscosity)
+      {
+        e.deltaP = buffers.write(deltaP, dims);
+        numWrites += 1;
+      }
+      numReads += 1;
+    }
+
+    native::setFluidElement<config>(dims.elements(), primPtrs,
+                                    nativeMetric(buffers, false), e
+                                   );
+  }
+  /* Reads:
+   * -----
+   *  prim[var] : 8 (+ Q, DP)
+   *  gCov[mu][nu] (10 independent), gCon[0][i] (3), alpha : 14, counted as 12
+   *  as in the ArrayFire version
+   *
+   * Writes:
+   * ------
+   *  rho, u, pressure, temperature, soundSpeed, gammaLorentzFactor : 6
+   *  uCon, uCov, bCon, bCov : 16
+   *  bSqr, bNorm : 2
+   *  q, deltaP (high order terms only) */
+
+  // Note: this uses q, deltaP, bSqr!
+  setFluidElementParameters();
+
+  for (int mu=0; mu < NDIM; mu++)
+  {
+    TUpDownRowIsSet[mu] = false;
+  }
+
+  return;
+#endif
+
   rho = af::max(prim.vars[vars::RHO],params::rhoFloorInFluidElement);
   u   = af::max(prim.vars[vars::U  ],params::uFloorInFluidElement);
   u1  = prim.vars[vars::U1 ];
   u2  = prim.vars[vars::U2 ];
   u3  = prim.vars[vars::U3 ];
-  B1  = prim.vars[vars::B1 ];
-  B2  = prim.vars[vars::B2 ];
-  B3  = prim.vars[vars::B3 ];
+  B1  = prim.vars[config::B1 ];
+  B2  = prim.vars[config::B2 ];
+  B3  = prim.vars[config::B3 ];
 
   pressure    = (params::adiabaticIndex - 1.)*u;
   temperature = af::max(pressure/rho,params::temperatureFloorInFluidElement);
@@ -117,11 +273,11 @@ void fluidElement::set(const grid &prim,
 
   // Note: this needs to be before setFluidElementParameters
   // because the closure relation uses q, deltaP!
-  if (params::conduction==1)
+  if (config::conduction)
   {
-    qTilde = prim.vars[vars::Q];
+    qTilde = prim.vars[config::Q];
 
-    if (params::highOrderTermsConduction==1)
+    if (config::highOrderTermsConduction)
     {
       q = qTilde * temperature * af::sqrt(rho*params::ConductionAlpha*soundSpeed*soundSpeed);
     }
@@ -131,11 +287,11 @@ void fluidElement::set(const grid &prim,
     }
   }
 
-  if (params::viscosity==1)
+  if (config::viscosity)
   {
-    deltaPTilde = prim.vars[vars::DP];
+    deltaPTilde = prim.vars[config::DP];
 
-    if (params::highOrderTermsViscosity == 1)
+    if (config::highOrderTermsViscosity)
     {
       deltaP = 
         deltaPTilde 
@@ -150,34 +306,14 @@ void fluidElement::set(const grid &prim,
   // Note: this uses q, deltaP, bSqr!
   setFluidElementParameters();
 
+  /* NUp and TUpDown are built on demand by setTUpDownRow() */
   for (int mu=0; mu < NDIM; mu++)
   {
-    NUp[mu] = rho * uCon[mu];
-
-    for (int nu=0; nu < NDIM; nu++)
-    {
-      TUpDown[mu][nu] =   (rho + u + pressure + bSqr)*uCon[mu]*uCov[nu]
-                        + (pressure + 0.5*bSqr)*DELTA(mu, nu)
-                        - bCon[mu] * bCov[nu];
-
-      
-      if (params::conduction==1)
-      {
-        TUpDown[mu][nu] += q/bNorm * (uCon[mu]*bCov[nu] + bCon[mu]*uCov[nu]);
-      }
-
-      if (params::viscosity==1)
-      {
-        TUpDown[mu][nu] += (- deltaP)       
-                           * (  bCon[mu] * bCov[nu]/bSqr
-                              - (1./3.)*(DELTA(mu, nu) + uCon[mu]*uCov[nu])
-                             );
-      }
-    }
+    TUpDownRowIsSet[mu] = false;
   }
 
   numReads  = 42;
-  numWrites = 38;
+  numWrites = 19;
   
   std::vector<af::array *> arraysThatNeedEval{
       &gammaLorentzFactor,
@@ -185,19 +321,10 @@ void fluidElement::set(const grid &prim,
           &uCov[0], &uCov[1], &uCov[2], &uCov[3],
           &bCon[0], &bCon[1], &bCon[2], &bCon[3],
           &bCov[0], &bCov[1], &bCov[2], &bCov[3],
-          &bSqr, &bNorm,
-          &TUpDown[0][0], &TUpDown[0][1],
-          &TUpDown[0][2], &TUpDown[0][3],
-          &TUpDown[1][0], &TUpDown[1][1],
-          &TUpDown[1][2], &TUpDown[1][3],
-          &TUpDown[2][0], &TUpDown[2][1],
-          &TUpDown[2][2], &TUpDown[2][3],
-          &TUpDown[3][0], &TUpDown[3][1],
-          &TUpDown[3][2], &TUpDown[3][3],
-          &NUp[0], &NUp[1], &NUp[2], &NUp[3]
+          &bSqr, &bNorm
           };
 
-  if (params::conduction)
+  if (config::conduction)
   {
     arraysThatNeedEval.push_back(&q);
 
@@ -205,7 +332,7 @@ void fluidElement::set(const grid &prim,
     numWrites += 1;
   }
 
-  if (params::viscosity)
+  if (config::viscosity)
   {
     arraysThatNeedEval.push_back(&deltaP);
 
@@ -216,12 +343,75 @@ void fluidElement::set(const grid &prim,
   af::eval(arraysThatNeedEval.size(), &arraysThatNeedEval[0]);
 }
 
-void fluidElement::computeFluxes(const int dir,
-                                 grid &flux,
-                                 int &numReads,
-                                 int &numWrites
-                                )
+/* Builds NUp[mu] and the row TUpDown[mu][*] as unevaluated expressions. The
+ * row is then materialised only inside the kernel of whichever routine
+ * consumes it. computeFluxes(dir) needs rows dir and 0 only, so most calls to
+ * set() never pay for the full tensor. */
+template <typename config>
+void fluidElement::setTUpDownRow(const int mu)
+{
+  if (TUpDownRowIsSet[mu])
+  {
+    return;
+  }
+
+  NUp[mu] = rho * uCon[mu];
+
+  for (int nu=0; nu < NDIM; nu++)
+  {
+    TUpDown[mu][nu] =   (rho + u + pressure + bSqr)*uCon[mu]*uCov[nu]
+                      + (pressure + 0.5*bSqr)*DELTA(mu, nu)
+                      - bCon[mu] * bCov[nu];
+
+    if (config::conduction)
+    {
+      TUpDown[mu][nu] += q/bNorm * (uCon[mu]*bCov[nu] + bCon[mu]*uCov[nu]);
+    }
+
+    if (config::viscosity)
+    {
+      TUpDown[mu][nu] += (- deltaP)       
+                         * (  bCon[mu] * bCov[nu]/bSqr
+                            - (1./3.)*(DELTA(mu, nu) + uCon[mu]*uCov[nu])
+                           );
+    }
+  }
+
+  TUpDownRowIsSet[mu] = true;
+}
+
+template <typename config>
+void fluidElement::computeFluxesImpl(const int dir,
+                                     grid &flux,
+                                     int &numReads,
+                                     int &numWrites
+                                    )
 {
+#ifdef GRIM_NATIVE_KERNELS
+  {
+    native::bufferSet buffers;
+    const af::dim4 dims = rho.dims();
+
+    double *fluxPtrs[config::dof];
+    for (int var=0; var<config::dof; var++)
+    {
+      fluxPtrs[var] = buffers.write(flux.vars[var], dims);
+    }
+
+    native::computeFluxes<config>(dims.elements(), dir,
+                                  buffers.read(geom->g),
+                                  nativeElement(buffers),
+                                  fluxPtrs
+                                 );
+  }
+  numReads  = 12 + config::conduction + config::viscosity;
+  numWrites = config::dof;
+
+  return;
+#endif
+
+  setTUpDownRow<config>(dir);
+
   array g = geom->g;
 
   flux.vars[vars::RHO] = g*NUp[dir];
@@ -232,9 +422,9 @@ void fluidElement::computeFluxes(const int dir,
   flux.vars[vars::U2]  = g*TUpDown[dir][2];
   flux.vars[vars::U3]  = g*TUpDown[dir][3];
 
-  flux.vars[vars::B1]  = g*(bCon[1]*uCon[dir] - bCon[dir]*uCon[1]);
-  flux.vars[vars::B2]  = g*(bCon[2]*uCon[dir] - bCon[dir]*uCon[2]);
-  flux.vars[vars::B3]  = g*(bCon[3]*uCon[dir] - bCon[dir]*uCon[3]);
+  flux.vars[config::B1]  = g*(bCon[1]*uCon[dir] - bCon[dir]*uCon[1]);
+  flux.vars[config::B2]  = g*(bCon[2]*uCon[dir] - bCon[dir]*uCon[2]);
+  flux.vars[config::B3]  = g*(bCon[3]*uCon[dir] - bCon[dir]*uCon[3]);
 
   std::vector<af::array *> arraysThatNeedEval{
                 &flux.vars[vars::RHO],  
@@ -242,25 +432,25 @@ void fluidElement::computeFluxes(const int dir,
                 &flux.vars[vars::U1],  
                 &flux.vars[vars::U2],  
                 &flux.vars[vars::U3],  
-                &flux.vars[vars::B1],  
-                &flux.vars[vars::B2],  
-                &flux.vars[vars::B3]  
+                &flux.vars[config::B1],  
+                &flux.vars[config::B2],  
+                &flux.vars[config::B3]  
               };
   numReads  = 12;
   numWrites = 8;
 
-  if (params::conduction)
+  if (config::conduction)
   {
-    flux.vars[vars::Q] = g*(uCon[dir] * qTilde);
-    arraysThatNeedEval.push_back(&flux.vars[vars::Q]);
+    flux.vars[config::Q] = g*(uCon[dir] * qTilde);
+    arraysThatNeedEval.push_back(&flux.vars[config::Q]);
     numReads++;
     numWrites++;
   }
 
-  if (params::viscosity)
+  if (config::viscosity)
   {
-    flux.vars[vars::DP] = g*(uCon[dir] * deltaPTilde);
-    arraysThatNeedEval.push_back(&flux.vars[vars::DP]);
+    flux.vars[config::DP] = g*(uCon[dir] * deltaPTilde);
+    arraysThatNeedEval.push_back(&flux.vars[config::DP]);
     numReads++;
     numWrites++;
   }
@@ -268,22 +458,23 @@ void fluidElement::computeFluxes(const int dir,
   af::eval(arraysThatNeedEval.size(), &arraysThatNeedEval[0]);
 }
 
-void fluidElement::computeTimeDerivSources(const fluidElement &elemOld,
-                                           const fluidElement &elemNew,
-                                           const double dt,
-                                           grid &sources,
-                                           int &numReads,
-                                           int &numWrites
-                                          )
+template <typename config>
+void fluidElement::computeTimeDerivSourcesImpl(const fluidElement &elemOld,
+                                               const fluidElement &elemNew,
+                                               const double dt,
+                                               grid &sources,
+                                               int &numReads,
+                                               int &numWrites
+                                              )
 {
-  for (int var=0; var<vars::dof; var++)
+  for (int var=0; var<config::dof; var++)
   {
     sources.vars[var] = 0.;
   }
   numReads = 0;
-  numWrites = vars::dof;
+  numWrites = config::dof;
 
-  if (params::conduction || params::viscosity)
+  if (config::emhd)
   {
     std::vector<af::array *> arraysThatNeedEval;
 
@@ -310,7 +501,7 @@ void fluidElement::computeTimeDerivSources(const fluidElement &elemOld,
       
     // -------------------------------------
     // Now, look at viscosity-specific terms
-    if(params::viscosity)
+    if(config::viscosity)
     {
       // Compute target deltaP (time deriv part)
       deltaP0 = -divuCov*rho*nu_emhd;     
@@ -321,26 +512,26 @@ void fluidElement::computeTimeDerivSources(const fluidElement &elemOld,
                   / bSqr*dtuCov[mu];
       }
 
-      if (params::highOrderTermsViscosity == 1)
+      if (config::highOrderTermsViscosity)
       {
         deltaP0 *= af::sqrt(tau/rho/nu_emhd/temperature);
       }
   
       //Note on sign: we put the sources on the LHS when
       //computing the residual!
-      sources.vars[vars::DP] = -geom->g*(deltaP0)/tau;
+      sources.vars[config::DP] = -geom->g*(deltaP0)/tau;
 
-      if (params::highOrderTermsViscosity == 1)
+      if (config::highOrderTermsViscosity)
       {
-        sources.vars[vars::DP] -= 0.5*geom->g*divuCov*deltaPTilde;
+        sources.vars[config::DP] -= 0.5*geom->g*divuCov*deltaPTilde;
       }
       
-      arraysThatNeedEval.push_back(&sources.vars[vars::DP]);
+      arraysThatNeedEval.push_back(&sources.vars[config::DP]);
     } /* End of viscosity specific terms */
     
     // -------------------------------------
     // Finally, look at conduction-specific terms (time deriv terms)
-    if(params::conduction)
+    if(config::conduction)
     {
       q0 =  - rho*chi_emhd*bCon[0]
             / bNorm *(elemNew.temperature - elemOld.temperature)/dt;
@@ -351,21 +542,21 @@ void fluidElement::computeTimeDerivSources(const fluidElement &elemOld,
               bCon[nu]/bNorm*uCon[0]*dtuCov[nu];
       }
   
-      if (params::highOrderTermsConduction == 1)
+      if (config::highOrderTermsConduction)
       {
         q0 *= af::sqrt(tau/rho/chi_emhd)/temperature;
       }
       
       //Note on sign: we put the sources on the LHS when
       //computing the residual!
-      sources.vars[vars::Q] = -geom->g*(q0)/tau;
+      sources.vars[config::Q] = -geom->g*(q0)/tau;
   
-      if (params::highOrderTermsConduction == 1)
+      if (config::highOrderTermsConduction)
       {
-        sources.vars[vars::Q] -= 0.5*geom->g*divuCov*qTilde;
+        sources.vars[config::Q] -= 0.5*geom->g*divuCov*qTilde;
       }
 
-      arraysThatNeedEval.push_back(&sources.vars[vars::Q]);
+      arraysThatNeedEval.push_back(&sources.vars[config::Q]);
     } /* End of conduction */
 
     af::eval(arraysThatNeedEval.size(), &arraysThatNeedEval[0]);
@@ -375,13 +566,14 @@ void fluidElement::computeTimeDerivSources(const fluidElement &elemOld,
 }
 
 
-void fluidElement::computeImplicitSources(grid &sources,
-                                          array &tauDamp,
-                                          int &numReads,
-                                          int &numWrites
-                                         )
+template <typename config>
+void fluidElement::computeImplicitSourcesImpl(grid &sources,
+                                              array &tauDamp,
+                                              int &numReads,
+                                              int &numWrites
+                                             )
 {
-  for (int var=0; var<vars::dof; var++)
+  for (int var=0; var<config::dof; var++)
   {
     sources.vars[var] = 0.;
   }
@@ -389,44 +581,45 @@ void fluidElement::computeImplicitSources(grid &sources,
   numReads = 0;
   numWrites = 0;
 
-  if (params::conduction || params::viscosity)
+  if (config::emhd)
   {
     std::vector<af::array *> arraysThatNeedEval;
 
     // Non-ideal pieces. Note that we only compute
     // the terms treated implicitly. 
     // Look at viscosity-specific terms
-    if(params::viscosity)
+    if(config::viscosity)
     {
       //Note on sign: we put the sources on the LHS when
       //computing the residual!
-      sources.vars[vars::DP] = geom->g*(deltaPTilde)/tauDamp;
+      sources.vars[config::DP] = geom->g*(deltaPTilde)/tauDamp;
 
-      arraysThatNeedEval.push_back(&sources.vars[vars::DP]);
+      arraysThatNeedEval.push_back(&sources.vars[config::DP]);
     } /* End of viscosity specific terms */
   
     // -------------------------------------
     // Finally, look at conduction-specific terms (implicit terms)
-    if(params::conduction)
+    if(config::conduction)
     {
       //Note on sign: we put the sources on the LHS when
       //computing the residual!
-      sources.vars[vars::Q] = geom->g*(qTilde)/tauDamp;
+      sources.vars[config::Q] = geom->g*(qTilde)/tauDamp;
 
-      arraysThatNeedEval.push_back(&sources.vars[vars::Q]);
+      arraysThatNeedEval.push_back(&sources.vars[config::Q]);
     } /* End of conduction */
 
     af::eval(arraysThatNeedEval.size(), &arraysThatNeedEval[0]);
   }
 }
 
-void fluidElement::computeExplicitSources(const double dX[3],
-                                          grid &sources,
-                                          int &numReads,
-                                          int &numWrites
-                                         )
+template <typename config>
+void fluidElement::computeExplicitSourcesImpl(const double dX[3],
+                                              grid &sources,
+                                              int &numReads,
+                                              int &numWrites
+                                             )
 {
-  for (int var=0; var<vars::dof; var++)
+  for (int var=0; var<config::dof; var++)
   {
     sources.vars[var] = 0.;
   }
@@ -435,8 +628,45 @@ void fluidElement::computeExplicitSources(const double dX[3],
   // the source terms on the LHS of the equation!
   // All ideal MHD terms are treated explicitly.
   numReads = 0; numWrites = 0;
+#ifdef GRIM_NATIVE_KERNELS
+  if (params::metric != metrics::MINKOWSKI)
+  {
+    native::bufferSet buffers;
+    const af::dim4 dims = rho.dims();
+
+    double *sourcePtrs[config::dof];
+    for (int nu=0; nu<NDIM; nu++)
+    {
+      sourcePtrs[vars::U + nu] = buffers.write(sources.vars[vars::U + nu], 
+                                               dims
+                                              );
+    }
+
+    native::computeGeometricSources<config>(dims.elements(), 
+                                            nativeMetric(buffers, true),
+                                            nativeElement(buffers),
+                                            sourcePtrs
+                                           );
+    numReads  += 64 + 24;
+    numWrites += 4;
+  }
+#else
   if (params::metric != metrics::MINKOWSKI)
   {
+    /* All 16 components are needed here. Materialise them once rather than
+     * re-expanding each row in all four source terms */
+    std::vector<af::array *> TUpDownThatNeedEval;
+    for (int kappa=0; kappa<NDIM; kappa++)
+    {
+      setTUpDownRow<config>(kappa);
+      for (int lamda=0; lamda<NDIM; lamda++)
+      {
+        TUpDownThatNeedEval.push_back(&TUpDown[kappa][lamda]);
+      }
+    }
+    af::eval(TUpDownThatNeedEval.size(), &TUpDownThatNeedEval[0]);
+    numWrites += 16;
+
     for (int nu=0; nu<NDIM; nu++)
     {
       for (int kappa=0; kappa<NDIM; kappa++)
@@ -451,6 +681,7 @@ void fluidElement::computeExplicitSources(const double dX[3],
       }
     }
   }
+#endif /* GRIM_NATIVE_KERNELS */
 
   std::vector<af::array *> arraysThatNeedEval{
                 &sources.vars[vars::RHO],  
@@ -458,12 +689,12 @@ void fluidElement::computeExplicitSources(const double dX[3],
                 &sources.vars[vars::U1],  
                 &sources.vars[vars::U2],  
                 &sources.vars[vars::U3],  
-                &sources.vars[vars::B1],  
-                &sources.vars[vars::B2],  
-                &sources.vars[vars::B3]  
+                &sources.vars[config::B1],  
+                &sources.vars[config::B2],  
+                &sources.vars[config::B3]  
               };
 
-  if (params::conduction || params::viscosity)
+  if (config::emhd)
   {
     // Non-ideal pieces (explicit parts)
     // First, compute part of the source terms
@@ -471,10 +702,10 @@ void fluidElement::computeExplicitSources(const double dX[3],
     // u_{\mu;\nu} and u^{\mu}_{;\mu}
     // First computer derivatives using computeEMHDGradients
     int numReadsEMHDGradients, numWritesEMHDGradients;
-    computeEMHDGradients(dX,
-                         numReadsEMHDGradients,
-                         numWritesEMHDGradients
-                        );
+    computeEMHDGradients<config>(dX,
+                                 numReadsEMHDGradients,
+                                 numWritesEMHDGradients
+                                );
     numReads  += numReadsEMHDGradients;
     numWrites += numWritesEMHDGradients;
 
@@ -492,7 +723,7 @@ void fluidElement::computeExplicitSources(const double dX[3],
       
     // -------------------------------------
     // Now, look at viscosity-specific terms
-    if(params::viscosity)
+    if(config::viscosity)
     {
       // Compute target deltaP (explicit part)
       deltaP0 = -divuCov*rho*nu_emhd;
@@ -508,7 +739,7 @@ void fluidElement::computeExplicitSources(const double dX[3],
       }
 
       array deltaP0Tilde;
-      if (params::highOrderTermsViscosity == 1)
+      if (config::highOrderTermsViscosity)
       {
         deltaP0Tilde = deltaP0 * af::sqrt(tau/rho/nu_emhd/temperature);
       }
@@ -520,19 +751,19 @@ void fluidElement::computeExplicitSources(const double dX[3],
       //Note on sign: we put the sources on the LHS when
       //computing the residual!
       //The damping term proportional to deltaPTilde is in the implicit sector.
-      sources.vars[vars::DP] = -geom->g*(deltaP0Tilde)/tau;
+      sources.vars[config::DP] = -geom->g*(deltaP0Tilde)/tau;
     
-      if (params::highOrderTermsViscosity == 1)
+      if (config::highOrderTermsViscosity)
       {
-        sources.vars[vars::DP] -= 0.5*geom->g*divuCov*deltaPTilde;
+        sources.vars[config::DP] -= 0.5*geom->g*divuCov*deltaPTilde;
       }
 
-      arraysThatNeedEval.push_back(&sources.vars[vars::DP]);
+      arraysThatNeedEval.push_back(&sources.vars[config::DP]);
     } /* End of viscosity specific terms */
     
     // -------------------------------------
     // Finally, look at conduction-specific terms (explicit part)
-    if(params::conduction)
+    if(config::conduction)
     {
       q0 = 0.;
       //q0 is not exactly targetQ, as the time derivative parts
@@ -549,7 +780,7 @@ void fluidElement::computeExplicitSources(const double dX[3],
       }
     
       array q0Tilde;
-      if (params::highOrderTermsConduction == 1)
+      if (config::highOrderTermsConduction)
       {
         q0Tilde = q0 * af::sqrt(  tau/rho/chi_emhd)/temperature;
       }
@@ -561,14 +792,14 @@ void fluidElement::computeExplicitSources(const double dX[3],
       //Note on sign: we put the sources.vars on the LHS when
       //computing the residual!
       // The damping term proportional to qTilde is in the implicit sector. 
-      sources.vars[vars::Q] = -geom->g*(q0Tilde)/tau;
+      sources.vars[config::Q] = -geom->g*(q0Tilde)/tau;
 
-      if (params::highOrderTermsConduction == 1)
+      if (config::highOrderTermsConduction)
       {
-        sources.vars[vars::Q] -= 0.5*geom->g*divuCov*qTilde;
+        sources.vars[config::Q] -= 0.5*geom->g*divuCov*qTilde;
       }
 
-      arraysThatNeedEval.push_back(&sources.vars[vars::Q]);
+      arraysThatNeedEval.push_back(&sources.vars[config::Q]);
     } /* End of conduction */
 
   } /* End of EMHD: viscosity || conduction */
@@ -576,6 +807,7 @@ void fluidElement::computeExplicitSources(const double dX[3],
   af::eval(arraysThatNeedEval.size(), &arraysThatNeedEval[0]);
 }
 
+template <typename config>
 void fluidElement::computeEMHDGradients(const double dX[3],
                                         int &numReads,
                                         int &numWrites
@@ -600,7 +832,7 @@ void fluidElement::computeEMHDGradients(const double dX[3],
     numWrites += numWritesTmp;
 
     graduCov[2][mu] = 0.;
-    if(params::dim>1)
+    if(config::dim>1)
     {
       graduCov[2][mu] = reconstruction::slope(directions::X2,dX2,uCov[mu],
                                               numReadsTmp, numWritesTmp
@@ -610,7 +842,7 @@ void fluidElement::computeEMHDGradients(const double dX[3],
     }
   
     graduCov[3][mu] = 0.;
-    if(params::dim>2)
+    if(config::dim>2)
     {
       graduCov[3][mu] = reconstruction::slope(directions::X3,dX3,uCov[mu],
                                               numReadsTmp, numWritesTmp
@@ -639,7 +871,7 @@ void fluidElement::computeEMHDGradients(const double dX[3],
           };
   af::eval(arraysThatNeedEval.size(), &arraysThatNeedEval[0]);
   
-  if(params::conduction)
+  if(config::conduction)
   {
     /* Time derivative not computed here */
     gradT[0] = 0.;
@@ -652,7 +884,7 @@ void fluidElement::computeEMHDGradients(const double dX[3],
     numWrites += numWritesTmp;
 
     gradT[2] = 0.;
-    if(params::dim>1)
+    if(config::dim>1)
     {
       gradT[2] = reconstruction::slope(directions::X2,dX2,temperature,
                                        numReadsTmp, numWritesTmp
@@ -662,7 +894,7 @@ void fluidElement::computeEMHDGradients(const double dX[3],
     }  
 
     gradT[3] = 0.;
-    if(params::dim>2)
+    if(config::dim>2)
     {
       gradT[3] = reconstruction::slope(directions::X3,dX3,temperature,
                                        numReadsTmp, numWritesTmp
@@ -672,3 +904,71 @@ void fluidElement::computeEMHDGradients(const double dX[3],
     }
   } /* End of conduction specific terms */
 }
+
+#ifdef GRIM_NATIVE_KERNELS
+native::metricPtrs fluidElement::nativeMetric(native::bufferSet &buffers,
+                                              const bool readConnection
+                                             ) const
+{
+  native::metricPtrs metric;
+  metric.alpha = buffers.read(geom->alpha);
+  metric.g     = buffers.read(geom->g);
+
+  for (int mu=0; mu<NDIM; mu++)
+  {
+    for (int nu=0; nu<NDIM; nu++)
+    {
+      /* The stacked face metric of the Riemann solver leaves the components
+       * that are not read there empty */
+      metric.gCov[mu][nu] = geom->gCov[mu][nu].isempty() ? NULL
+                          : buffers.read(geom->gCov[mu][nu]);
+      metric.gCon[mu][nu] = geom->gCon[mu][nu].isempty() ? NULL
+                          : buffers.read(geom->gCon[mu][nu]);
+
+      for (int lamda=0; lamda<NDIM; lamda++)
+      {
+        metric.gammaUpDownDown[mu][nu][lamda] = 
+          readConnection ? buffers.read(geom->gammaUpDownDown[mu][nu][lamda])
+                         : NULL;
+      }
+    }
+  }
+
+  return metric;
+}
+
+native::elementPtrs<const double> 
+  fluidElement::nativeElement(native::bufferSet &buffers) const
+{
+  native::elementPtrs<const double> e;
+  e.rho                = buffers.read(rho);
+  e.u                  = buffers.read(u);
+  e.pressure           = buffers.read(pressure);
+  e.temperature        = buffers.read(temperature);
+  e.soundSpeed         = buffers.read(soundSpeed);
+  e.gammaLorentzFactor = buffers.read(gammaLorentzFactor);
+  for (int mu=0; mu<NDIM; mu++)
+  {
+    e.uCon[mu] = buffers.read(uCon[mu]);
+    e.uCov[mu] = buffers.read(uCov[mu]);
+    e.bCon[mu] = buffers.read(bCon[mu]);
+    e.bCov[mu] = buffers.read(bCov[mu]);
+  }
+  e.bSqr  = buffers.read(bSqr);
+  e.bNorm = buffers.read(bNorm);
+
+  e.qTilde = e.q = e.deltaPTilde = e.deltaP = NULL;
+  if (params::conduction)
+  {
+    e.qTilde = buffers.read(qTilde);
+    e.q      = buffers.read(q);
+  }
+  if (params::viscosity)
+  {
+    e.deltaPTilde = buffers.read(deltaPTilde);
+    e.deltaP      = buffers.read(deltaP);
+  }
+
+  return e;
+}
+#endif /* GRIM_NATIVE_KERNELS */
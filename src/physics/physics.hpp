@@ -5,6 +5,10 @@
 #include "../grid/grid.hpp"
 #include "../geometry/geometry.hpp"
 #include "../reconstruction/reconstruction.hpp"
+#include "physicsconfig.hpp"
+#ifdef GRIM_NATIVE_KERNELS
+  #include "nativekernels.hpp"
+#endif
 
 inline int DELTA(int const &mu, int const &nu)
 {
@@ -13,6 +17,7 @@ inline int DELTA(int const &mu, int const &nu)
 
 class fluidElement
 {
+  template <typename config>
   void computeEMHDGradients(const double dX[3],
                             int &numReads,
                             int &numWrites
@@ -32,6 +37,8 @@ class fluidElement
     array bSqr, bCon[NDIM], bCov[NDIM];
     array soundSpeed;
     
+    /* Rows are only filled in once requested by computeFluxes() or
+     * computeExplicitSources(). See setTUpDownRow() */
     array NUp[NDIM];
     array TUpDown[NDIM][NDIM];
 
@@ -97,6 +104,87 @@ class fluidElement
     array eCon[NDIM][NDIM];
     array eCov[NDIM][NDIM];
     geometry *geom;
+
+    /* Instantiations of the routines below for the physicsConfig matching
+     * the runtime params. Selected once in the constructor. */
+    struct kernels
+    {
+      void (fluidElement::*set)(const grid &prim,
+                                int &numReads,
+                                int &numWrites
+                               );
+      void (fluidElement::*computeFluxes)(const int direction,
+                                          grid &flux,
+                                          int &numReads,
+                                          int &numWrites
+                                         );
+      void (fluidElement::*computeTimeDerivSources)(const fluidElement &elemOld,
+                                                    const fluidElement &elemNew,
+                                                    const double dt,
+                                                    grid &sources,
+                                                    int &numReads,
+                                                    int &numWrites
+                                                   );
+      void (fluidElement::*computeImplicitSources)(grid &sources,
+                                                   array &tauDamp,
+                                                   int &numReads,
+                                                   int &numWrites
+                                                  );
+      void (fluidElement::*computeExplicitSources)(const double dX[3],
+                                                   grid &sources,
+                                                   int &numReads,
+                                                   int &numWrites
+                                                  );
+    };
+    template <typename config> struct kernelTable
+    {
+      static kernels get();
+    };
+    kernels physicsKernels;
+
+    bool TUpDownRowIsSet[NDIM];
+    template <typename config>
+    void setTUpDownRow(const int mu);
+
+#ifdef GRIM_NATIVE_KERNELS
+    native::metricPtrs nativeMetric(native::bufferSet &buffers,
+                                    const bool readConnection
+                                   ) const;
+    native::elementPtrs<const double> 
+      nativeElement(native::bufferSet &buffers) const;
+#endif
+
+    template <typename config>
+    void setImpl(const grid &prim,
+                 int &numReads,
+                 int &numWrites
+                );
+    template <typename config>
+    void computeFluxesImpl(const int direction,
+                           grid &flux,
+                           int &numReads,
+                           int &numWrites
+                          );
+    template <typename config>
+    void computeTimeDerivSourcesImpl(const fluidElement &elemOld,
+                                     const fluidElement &elemNew,
+                                     const double dt,
+                                     grid &sources,
+                                     int &numReads,
+                                     int &numWrites
+                                    );
+    template <typename config>
+    void computeImplicitSourcesImpl(grid &sources,
+                                    array &tauDamp,
+                                    int &numReads,
+                                    int &numWrites
+                                   );
+    template <typename config>
+    void computeExplicitSourcesImpl(const double dX[3],
+                                    grid &sources,
+                                    int &numReads,
+                                    int &numWrites
+                                   );
     
     void normalize(array vCon[NDIM]
                   );
@@ -110,21 +198,25 @@ class fluidElement
 class riemannSolver
 {
   public:
+    /* Both face states are evaluated in one pass with the states stacked
+     * along the 4th array dimension: [..., 0] holds the state at i-1/2 + eps
+     * (the right state of the face to the left) and [..., 1] the state at
+     * i+1/2 - eps (the left state of the face to the right). */
     fluidElement *elemFace;
 
-    grid *fluxLeft, *fluxRight;
-    grid *consLeft, *consRight;
-
-    array minSpeedLeft,  maxSpeedLeft;
-    array minSpeedRight, maxSpeedRight;
+    grid *primFaces, *fluxFaces, *consFaces;
+    array minSpeedFaces, maxSpeedFaces;
 
     riemannSolver(const grid &prim, geometry &geom);
     ~riemannSolver();
 
-    void solve(const grid &primLeft,
-               const grid &primRight,
-               geometry &geomLeft,
-               geometry &geomRight,
+    /* primFacesSoA is N1Total x N2Total x N3Total x 2*numVars, as given by
+     * reconstruction::reconstructFaces(): both face states of var at
+     * 2*var and 2*var + 1, so that they are read without a copy.
+     * geomFaces holds the geometries on the faces i-1/2 and i+1/2 of every
+     * zone, stacked the same way by geometry::stackFaces(). */
+    void solve(const array &primFacesSoA,
+               geometry &geomFaces,
                const int dir,
                grid &flux,
                int &numReads,
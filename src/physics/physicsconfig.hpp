@@ -0,0 +1,93 @@
+#ifndef GRIM_PHYSICSCONFIG_H_
+#define GRIM_PHYSICSCONFIG_H_
+
+#include "../params.hpp"
+
+/* Compile-time description of the physics being evolved. The hot routines in
+ * fluidElement and timeStepper are templated on this struct so that the
+ * branches on params::dim, params::conduction, params::viscosity and the
+ * highOrderTerms flags are resolved by the compiler. The variable count and
+ * the indices of the EMHD and magnetic field variables are compile-time
+ * constants, which lets loops over the variables be unrolled.
+ *
+ * The high order flags are only meaningful when the corresponding EMHD
+ * physics is switched on, so instantiations with, for ex, Conduction=false
+ * and HighOrderConduction=true are never selected. */
+template <int Dim,
+          bool Conduction, bool HighOrderConduction,
+          bool Viscosity,  bool HighOrderViscosity
+         >
+struct physicsConfig
+{
+  static const int  dim                      = Dim;
+  static const bool conduction               = Conduction;
+  static const bool viscosity                = Viscosity;
+  static const bool highOrderTermsConduction = HighOrderConduction;
+  static const bool highOrderTermsViscosity  = HighOrderViscosity;
+  static const bool emhd                     = Conduction || Viscosity;
+
+  /* Same layout as the vars:: indices set in the problem params.cpp */
+  static const int Q            = 5;
+  static const int DP           = 5 + Conduction;
+  static const int numFluidVars = 5 + Conduction + Viscosity;
+  static const int B1           = 5 + Conduction + Viscosity;
+  static const int B2           = 6 + Conduction + Viscosity;
+  static const int B3           = 7 + Conduction + Viscosity;
+  static const int dof          = 8 + Conduction + Viscosity;
+};
+
+/* Runtime dispatch to the instantiation matching the params. table<config>
+ * must provide a static get() returning a value of type T, typically a
+ * struct of member function pointers bound to the config. The selection is
+ * done once, when the object that owns the table is constructed. */
+namespace physicsConfigDispatch
+{
+  template <typename T, template <typename> class table,
+            int Dim, bool Conduction, bool HighOrderConduction
+           >
+  T selectViscosity()
+  {
+    if (!params::viscosity)
+    {
+      return table<physicsConfig<Dim, Conduction, HighOrderConduction,
+                                 false, false> >::get();
+    }
+    else if (!params::highOrderTermsViscosity)
+    {
+      return table<physicsConfig<Dim, Conduction, HighOrderConduction,
+                                 true, false> >::get();
+    }
+    return table<physicsConfig<Dim, Conduction, HighOrderConduction,
+                               true, true> >::get();
+  }
+
+  template <typename T, template <typename> class table, int Dim>
+  T selectConduction()
+  {
+    if (!params::conduction)
+    {
+      return selectViscosity<T, table, Dim, false, false>();
+    }
+    else if (!params::highOrderTermsConduction)
+    {
+      return selectViscosity<T, table, Dim, true, false>();
+    }
+    return selectViscosity<T, table, Dim, true, true>();
+  }
+}
+
+template <typename T, template <typename> class table>
+T selectPhysicsConfig()
+{
+  switch (params::dim)
+  {
+    case 1:
+      return physicsConfigDispatch::selectConduction<T, table, 1>();
+
+    case 2:
+      return physicsConfigDispatch::selectConduction<T, table, 2>();
+  }
+  return physicsConfigDispatch::selectConduction<T, table, 3>();
+}
+
+#endif /* GRIM_PHYSICSCONFIG_H_ */
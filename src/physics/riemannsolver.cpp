@@ -12,42 +12,44 @@ riemannSolver::riemannSolver(const grid &prim,
   int dim      = prim.dim;
   int numVars  = prim.numVars;
 
-  fluxLeft  = new grid(N1, N2, N3, 
+  /* On the communicator of prim, which is only this rank for the tiles of
+   * timeStepper::computeDivOfFluxes() */
+  primFaces = new grid(N1, N2, N3,
                        dim, numVars, numGhost,
-                       false, false, false
+                       false, false, false, prim.comm
                       );
 
-  fluxRight = new grid(N1, N2, N3,
+  fluxFaces = new grid(N1, N2, N3,
                        dim, numVars, numGhost,
-                       false, false, false
+                       false, false, false, prim.comm
                       );
 
-  consLeft  = new grid(N1, N2, N3,
+  consFaces = new grid(N1, N2, N3,
                        dim, numVars, numGhost,
-                       false, false, false
-                      );
-
-  consRight = new grid(N1, N2, N3,
-                       dim, numVars, numGhost,
-                       false, false, false
+                       false, false, false, prim.comm
                       );
 
+  /* elemFace is sized from the zone-centered state, then given the
+   * stacked dimensions of the faces for the arrays it allocates once (one,
+   * zero, ...). Its state is set anew in every solve() */
   int numReads, numWrites;
-  elemFace  = new fluidElement(prim, geom,
-                               numReads, numWrites
-                              );
+  elemFace = new fluidElement(prim, geom, numReads, numWrites);
+  const af::dim4 centerDims = prim.vars[0].dims();
+  elemFace->one  = af::constant(1, centerDims[0], centerDims[1],
+                                centerDims[2], 2, f64
+                               );
+  elemFace->zero = 0.*elemFace->one;
 
   /* Allocate space for the wavespeeds using elemFace->one */
-  minSpeedLeft  = elemFace->one;
-  minSpeedRight = elemFace->one;
-  maxSpeedLeft  = elemFace->one;
-  maxSpeedRight = elemFace->one;
+  minSpeedFaces = elemFace->one;
+  maxSpeedFaces = elemFace->one;
 }
 
 riemannSolver::~riemannSolver()
 {
-  delete fluxLeft, fluxRight;
-  delete consLeft, consRight;
+  delete primFaces;
+  delete fluxFaces;
+  delete consFaces;
   delete elemFace;
 }
 
@@ -58,6 +60,48 @@ void fluidElement::computeMinMaxCharSpeeds(const int dir,
                                            int &numWrites
                                           )
 {
+#ifdef GRIM_NATIVE_KERNELS
+  {
+    native::bufferSet buffers;
+    const af::dim4 dims = rho.dims();
+
+    const double *tauPtr = NULL, *chiPtr = NULL, *nuPtr = NULL;
+    if (params::conduction || params::viscosity)
+    {
+      tauPtr = buffers.read(tau);
+    }
+    if (params::conduction)
+    {
+      chiPtr = buffers.read(chi_emhd);
+    }
+    if (params::viscosity)
+    {
+      nuPtr  = buffers.read(nu_emhd);
+    }
+
+    native::computeMinMaxCharSpeeds(dims.elements(), dir,
+                                    nativeMetric(buffers, false),
+                                    nativeElement(buffers),
+                                    tauPtr, chiPtr, nuPtr,
+                                    buffers.write(minSpeed, dims),
+                                    buffers.write(maxSpeed, dims)
+                                   );
+  }
+  /* Reads:
+   * -----
+   *  rho, u, bSqr, soundSpeed, uCon[0], uCon[dir] : 6
+   *  gCon[0][0], gCon[dir][dir], gCon[dir][0] : 3
+   *  tau, chi_emhd, nu_emhd : EMHD only
+   *
+   * Writes:
+   * ------
+   * minSpeed, maxSpeed : 2 */
+  numReads  = 9 + 2*params::conduction + 2*params::viscosity;
+  numWrites = 2;
+
+  return;
+#endif
+
   array zero = 0.*one;
   numReads = 0;
   numWrites = 0;
@@ -132,48 +176,21 @@ void fluidElement::computeMinMaxCharSpeeds(const int dir,
       sdir=3; break;
   }
 
-  array ACov[NDIM], ACon[NDIM];
-  array BCov[NDIM], BCon[NDIM];
-  for (int mu=0; mu<NDIM; mu++)
-  {
-    ACov[mu] = zero;
-    BCov[mu] = zero;
-  }
-  ACov[sdir] = one;
-  BCov[0]    = one;
-  for (int mu=0; mu<NDIM; mu++)
-  {
-    ACon[mu] = zero;
-    BCon[mu] = zero;
-
-    for(int nu=0;nu<NDIM; nu++)
-    {
-      ACon[mu] += geom->gCon[mu][nu]*ACov[nu];
-      BCon[mu] += geom->gCon[mu][nu]*BCov[nu];
-    }
-  }
-  numReads += 16;
+  /* With A_mu = delta_mu^sdir and B_mu = delta_mu^0 the contractions reduce
+   * to components of gCon and uCon */
+  array ASqr  = geom->gCon[sdir][sdir];
+  array BSqr  = geom->gCon[0][0];
+  array ADotU = uCon[sdir];
+  array BDotU = uCon[0];
+  array ADotB = geom->gCon[sdir][0];
+  numReads += 3;
   /* Reads:
    * -----
-   * geom.gCon[mu][nu] : 16
+   * geom.gCon[0][0], geom.gCon[sdir][sdir], geom.gCon[sdir][0] : 3
    *
    * Writes: 0
    * ------ */
 
-  array ASqr = zero;
-  array BSqr = zero;
-  array ADotU = zero;
-  array BDotU = zero;
-  array ADotB = zero;
-  for (int mu=0; mu<NDIM; mu++)
-  {
-    ASqr += ACov[mu]*ACon[mu];
-    BSqr += BCov[mu]*BCon[mu];
-    ADotU += ACov[mu]*uCon[mu];
-    BDotU += BCov[mu]*uCon[mu];
-    ADotB += ACov[mu]*BCon[mu];
-  }
-
   array A = (BDotU*BDotU)   - (BSqr + BDotU*BDotU)*csSqr;
   array B = 2.*(ADotU*BDotU - (ADotB + ADotU*BDotU)*csSqr);
   array C = ADotU*ADotU     - (ASqr + ADotU*ADotU)*csSqr;
@@ -200,39 +217,105 @@ void fluidElement::computeMinMaxCharSpeeds(const int dir,
    * ------ */
 }
 
-void riemannSolver::solve(const grid &primLeft,
-                          const grid &primRight,
-                          geometry &geomLeft,
-                          geometry &geomRight,
+namespace
+{
+  /* in = {minSpeedLeft, maxSpeedLeft, minSpeedRight, maxSpeedRight,
+   *       fluxLeft[0], fluxRight[0], consLeft[0], consRight[0],
+   *       fluxLeft[1], ...}, out = {flux[0], flux[1], ...} */
+  template <typename config>
+  struct riemannKernel
+  {
+    static const int numInputs  = 4 + 4*config::dof;
+    static const int numOutputs = config::dof;
+
+    int dir;
+
+    template <typename field, typename T>
+    void operator()(const field in[], T out[]) const
+    {
+      T minSpeed = stencil::min(in[0].at(dir, -1), in[2].at(dir, 0));
+      T maxSpeed = stencil::max(in[1].at(dir, -1), in[3].at(dir, 0));
+
+      for (int var=0; var < config::dof; var++)
+      {
+        T fluxLeft  = in[4 + 4*var    ].at(dir, -1);
+        T fluxRight = in[4 + 4*var + 1].at(dir,  0);
+        T consLeft  = in[4 + 4*var + 2].at(dir, -1);
+        T consRight = in[4 + 4*var + 3].at(dir,  0);
+
+        if (params::riemannSolver == riemannSolvers::HLL)
+        {
+          out[var] =
+            (   maxSpeed * fluxLeft
+              - minSpeed * fluxRight
+              + minSpeed * maxSpeed * (consRight - consLeft)
+            )/(maxSpeed - minSpeed);
+        }
+        else if (params::riemannSolver == riemannSolvers::LOCAL_LAX_FRIEDRICH)
+        {
+          out[var] =
+           0.5*(  fluxLeft + fluxRight
+                - stencil::max(maxSpeed, -minSpeed)*(consRight - consLeft)
+               );
+        }
+      }
+    }
+  };
+
+  typedef void (*riemannLauncher)(const int dir,
+                                  const af::array faces[], grid &flux
+                                 );
+
+  template <typename config>
+  void applyRiemannKernel(const int dir, const af::array faces[], grid &flux)
+  {
+    riemannKernel<config> kernel;
+    kernel.dir = dir;
+
+    const af::array *in[riemannKernel<config>::numInputs];
+    af::array *out[riemannKernel<config>::numOutputs];
+    for (int n=0; n < riemannKernel<config>::numInputs; n++)
+    {
+      in[n] = &faces[n];
+    }
+    for (int var=0; var < config::dof; var++)
+    {
+      out[var] = &flux.vars[var];
+    }
+    stencil::apply(kernel, 1, in, out);
+  }
+
+  /* The counts of the kernel come from the physicsConfig of the params */
+  template <typename config> struct riemannKernelTable
+  {
+    static riemannLauncher get()
+    {
+      return &applyRiemannKernel<config>;
+    }
+  };
+}
+
+void riemannSolver::solve(const array &primFacesSoA,
+                          geometry &geomFaces,
                           const int dir,
                           grid &flux,
                           int &numReads,
                           int &numWrites
                          )
 {
-  int shiftX1, shiftX2, shiftX3;
   int fluxDirection;
   switch (dir)
   {
     case directions::X1:
       fluxDirection = 1;
-      shiftX1  = 1;
-      shiftX2  = 0;
-      shiftX3  = 0;
       break;
 
     case directions::X2:
       fluxDirection = 2;
-      shiftX1  = 0;
-      shiftX2  = 1;
-      shiftX3  = 0;
       break;
 
     case directions::X3:
       fluxDirection = 3;
-      shiftX1  = 0;
-      shiftX2  = 0;
-      shiftX3  = 1;
       break;
   }
 
@@ -240,33 +323,25 @@ void riemannSolver::solve(const grid &primLeft,
   int numReadsComputeFluxes, numWritesComputeFluxes;
   int numReadsCharSpeeds, numWritesCharSpeeds;
 
-  /* Compute fluxes and cons at i+1/2 - eps : left flux on right face */
-  elemFace->set(primRight, geomRight,
-                numReadsElemSet, numWritesElemSet
-               );
-  elemFace->computeFluxes(fluxDirection, *fluxLeft,
-                          numReadsComputeFluxes, numWritesComputeFluxes
-                         );
-  elemFace->computeFluxes(0,             *consLeft,
-                          numReadsComputeFluxes, numWritesComputeFluxes
-                         );
-  elemFace->computeMinMaxCharSpeeds(dir, 
-                                    minSpeedLeft, maxSpeedLeft,
-                                    numReadsCharSpeeds, numWritesCharSpeeds
-                                   );
-
-  /* Compute fluxes and cons at i-1/2 + eps : right flux on left face */
-  elemFace->set(primLeft, geomLeft,
-                numReadsElemSet, numWritesElemSet
-               );
-  elemFace->computeFluxes(fluxDirection, *fluxRight,
+  /* [..., 0] : fluxes and cons at i-1/2 + eps, right flux on left face
+   * [..., 1] : fluxes and cons at i+1/2 - eps, left flux on right face
+   * Both are evaluated by a single pass of the fluid element. The states of
+   * every var are contiguous in primFacesSoA, so they are only views. */
+  for (int var=0; var < primFaces->numVars; var++)
+  {
+    primFaces->vars[var] = primFacesSoA(span, span, span,
+                                        af::seq(2*var, 2*var + 1)
+                                       );
+  }
+  elemFace->set(*primFaces, geomFaces, numReadsElemSet, numWritesElemSet);
+  elemFace->computeFluxes(fluxDirection, *fluxFaces,
                           numReadsComputeFluxes, numWritesComputeFluxes
                          );
-  elemFace->computeFluxes(0,             *consRight,
+  elemFace->computeFluxes(0,             *consFaces,
                           numReadsComputeFluxes, numWritesComputeFluxes
                          );
   elemFace->computeMinMaxCharSpeeds(dir, 
-                                    minSpeedRight, maxSpeedRight,
+                                    minSpeedFaces, maxSpeedFaces,
                                     numReadsCharSpeeds, numWritesCharSpeeds
                                    );
 
@@ -278,56 +353,36 @@ void riemannSolver::solve(const grid &primLeft,
                 );
 
   /* The fluxes are requested on the left-face i-1/2.
-   * Hence, we need to shift elemLeft,fluxLeft,consLeft by a single point to the right
-   * (elemLeft[i] refers to values at i+1/2, we want values at i-1/2) */
-  minSpeedLeft = af::shift(minSpeedLeft,shiftX1, shiftX2, shiftX3);
-  maxSpeedLeft = af::shift(maxSpeedLeft,shiftX1, shiftX2, shiftX3);
-  minSpeedLeft = af::min(minSpeedLeft, minSpeedRight);
-  maxSpeedLeft = af::max(maxSpeedLeft, maxSpeedRight);
-  numReads += 4;
-  /* Reads:
-   * -----
-   *  minSpeedLeft, minSpeedRight, maxSpeedLeft, maxSpeedRight : 4
-   *
-   * Writes: 0
-   * ------ */
-
-  std::vector<af::array *> arraysThatNeedEval;
-  for (int var=0; var < primLeft.numVars; var++)
+   * Hence, the left states fluxLeft, consLeft and the left char speeds are
+   * read a single point to the left ([..., 1] at i refers to values at
+   * i+1/2, we want values at i-1/2). All variables are combined in one
+   * stencil. */
+  const int numVars = primFaces->numVars;
+  std::vector<af::array> faces(4 + 4*numVars);
+  faces[0] = minSpeedFaces(span, span, span, 1);
+  faces[1] = maxSpeedFaces(span, span, span, 1);
+  faces[2] = minSpeedFaces(span, span, span, 0);
+  faces[3] = maxSpeedFaces(span, span, span, 0);
+  for (int var=0; var < numVars; var++)
   {
-    if (params::riemannSolver == riemannSolvers::HLL)
-    {
-      flux.vars[var] = 
-        (   maxSpeedLeft * af::shift(fluxLeft->vars[var], shiftX1, shiftX2, shiftX3) 
-          - minSpeedLeft * fluxRight->vars[var]
-          + minSpeedLeft * maxSpeedLeft 
-          * (  consRight->vars[var]
-             - af::shift(consLeft->vars[var], shiftX1, shiftX2, shiftX3)
-            )
-        )/(maxSpeedLeft - minSpeedLeft);
-    }
-    else if (params::riemannSolver == riemannSolvers::LOCAL_LAX_FRIEDRICH)
-    {
-      flux.vars[var] =
-       0.5*(af::shift(fluxLeft->vars[var], shiftX1, shiftX2, shiftX3)
-            + fluxRight->vars[var]
-            - af::max(maxSpeedLeft,-minSpeedLeft)*
-            (  consRight->vars[var] 
-             - af::shift(consLeft->vars[var], shiftX1, shiftX2, shiftX3)
-            )
-           );
-    }
-
-    arraysThatNeedEval.push_back(&flux.vars[var]);
+    faces[4 + 4*var]     = fluxFaces->vars[var](span, span, span, 1);
+    faces[4 + 4*var + 1] = fluxFaces->vars[var](span, span, span, 0);
+    faces[4 + 4*var + 2] = consFaces->vars[var](span, span, span, 1);
+    faces[4 + 4*var + 3] = consFaces->vars[var](span, span, span, 0);
   }
-  af::eval(arraysThatNeedEval.size(), &arraysThatNeedEval[0]);
+
+  selectPhysicsConfig<riemannLauncher, riemannKernelTable>()(dir, &faces[0],
+                                                             flux
+                                                            );
   /* Reads:
    * -----
+   *  minSpeedLeft, minSpeedRight, maxSpeedLeft, maxSpeedRight : 4
    *  fluxLeft[var], fluxRight[var], consLeft[var], consRight[var] : 4*numVars
    *
    * Writes:
    * ------
    * flux[var] : numVars */
-  numReads  += 4*primLeft.numVars;
-  numWrites +=   primLeft.numVars;
+  numReads  += 4;
+  numReads  += 4*numVars;
+  numWrites +=   numVars;
 }
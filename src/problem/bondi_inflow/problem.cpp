@@ -7,7 +7,11 @@ void fluidElement::setFluidElementParameters()
   nu_emhd  = soundSpeed*soundSpeed*tau;
 }
 
-void timeStepper::applyProblemSpecificFluxFilter(int &numReads,int &numWrites)
+void timeStepper::applyProblemSpecificFluxFilter(grid &fluxX1, grid &fluxX2,
+                                                 grid &fluxX3,
+                                                 const int tileOffset[3],
+                                                 int &numReads,int &numWrites
+                                                )
 {
 }
 
@@ -5,6 +5,39 @@ namespace params
 {
   int numDevices = 4;
 
+  // Size-class arena for the ArrayFire allocations (ArrayFire >= 3.7)
+  int memoryArena = 1;
+
+  // Compiled ArrayFire kernels are kept in a subfolder of this one, per
+  // configuration, and reused by later runs. Empty to disable.
+  std::string kernelCacheDir = "kernelCache";
+
+  // Metric and connection coefficients are saved here, one file per rank and
+  // location, and read back by runs on the same grid. Empty to disable.
+  std::string geometryCacheDir = "geometryCache";
+
+  // Rows of zones along the outermost direction (X2 in 2D, X3 in 3D) in
+  // which the fluxes and their divergence are computed one after the other,
+  // so that the fluxes of a tile stay in cache. 0 for the whole grid at once
+  int fluxTileRows = 0;
+
+  // HDF5 dumps are written by a background thread, which needs an MPI
+  // library with MPI_THREAD_MULTIPLE. 0 to write them synchronously.
+  int asyncIO = 1;
+
+  // Shuffle + deflate level of the HDF5 dumps, 0 (uncompressed) to 9
+  int dumpCompressionLevel = 4;
+
+  // Print the time of every phase on rank 0 every step, and the timings over
+  // the ranks with every report below
+  int printPerformanceReport = 1;
+
+  // Min, max and mean over the ranks of the time per step of every phase,
+  // written every timingReportEveryNSteps steps (0: none) to timingLogFile,
+  // CSV or, with a name ending in .json, JSON lines
+  int timingReportEveryNSteps = 10;
+  std::string timingLogFile = "timings.csv";
+
   int N1 = 64;
   int N2 = 64;
   int N3 = 128;
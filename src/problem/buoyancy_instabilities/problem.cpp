@@ -1,4 +1,5 @@
 #include "../problem.hpp"
+#include "../../grid/xdmf.hpp"
 
 namespace problemParams
 {
@@ -357,9 +358,20 @@ void timeStepper::fullStepDiagnostics(int &numReads,int &numWrites)
       geomBottom->gGrid->dump("sqrtDetg","sqrtDetgBottom.h5");
       geomBottom->xCoordsGrid->dump("xCoords","xCoordsBottom.h5");
     }
+    // The XDMF index points to xCoordsCenter.h5, which restarts also need
+    static xdmfSeries *series = NULL;
+    if(series==NULL)
+    {
+      if(WriteIdx>0)
+      {
+        geomCenter->xCoordsGrid->dump("xCoords","xCoordsCenter.h5");
+      }
+      series = new xdmfSeries("primVars.xmf",*primOld,
+                              "xCoordsCenter.h5","xCoords",WriteIdx>0
+                             );
+    }
       
     std::string filename   = "primVarsT";
-    std::string filenameVTS= "primVarsT";
     std::string B1filename = "B1Left";
     std::string B2filename = "B2Bottom";
     std::string B3filename = "B3Back";
@@ -374,11 +386,9 @@ void timeStepper::fullStepDiagnostics(int &numReads,int &numWrites)
     }
       
     filename=filename+s_idx;
-    filenameVTS=filename;
     filename=filename+".h5";
     primOld->dump("primitives",filename);
 
-    filenameVTS=filenameVTS+".vts";
     std::string varNames[vars::dof];
     varNames[vars::RHO] = "rho";
     varNames[vars::U]   = "u";
@@ -397,7 +407,9 @@ void timeStepper::fullStepDiagnostics(int &numReads,int &numWrites)
       varNames[vars::DP]  = "dP";
     }
 
-    primOld->dumpVTS(*geomCenter->xCoordsGrid, varNames, filenameVTS);
+    series->beginStep(time);
+    series->addVars(filename, "primitives", vars::dof, varNames);
+    series->endStep();
 
   }
 
@@ -408,7 +420,11 @@ void timeStepper::fullStepDiagnostics(int &numReads,int &numWrites)
 
 }
 
-void timeStepper::applyProblemSpecificFluxFilter(int &numReads,int &numWrites)
+void timeStepper::applyProblemSpecificFluxFilter(grid &fluxX1, grid &fluxX2,
+                                                 grid &fluxX3,
+                                                 const int tileOffset[3],
+                                                 int &numReads,int &numWrites
+                                                )
 {
 
 }
@@ -516,7 +516,11 @@ void timeStepper::setProblemSpecificBCs(int &numReads,int &numWrites)
 
 }
 
-void timeStepper::applyProblemSpecificFluxFilter(int &numReads,int &numWrites)
+void timeStepper::applyProblemSpecificFluxFilter(grid &fluxX1, grid &fluxX2,
+                                                 grid &fluxX3,
+                                                 const int tileOffset[3],
+                                                 int &numReads,int &numWrites
+                                                )
 {
 
 }
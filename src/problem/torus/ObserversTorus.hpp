@@ -2,6 +2,7 @@
 #define GRIM_OBSTORUS_HPP
 
 #include "../problem.hpp"
+#include "../../grid/reducedoutput.hpp"
 
 void ComputeEnergyIntegrals(fluidElement* elemObs, grid* primObs, geometry* geomObs, const double volElem)
 {
@@ -250,4 +251,88 @@ void ComputeBoundaryFluxes(fluidElement* elemObs, grid* primObs, geometry* geomO
 	      MassFlowIn,MassFlowOut,UnboundMassFlowOut,RelativisticUnboundMassFlowOut);
 }
 
+// Reduced outputs, appended to reducedVars.h5: shell averages over X2,X3 of
+// rho, u, bSqr and gamma as radial profiles, the profiles and horizon values
+// of the mass accretion rate and of the magnetic flux, and the equatorial
+// and meridional (X3 = 0) planes of rho, u and bSqr
+void WriteReducedOutputs(reducedOutputFile* output, fluidElement* elemObs, grid* primObs, geometry* geomObs, const double dArea, const double time)
+{
+  int world_rank;
+  MPI_Comm_rank(PETSC_COMM_WORLD, &world_rank);
+  const int N1 = primObs->N1;
+
+  array xCoords[3];
+  geomObs->getxCoords(xCoords);
+  const array areaElem = geomObs->g*dArea;
+
+  enum {AREA, RHO, U, BSQR, GAMMA, RADIUS, MDOT, PHIB, numIntegrands};
+  array integrands[numIntegrands];
+  integrands[AREA]   = areaElem;
+  integrands[RHO]    = primObs->vars[vars::RHO]*areaElem;
+  integrands[U]      = primObs->vars[vars::U]*areaElem;
+  integrands[BSQR]   = elemObs->bSqr*areaElem;
+  integrands[GAMMA]  = elemObs->gammaLorentzFactor*areaElem;
+  integrands[RADIUS] = xCoords[0]*areaElem;
+  integrands[MDOT]   = -primObs->vars[vars::RHO]*elemObs->uCon[1]*areaElem;
+  integrands[PHIB]   = 0.5*af::abs(primObs->vars[vars::B1])*areaElem;
+  std::vector<double> sums = reductions::shellSums(*primObs,numIntegrands,integrands);
+
+  // Shell averages (rank 0 only holds the sums)
+  std::vector<double> profiles(numIntegrands*N1);
+  for(int n=0;n<numIntegrands;n++)
+  {
+    for(int i=0;i<N1;i++)
+    {
+      profiles[n*N1+i] = sums[n*N1+i];
+      if(n!=AREA && n!=MDOT && n!=PHIB && world_rank==0)
+      {
+        profiles[n*N1+i] /= sums[AREA*N1+i];
+      }
+    }
+  }
+
+  // First zone outside of the horizon
+  const double rHorizon = 1.+sqrt(1.-params::blackHoleSpin*params::blackHoleSpin);
+  int iHorizon = 0;
+  while(iHorizon<N1-1 && profiles[RADIUS*N1+iHorizon]<rHorizon)
+  {
+    iHorizon++;
+  }
+
+  output->beginRow(time);
+  output->write("horizon/Mdot",0,NULL,&profiles[MDOT*N1+iHorizon]);
+  output->write("horizon/PhiB",0,NULL,&profiles[PHIB*N1+iHorizon]);
+  output->write("profiles/r",1,&N1,&profiles[RADIUS*N1]);
+  output->write("profiles/rho",1,&N1,&profiles[RHO*N1]);
+  output->write("profiles/u",1,&N1,&profiles[U*N1]);
+  output->write("profiles/bSqr",1,&N1,&profiles[BSQR*N1]);
+  output->write("profiles/gamma",1,&N1,&profiles[GAMMA*N1]);
+  output->write("profiles/Mdot",1,&N1,&profiles[MDOT*N1]);
+  output->write("profiles/PhiB",1,&N1,&profiles[PHIB*N1]);
+
+  if(primObs->dim>1)
+  {
+    const int numSliceVars = 3;
+    const std::string sliceNames[numSliceVars] = {"rho","u","bSqr"};
+    const array sliceVars[numSliceVars]
+      = {primObs->vars[vars::RHO],primObs->vars[vars::U],elemObs->bSqr};
+
+    std::vector<double> equatorial
+      = reductions::planes(*primObs,numSliceVars,sliceVars,directions::X2,primObs->N2/2);
+    const int equatorialDims[2] = {primObs->N3,N1};
+    std::vector<double> meridional
+      = reductions::planes(*primObs,numSliceVars,sliceVars,directions::X3,0);
+    const int meridionalDims[2] = {primObs->N2,N1};
+
+    for(int var=0;var<numSliceVars;var++)
+    {
+      output->write("equatorial/"+sliceNames[var],2,equatorialDims,
+                    &equatorial[(size_t)var*primObs->N3*N1]);
+      output->write("meridional/"+sliceNames[var],2,meridionalDims,
+                    &meridional[(size_t)var*primObs->N2*N1]);
+    }
+  }
+  output->endRow();
+}
+
 #endif
@@ -5,6 +5,39 @@ namespace params
   // 4 GPUs on SAVIO
   int numDevices = 1;
 
+  // Size-class arena for the ArrayFire allocations (ArrayFire >= 3.7)
+  int memoryArena = 1;
+
+  // Compiled ArrayFire kernels are kept in a subfolder of this one, per
+  // configuration, and reused by later runs. Empty to disable.
+  std::string kernelCacheDir = "kernelCache";
+
+  // Metric and connection coefficients are saved here, one file per rank and
+  // location, and read back by runs on the same grid. Empty to disable.
+  std::string geometryCacheDir = "geometryCache";
+
+  // Rows of zones along the outermost direction (X2 in 2D, X3 in 3D) in
+  // which the fluxes and their divergence are computed one after the other,
+  // so that the fluxes of a tile stay in cache. 0 for the whole grid at once
+  int fluxTileRows = 0;
+
+  // HDF5 dumps are written by a background thread, which needs an MPI
+  // library with MPI_THREAD_MULTIPLE. 0 to write them synchronously.
+  int asyncIO = 1;
+
+  // Shuffle + deflate level of the HDF5 dumps, 0 (uncompressed) to 9
+  int dumpCompressionLevel = 4;
+
+  // Print the time of every phase on rank 0 every step, and the timings over
+  // the ranks with every report below
+  int printPerformanceReport = 1;
+
+  // Min, max and mean over the ranks of the time per step of every phase,
+  // written every timingReportEveryNSteps steps (0: none) to timingLogFile,
+  // CSV or, with a name ending in .json, JSON lines
+  int timingReportEveryNSteps = 10;
+  std::string timingLogFile = "timings.csv";
+
   // Grid size options
   int N1 = 128;
   int N2 = 128;
@@ -21,12 +54,50 @@ namespace params
   std::string restartFile = "restartFile.h5";
   std::string restartFileName = "restartFileName.txt";
   std::string restartFileTime = "restartFileTime.txt";
+  // Checkpoints also write one raw file per rank, read back with mmap() when
+  // restarting with the same decomposition
+  int rawRestart = 1;
+  // A 3D run restarted from a 2D file extrudes it along X3, with a relative
+  // perturbation of u of this amplitude, in modes with phases from the seed
+  double extrusionPerturbation = 0.02;
+  int extrusionSeed = 1;
   // Maximum run time, in seconds
   double MaxWallTime = 3600*23.5;
   
   // Observation / checkpointing intervals
   double ObserveEveryDt   = .1;
   double WriteDataEveryDt = 2.;
+  // Also write v^i, B^i, bSqr and gamma in the x coordinates
+  int WriteDerivedVars = 0;
+  // Shell-averaged profiles, horizon fluxes and slices every ObserveEveryDt
+  int WriteReducedVars = 1;
+  // Dumps of the zones within the radius and theta ranges, every
+  // WindowStride zones in each direction, every WriteWindowEveryDt (0: none)
+  double WriteWindowEveryDt = 0.;
+  double WindowRadiusMin    = 0.;
+  double WindowRadiusMax    = 50.;
+  double WindowThetaMin     = 0.;
+  double WindowThetaMax     = M_PI;
+  int WindowStrideX1 = 1;
+  int WindowStrideX2 = 1;
+  int WindowStrideX3 = 1;
+  // Lossy primVarsT, derivedVarsT and windowVarsT dumps (restart files stay
+  // exact): rho, u, B, q and dP are kept within max(Abs, Rel*|value|) of
+  // their values, the velocities exactly. Check the errors and the savings
+  // with grid/verifyLossyDump.py
+  int LossyPrimVars    = 0;
+  int LossyDerivedVars = 0;
+  int LossyWindowVars  = 0;
+  double RhoErrorRel = 1.e-4;
+  double RhoErrorAbs = 0.;
+  double UErrorRel   = 1.e-4;
+  double UErrorAbs   = 0.;
+  double BErrorRel   = 1.e-4;
+  double BErrorAbs   = 1.e-12;
+  double QErrorRel   = 1.e-3;
+  double QErrorAbs   = 1.e-12;
+  double DPErrorRel  = 1.e-3;
+  double DPErrorAbs  = 1.e-12;
 
   // Timestepper opts
   int timeStepper = timeStepping::EXPLICIT;
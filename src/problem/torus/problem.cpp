@@ -1,6 +1,8 @@
 #include "torus.hpp"
 #include "ObserversTorus.hpp"
 #include "../../timer.hpp"
+#include "../../grid/dumpwriter.hpp"
+#include "../../grid/xdmf.hpp"
 #include <fstream>
 
 void fluidElement::setFluidElementParameters()
@@ -141,23 +143,38 @@ double computeLnOfh(double a, double r, double theta)
 
 }
 
+/* Counter-based random number in [0, 1) for the zone with global indices
+ * (i, j, k), including ghost zones: the 64 bit finalizer of splitmix64
+ * applied to the zone index. Independent of the order in which the zones
+ * are visited and of the number of threads or MPI ranks */
+double uniformRandom(const int i, const int j, const int k)
+{
+  const unsigned long long N1g = params::N1 + 2*params::numGhost;
+  const unsigned long long N2g = params::N2 + 2*params::numGhost;
+  unsigned long long x =   (unsigned long long)(i + params::numGhost)
+                         + N1g*(  (unsigned long long)(j + params::numGhost)
+                                + N2g*(unsigned long long)(k + params::numGhost)
+                               );
+
+  x += 0x9E3779B97F4A7C15ULL;
+  x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+  x =  x ^ (x >> 31);
+
+  /* Top 53 bits as a double */
+  return (x >> 11) * (1./9007199254740992.);
+}
+
 void timeStepper::initialConditions(int &numReads,int &numWrites)
 {
   PetscPrintf(PETSC_COMM_WORLD, "  Generating torus initial conditions...");
-  // Random number generator from PeTSC
-  double randNum;
-  PetscRandom randNumGen;
-  PetscRandomCreate(PETSC_COMM_WORLD, &randNumGen);
-  PetscRandomSetType(randNumGen, PETSCRAND48);
-
-  //Let's ignore ArrayFire here - it's only the initial
-  //conditions...
   array xCoords[3];
   geomCenter->getxCoords(xCoords);
 
   const int N1g = primOld->N1Total;
   const int N2g = primOld->N2Total;
   const int N3g = primOld->N3Total;
+  const int numZones = N1g*N2g*N3g;
 
   array& Rho = primOld->vars[vars::RHO];
   array& U = primOld->vars[vars::U];
@@ -168,22 +185,41 @@ void timeStepper::initialConditions(int &numReads,int &numWrites)
   array& B2 = primOld->vars[vars::B2];
   array& B3 = primOld->vars[vars::B3];
 
+  /* The Fishbone-Moncrief solution is computed in one host pass over bulk
+   * copies of the coordinates and of the metric */
+  std::vector<double> rHost(numZones), thetaHost(numZones), X2Host(numZones);
+  std::vector<double> lapseHost(numZones);
+  std::vector<double> betaHost[NDIM];
+  xCoords[directions::X1].host(&rHost[0]);
+  xCoords[directions::X2].host(&thetaHost[0]);
+  XCoords->vars[directions::X2].host(&X2Host[0]);
+  geomCenter->alpha.host(&lapseHost[0]);
+  for(int mu=1;mu<NDIM;mu++)
+  {
+    betaHost[mu].resize(numZones);
+    geomCenter->gCon[0][mu].host(&betaHost[mu][0]);
+  }
+
+  std::vector<double> rhoHost(numZones), uHost(numZones);
+  std::vector<double> u1Host(numZones), u2Host(numZones), u3Host(numZones);
+
   double aBH = params::blackHoleSpin;
 
-  for(int k=0;k<N3g;k++)
-    for(int j=0;j<N2g;j++)
-      for(int i=0;i<N1g;i++)
+  #pragma omp parallel for
+  for(int zone=0;zone<numZones;zone++)
   {
-    const int p = i+j*N1g+k*N2g;
-    const double& r = xCoords[directions::X1](i,j,k).scalar<double>();
-    const double& theta = xCoords[directions::X2](i,j,k).scalar<double>();
-    const double& phi = xCoords[directions::X3](i,j,k).scalar<double>();
-    const double& X2 = XCoords->vars[directions::X2](i,j,k).scalar<double>();
+    const int i = zone%N1g;
+    const int j = (zone/N1g)%N2g;
+    const int k = zone/(N1g*N2g);
+
+    const double& r = rHost[zone];
+    const double& theta = thetaHost[zone];
+    const double& X2 = X2Host[zone];
 
-    const double& lapse = geomCenter->alpha(i,j,k).scalar<double>();
-    const double& beta1 = geomCenter->gCon[0][1](i,j,k).scalar<double>();
-    const double& beta2 = geomCenter->gCon[0][2](i,j,k).scalar<double>();
-    const double& beta3 = geomCenter->gCon[0][3](i,j,k).scalar<double>();
+    const double& lapse = lapseHost[zone];
+    const double& beta1 = betaHost[1][zone];
+    const double& beta2 = betaHost[2][zone];
+    const double& beta3 = betaHost[3][zone];
 
     double lnOfh = 1.;
     if(r>=params::InnerEdgeRadius)
@@ -192,11 +228,11 @@ void timeStepper::initialConditions(int &numReads,int &numWrites)
     /* Region outside the torus */
     if(lnOfh<0. || r<params::InnerEdgeRadius)
     {
-      Rho(i,j,k)=params::rhoFloorInFluidElement;
-      U(i,j,k)=params::uFloorInFluidElement;
-      U1(i,j,k)=0.;
-      U2(i,j,k)=0.;
-      U3(i,j,k)=0.;
+      rhoHost[zone]=params::rhoFloorInFluidElement;
+      uHost[zone]=params::uFloorInFluidElement;
+      u1Host[zone]=0.;
+      u2Host[zone]=0.;
+      u3Host[zone]=0.;
     }
     else
       {
@@ -206,14 +242,17 @@ void timeStepper::initialConditions(int &numReads,int &numWrites)
 
         /* Solve for rho using the definition of h = (rho + u + P)/rho where rho
          * here is the rest mass energy density and P = C * rho^Gamma */
-        Rho(i,j,k) = pow((h-1)*(Gamma-1.)/(Kappa*Gamma), 
+        rhoHost[zone] = pow((h-1)*(Gamma-1.)/(Kappa*Gamma), 
              1./(Gamma-1.));
-        PetscRandomGetValue(randNumGen, &randNum);
-        U(i,j,k) =  Kappa * pow(Rho(i,j,k), Gamma)/(Gamma-1.)
+        /* The perturbation of a zone only depends on its global index, so
+         * that it does not depend on the domain decomposition */
+        double randNum = uniformRandom(primOld->iLocalStart - primOld->numGhostX1 + i,
+                                       primOld->jLocalStart - primOld->numGhostX2 + j,
+                                       primOld->kLocalStart - primOld->numGhostX3 + k
+                                      );
+        uHost[zone] =  Kappa * pow(rhoHost[zone], Gamma)/(Gamma-1.)
                   * (1. + params::InitialPerturbationAmplitude*(randNum-0.5));
-    
-        /* TODO: Should add random noise here */
-    
+
         
         /* Fishbone-Moncrief u_phi is given in the Boyer-Lindquist coordinates.
          * Need to transform to (modified) Kerr-Schild */
@@ -310,16 +349,21 @@ void timeStepper::initialConditions(int &numReads,int &numWrites)
         uConMKS[2] = uConKS[2]/hFactor;
         uConMKS[3] = uConKS[3];
         
-        U1(i,j,k) = uConMKS[1] + pow(lapse, 2.)*beta1*uConMKS[0];
-        U2(i,j,k) = uConMKS[2] + pow(lapse, 2.)*beta2*uConMKS[0];
-        U3(i,j,k) = uConMKS[3] + pow(lapse, 2.)*beta3*uConMKS[0];
+        u1Host[zone] = uConMKS[1] + pow(lapse, 2.)*beta1*uConMKS[0];
+        u2Host[zone] = uConMKS[2] + pow(lapse, 2.)*beta2*uConMKS[0];
+        u3Host[zone] = uConMKS[3] + pow(lapse, 2.)*beta3*uConMKS[0];
       }
-
-    B1(i,j,k) = 0.;
-    B2(i,j,k) = 0.;
-    B3(i,j,k) = 0.;
   }
 
+  Rho = array(N1g, N2g, N3g, &rhoHost[0]);
+  U   = array(N1g, N2g, N3g, &uHost[0]);
+  U1  = array(N1g, N2g, N3g, &u1Host[0]);
+  U2  = array(N1g, N2g, N3g, &u2Host[0]);
+  U3  = array(N1g, N2g, N3g, &u3Host[0]);
+  B1  = af::constant(0, N1g, N2g, N3g, f64);
+  B2  = af::constant(0, N1g, N2g, N3g, f64);
+  B3  = af::constant(0, N1g, N2g, N3g, f64);
+
   array rhoMax_af = af::max(af::max(af::max(Rho,2),1),0);
   double rhoMax = rhoMax_af.host<double>()[0];
 
@@ -521,7 +565,7 @@ void timeStepper::initialConditions(int &numReads,int &numWrites)
     primOld->vars[vars::DP].eval();
   }
 
-  applyFloor(primOld,elemOld,geomCenter,numReads,numWrites);
+  applyFloor(primOld,elemOld,geomCenter,false,numReads,numWrites);
 
   for (int var=0; var<vars::dof; var++) 
   {
@@ -538,153 +582,336 @@ void timeStepper::initialConditions(int &numReads,int &numWrites)
   fullStepDiagnostics(numReads,numWrites);
 }
 
-void applyFloor(grid* prim, fluidElement* elem, geometry* geom, int &numReads,int &numWrites)
+/* NaN repair of one zone: if any variable is NaN, all of them are set to
+ * zero so that the floors turn the zone into atmosphere. Returns 1 for a
+ * repaired zone, else 0 */
+inline double isNaNZone(const double a)
 {
-  array xCoords[3];
-  geom->getxCoords(xCoords);
-  array Radius = xCoords[0];
+  return (std::isnan(a) ? 1. : 0.);
+}
+inline array isNaNZone(const array &a)
+{
+  return 1.*af::isNaN(a);
+}
+inline double zeroWhere(const double condition, const double a)
+{
+  return (condition > 0. ? 0. : a);
+}
+inline array zeroWhere(const array &condition, const array &a)
+{
+  return af::select(condition > 0., 0., a);
+}
+
+template <typename T>
+T repairNaNZone(T prim[])
+{
+  T conditionNan = isNaNZone(prim[0]);
+  for(int var=1;var<vars::dof;var++)
+  {
+    conditionNan = stencil::max(conditionNan,isNaNZone(prim[var]));
+  }
+  for(int var=0;var<vars::dof;var++)
+  {
+    prim[var] = zeroWhere(conditionNan,prim[var]);
+  }
+  return conditionNan;
+}
 
-  array minRho = af::pow(Radius,params::RhoFloorSlope)*params::RhoFloorAmpl;
-  array minU = af::pow(Radius,params::UFloorSlope)*params::UFloorAmpl;
+/* Density, energy, magnetization and Lorentz factor floors of one zone, with
+ * Sasha's drift frame velocity reset. prim[RHO], prim[U] and prim[U1..U3]
+ * are updated; the return value is 1 if any of them was changed, else 0.
+ * T is double or af::array, as in the kernels of grid/stencil.hpp */
+template <typename T>
+T floorZone(T prim[],
+            const T gCov[NDIM][NDIM], const T gCon0[NDIM], const T &alpha,
+            const T &minRho, const T &minU
+           )
+{
+  T &rho = prim[vars::RHO];
+  T &u   = prim[vars::U];
+  T &u1  = prim[vars::U1];
+  T &u2  = prim[vars::U2];
+  T &u3  = prim[vars::U3];
+  const T &B1 = prim[vars::B1];
+  const T &B2 = prim[vars::B2];
+  const T &B3 = prim[vars::B3];
 
   // Save pre-floor values for later
-  array rho_prefloor = prim->vars[vars::RHO]*1.;
-  array u_prefloor   = prim->vars[vars::U]*1.;
-  rho_prefloor.eval();
-  u_prefloor.eval();
+  const T rho_prefloor = rho;
+  const T u_prefloor   = u;
 
   // Apply floors when needed
-  array condition = prim->vars[vars::RHO]<minRho;
-  array usefloor  = condition;
-  prim->vars[vars::RHO] = condition*minRho+(1.-condition)*prim->vars[vars::RHO];
-
-  condition = prim->vars[vars::U]<minU;
-  usefloor = af::max(condition,usefloor);
-  prim->vars[vars::U] = condition*minU+(1.-condition)*prim->vars[vars::U];
-
-  elem->set(*prim,*geom,numReads,numWrites);
-  const array& bSqr = elem->bSqr;
-  condition = bSqr>params::BsqrOverRhoMax*prim->vars[vars::RHO];
-  usefloor = af::max(condition,usefloor);
-  prim->vars[vars::RHO] = prim->vars[vars::RHO]*(1.-condition)+condition*bSqr/params::BsqrOverRhoMax;
-  condition = bSqr>params::BsqrOverUMax*prim->vars[vars::U];
-  usefloor = af::max(condition,usefloor);
-  prim->vars[vars::U] = prim->vars[vars::U]*(1.-condition)+condition*bSqr/params::BsqrOverUMax;
-  
-  prim->vars[vars::RHO].eval();
-  prim->vars[vars::U].eval();
-  usefloor.eval();
-
-  array zero = usefloor*0.;
-  array trans = af::max(af::min(zero+1.,(bSqr-0.1*prim->vars[vars::RHO])/prim->vars[vars::RHO]),zero)
-    *(usefloor>zero);
-  trans.eval();
-  
+  T condition = 1.*(rho<minRho);
+  T usefloor  = condition;
+  rho = condition*minRho+(1.-condition)*rho;
+
+  condition = 1.*(u<minU);
+  usefloor  = stencil::max(condition,usefloor);
+  u = condition*minU+(1.-condition)*u;
+
+  // b^2, as in fluidElement::set()
+  const T gamma =
+    stencil::sqrt(1. + gCov[1][1]*u1*u1 + gCov[2][2]*u2*u2 + gCov[3][3]*u3*u3
+                  + 2.*(gCov[1][2]*u1*u2 + gCov[1][3]*u1*u3 + gCov[2][3]*u2*u3)
+                 );
+  T uCon[NDIM], uCov[NDIM], bCon[NDIM], bCov[NDIM];
+  uCon[0] = gamma/alpha;
+  uCon[1] = u1 - gamma*gCon0[1]*alpha;
+  uCon[2] = u2 - gamma*gCon0[2]*alpha;
+  uCon[3] = u3 - gamma*gCon0[3]*alpha;
+  for(int mu=0;mu<NDIM;mu++)
+  {
+    uCov[mu] =  gCov[mu][0]*uCon[0] + gCov[mu][1]*uCon[1]
+              + gCov[mu][2]*uCon[2] + gCov[mu][3]*uCon[3];
+  }
+  bCon[0] = B1*uCov[1] + B2*uCov[2] + B3*uCov[3];
+  bCon[1] = (B1 + bCon[0]*uCon[1])/uCon[0];
+  bCon[2] = (B2 + bCon[0]*uCon[2])/uCon[0];
+  bCon[3] = (B3 + bCon[0]*uCon[3])/uCon[0];
+  for(int mu=0;mu<NDIM;mu++)
+  {
+    bCov[mu] =  gCov[mu][0]*bCon[0] + gCov[mu][1]*bCon[1]
+              + gCov[mu][2]*bCon[2] + gCov[mu][3]*bCon[3];
+  }
+  const T bSqr =  bCon[0]*bCov[0] + bCon[1]*bCov[1]
+                + bCon[2]*bCov[2] + bCon[3]*bCov[3]
+                + params::bSqrFloorInFluidElement;
+
+  condition = 1.*(bSqr>params::BsqrOverRhoMax*rho);
+  usefloor  = stencil::max(condition,usefloor);
+  rho = rho*(1.-condition)+condition*bSqr/params::BsqrOverRhoMax;
+  condition = 1.*(bSqr>params::BsqrOverUMax*u);
+  usefloor  = stencil::max(condition,usefloor);
+  u = u*(1.-condition)+condition*bSqr/params::BsqrOverUMax;
+
+  const T trans = stencil::max(stencil::min((bSqr-0.1*rho)/rho,1.),0.)
+                 *(usefloor>0.);
+
   // Sasha's floor method
-  array betapar = -elem->bCon[0]/bSqr/elem->uCon[0];
-  array betasqr = betapar*betapar*bSqr;
-  double betasqrmax = 1. - 1./params::MaxLorentzFactor/params::MaxLorentzFactor;
-  betasqr = af::min(betasqr,betasqrmax);
-  array gamma = 1./af::sqrt(1.-betasqr);
-  gamma.eval();
-  array ucondr[NDIM];
+  const T betapar = -bCon[0]/bSqr/uCon[0];
+  const double betasqrmax = 1. - 1./params::MaxLorentzFactor/params::MaxLorentzFactor;
+  const T betasqr = stencil::min(betapar*betapar*bSqr,betasqrmax);
+  const T gammapar = 1./stencil::sqrt(1.-betasqr);
+  T ucondr[NDIM];
   for(int m=0;m<NDIM;m++)
-    {
-      ucondr[m]=gamma*(elem->uCon[m]+betapar*elem->bCon[m]);
-      ucondr[m].eval();
-    }
+  {
+    ucondr[m] = gammapar*(uCon[m]+betapar*bCon[m]);
+  }
   // Need b-field in the inertial frame
-  array Bcon[NDIM];
-  Bcon[0]= zero;
-  Bcon[1] = prim->vars[vars::B1];
-  Bcon[2] = prim->vars[vars::B2];
-  Bcon[3] = prim->vars[vars::B3];
-  array Bcov[NDIM];
+  const T *Bcon[NDIM] = {NULL,&B1,&B2,&B3};
+  T Bcov[NDIM];
   for(int m=0;m<NDIM;m++)
-    {
-      Bcov[m]=zero;
-      for(int n=0;n<NDIM;n++)
-  Bcov[m]+=geom->gCov[n][m]*Bcon[n];
-      Bcov[m].eval();
-    }
-  array udotB = zero;
-  array bSqr_fl  = zero;
-  for(int n=0;n<NDIM;n++)
-    {
-      udotB += Bcov[n]*elem->uCon[n];
-      bSqr_fl += Bcov[n]*Bcon[n];
-    }
-  udotB.eval();
-  array bNorm = af::sqrt(bSqr_fl);
-  double bMin = sqrt(params::bSqrFloorInFluidElement);
-  bNorm = af::max(bNorm,bMin);
-  bNorm.eval();
+  {
+    Bcov[m] = gCov[1][m]*B1 + gCov[2][m]*B2 + gCov[3][m]*B3;
+  }
+  const T udotB   =  Bcov[0]*uCon[0] + Bcov[1]*uCon[1]
+                   + Bcov[2]*uCon[2] + Bcov[3]*uCon[3];
+  const T bSqr_fl = Bcov[1]*B1 + Bcov[2]*B2 + Bcov[3]*B3;
+  const double bMin = sqrt(params::bSqrFloorInFluidElement);
+  const T bNorm = stencil::max(stencil::sqrt(bSqr_fl),bMin);
 
   //New velocity
-  array wold = rho_prefloor+u_prefloor*params::adiabaticIndex;
-  array QdotB = udotB*wold*elem->uCon[0];
-  array wnew = prim->vars[vars::RHO]+prim->vars[vars::U]*params::adiabaticIndex;
-  array x = 2.*QdotB/(bNorm*wnew*ucondr[0]);
-  x.eval();
-  array vpar = x/( ucondr[0]*(1.+af::sqrt(1.+x*x)) );
-  vpar.eval();
-  array one_over_ucondr_t = 1./ucondr[0];
+  const T wold  = rho_prefloor+u_prefloor*params::adiabaticIndex;
+  const T QdotB = udotB*wold*uCon[0];
+  const T wnew  = rho+u*params::adiabaticIndex;
+  const T x     = 2.*QdotB/(bNorm*wnew*ucondr[0]);
+  const T vpar  = x/( ucondr[0]*(1.+stencil::sqrt(1.+x*x)) );
   //new contravariant 3-velocity, v^i
-  array vcon[NDIM];
-  vcon[0] = zero + 1.;
-  for (int m=1; m<NDIM; m++) {
+  T vcon[NDIM];
+  vcon[0] = 1.+0.*vpar;
+  for(int m=1;m<NDIM;m++)
+  {
     //parallel (to B) plus perpendicular (to B) velocities
-    vcon[m] = vpar*Bcon[m]/bNorm + ucondr[m]*one_over_ucondr_t;
-    vcon[m].eval();
+    vcon[m] = vpar*(*Bcon[m])/bNorm + ucondr[m]/ucondr[0];
   }
-  array vsqr=zero;
+  T vsqr = gCov[0][0]*vcon[0]*vcon[0];
   for(int m=0;m<NDIM;m++)
+  {
     for(int n=0;n<NDIM;n++)
-      vsqr+=geom->gCov[m][n]*vcon[m]*vcon[n];
-  vsqr.eval();
-  array condition_v = (vsqr>=0.|| vsqr<1./geom->gCon[0][0]);
-  vsqr=(1.-condition_v)*vsqr+condition_v/geom->gCon[0][0];
-  vsqr.eval();
-  array ut = af::sqrt(-1./vsqr);
-  ut.eval();
-  array utcon[NDIM];
-  utcon[0]=zero;
-  for(int m=1;m<NDIM;m++) {
-    utcon[m] = ut*(vcon[m]-geom->gCon[0][m]/geom->gCon[0][0]);
-    utcon[m].eval();
+    {
+      if(m>0 || n>0) vsqr = vsqr + gCov[m][n]*vcon[m]*vcon[n];
+    }
   }
+  const T condition_v = stencil::max(1.*(vsqr>=0.),1.*(vsqr<1./gCon0[0]));
+  vsqr = (1.-condition_v)*vsqr+condition_v/gCon0[0];
+  const T ut = stencil::sqrt(-1./vsqr);
+
+  u1 = u1*(1.-trans)+trans*ut*(vcon[1]-gCon0[1]/gCon0[0]);
+  u2 = u2*(1.-trans)+trans*ut*(vcon[2]-gCon0[2]/gCon0[0]);
+  u3 = u3*(1.-trans)+trans*ut*(vcon[3]-gCon0[3]/gCon0[0]);
+
+  // Now, we impose the maximum lorentz factor. MultFac is 1 wherever the
+  // limit holds.
+  const double maxLorentzFactorSqr = params::MaxLorentzFactor*params::MaxLorentzFactor;
+  const T lorentzFactorSqr =
+      1. + gCov[1][1]*u1*u1 + gCov[2][2]*u2*u2 + gCov[3][3]*u3*u3
+    + 2.*(gCov[1][2]*u1*u2 + gCov[1][3]*u1*u3 + gCov[2][3]*u2*u3);
+  const T MultFac =
+    1./stencil::sqrt(stencil::max((lorentzFactorSqr-1.)/(maxLorentzFactorSqr-1.),1.));
+  u1 = u1*MultFac;
+  u2 = u2*MultFac;
+  u3 = u3*MultFac;
+
+  return stencil::max(usefloor,1.*(lorentzFactorSqr>maxLorentzFactorSqr));
+}
 
-  prim->vars[vars::U1] = prim->vars[vars::U1]*(1.-trans)+trans*utcon[1];
-  prim->vars[vars::U2] = prim->vars[vars::U2]*(1.-trans)+trans*utcon[2];
-  prim->vars[vars::U3] = prim->vars[vars::U3]*(1.-trans)+trans*utcon[3];
-  prim->vars[vars::U1].eval();
-  prim->vars[vars::U2].eval();
-  prim->vars[vars::U3].eval();
-  
+/* Floors of the whole grid in a single pass, with the NaN repair in the same
+ * pass if repairNaNs is set. Returns the number of repaired zones. elem is
+ * set once on the floored prim (and once more after the conduction/viscosity
+ * limiters).
+ *
+ * With ArrayFire, all the outputs are evaluated together as one JIT kernel.
+ * With GRIM_NATIVE_KERNELS, one OpenMP loop goes over the zones and only
+ * writes back the zones that were floored (or repaired), in place. */
+double applyFloor(grid* prim, fluidElement* elem, geometry* geom,
+                  const bool repairNaNs, int &numReads,int &numWrites)
+{
+  /* The floor profiles only depend on the (static) coordinates */
+  static array *minRhoFloor = NULL, *minUFloor = NULL;
+  if(minRhoFloor == NULL)
+  {
+    array xCoords[3];
+    geom->getxCoords(xCoords);
+    const array& Radius = xCoords[0];
+
+    minRhoFloor = new array(af::pow(Radius,params::RhoFloorSlope)*params::RhoFloorAmpl);
+    minUFloor   = new array(af::pow(Radius,params::UFloorSlope)*params::UFloorAmpl);
+    minRhoFloor->eval();
+    minUFloor->eval();
+  }
 
-  // Reset element to get Lorentz factor
-  elem->set(*prim, *geom, numReads,numWrites);
-  const array& lorentzFactor = elem->gammaLorentzFactor;
-  array lorentzFactorSqr = lorentzFactor*lorentzFactor;
+  double numNaNs = 0.;
+#ifndef GRIM_NATIVE_KERNELS
+  array primZone[vars::dof];
+  for(int var=0;var<vars::dof;var++)
+  {
+    primZone[var] = prim->vars[var];
+  }
+  array conditionNan;
+  if(repairNaNs)
+  {
+    conditionNan = repairNaNZone(primZone);
+  }
+  floorZone(primZone,geom->gCov,geom->gCon[0],geom->alpha,
+            *minRhoFloor,*minUFloor
+           );
+
+  /* Only RHO, U, U1, U2, U3 change, unless zones were repaired */
+  const int numVarsWritten = (repairNaNs ? vars::dof : vars::U3+1);
+  array *out[vars::dof+1];
+  for(int var=0;var<numVarsWritten;var++)
+  {
+    prim->vars[var] = primZone[var];
+    out[var] = &prim->vars[var];
+  }
+  if(repairNaNs)
+  {
+    out[numVarsWritten] = &conditionNan;
+  }
+  af::eval(numVarsWritten + (repairNaNs ? 1 : 0),out);
+  if(repairNaNs)
+  {
+    // Ghost zones are repaired too, but only the interior is counted
+    numNaNs = af::sum<double>(conditionNan(*prim->domainX1,
+                                           *prim->domainX2,
+                                           *prim->domainX3));
+  }
+#else
+  native::bufferSet buffers;
+  const double *gCov[NDIM][NDIM], *gCon0[NDIM];
+  for(int mu=0;mu<NDIM;mu++)
+  {
+    for(int nu=0;nu<NDIM;nu++)
+    {
+      gCov[mu][nu] = buffers.read(geom->gCov[mu][nu]);
+    }
+    gCon0[mu] = buffers.read(geom->gCon[0][mu]);
+  }
+  const double *alpha  = buffers.read(geom->alpha);
+  const double *minRho = buffers.read(*minRhoFloor);
+  const double *minU   = buffers.read(*minUFloor);
+  double *primPtrs[vars::dof];
+  for(int var=0;var<vars::dof;var++)
+  {
+    primPtrs[var] = buffers.update(prim->vars[var]);
+  }
 
-  // Now, we impose the maximum lorentz factor...
-  condition = (lorentzFactorSqr>params::MaxLorentzFactor*params::MaxLorentzFactor);
-  array conditionIndices = where(condition > 0);
-  if(conditionIndices.elements()>0)
+  const int numZones = prim->vars[0].elements();
+  const int N1Total = prim->N1Total, N2Total = prim->N2Total;
+  const int N3Total = prim->N3Total;
+  const int numGhostX1 = prim->numGhostX1, numGhostX2 = prim->numGhostX2;
+  const int numGhostX3 = prim->numGhostX3;
+  #pragma omp parallel for reduction(+:numNaNs)
+  for(int zone=0;zone<numZones;zone++)
+  {
+    // Ghost zones are repaired too, but only the interior is counted
+    const int i = zone%N1Total;
+    const int j = (zone/N1Total)%N2Total;
+    const int k = zone/(N1Total*N2Total);
+    const bool isInterior =    i>=numGhostX1 && i<N1Total-numGhostX1
+                            && j>=numGhostX2 && j<N2Total-numGhostX2
+                            && k>=numGhostX3 && k<N3Total-numGhostX3;
+
+    double primZone[vars::dof];
+    for(int var=0;var<vars::dof;var++)
+    {
+      primZone[var] = primPtrs[var][zone];
+    }
+    double gCovZone[NDIM][NDIM], gCon0Zone[NDIM];
+    for(int mu=0;mu<NDIM;mu++)
     {
-      array MultFac = af::sqrt(af::max((lorentzFactorSqr-1.)/(params::MaxLorentzFactor*params::MaxLorentzFactor-1.),1.));
-      MultFac = 1./MultFac;
-      MultFac.eval();
-      prim->vars[vars::U1]*=MultFac;
-      prim->vars[vars::U2]*=MultFac;
-      prim->vars[vars::U3]*=MultFac;
-      prim->vars[vars::U1].eval();
-      prim->vars[vars::U2].eval();
-      prim->vars[vars::U3].eval();
-    }  
+      for(int nu=0;nu<NDIM;nu++)
+      {
+        gCovZone[mu][nu] = gCov[mu][nu][zone];
+      }
+      gCon0Zone[mu] = gCon0[mu][zone];
+    }
 
+    double conditionNan = 0.;
+    if(repairNaNs)
+    {
+      conditionNan = repairNaNZone(primZone);
+    }
+    const double floored = floorZone(primZone,gCovZone,gCon0Zone,alpha[zone],
+                                     minRho[zone],minU[zone]
+                                    );
+
+    if(conditionNan > 0.)
+    {
+      if(isInterior)
+      {
+        numNaNs += 1.;
+      }
+      for(int var=0;var<vars::dof;var++)
+      {
+        primPtrs[var][zone] = primZone[var];
+      }
+    }
+    else if(floored > 0.)
+    {
+      for(int var=vars::RHO;var<=vars::U3;var++)
+      {
+        primPtrs[var][zone] = primZone[var];
+      }
+    }
+  }
+#endif
+  /* Reads:
+   * -----
+   * prim : vars::dof
+   * gCov : NDIM*NDIM
+   * gCon[0] : NDIM
+   * alpha, minRho, minU : 3
+   *
+   * Writes:
+   * ------
+   * prim : 5 (vars::dof with repairNaNs) */
+  numReads  = vars::dof + NDIM*NDIM + NDIM + 3;
+  numWrites = (repairNaNs ? vars::dof : vars::U3+1);
+
+  // The boundary conditions and the observers use elem
   elem->set(*prim, *geom, numReads,numWrites);
-  
+
   if(params::conduction)
     {
       const array& rho = prim->vars[vars::RHO];
@@ -698,60 +925,147 @@ void applyFloor(grid* prim, fluidElement* elem, geometry* geom, int &numReads,in
     {
       const array& pressure = elem->pressure;
       const array& deltaP = elem->deltaP;
+      const array& bSqr = elem->bSqr;
       array dPmod = af::max(pressure-2./3.*deltaP,0.01*params::bSqrFloorInFluidElement)/af::max(pressure+1./3.*deltaP,params::bSqrFloorInFluidElement);
       array dPmaxPlus = af::min(1.07*params::ViscosityClosureFactor*bSqr*0.5*dPmod,1.49*pressure);
       array dPmaxMinus = af::max(-1.07*params::ViscosityClosureFactor*bSqr,-2.99*pressure);
 
-      condition = deltaP>0.;
+      array condition = deltaP>0.;
       prim->vars[vars::DP] = prim->vars[vars::DP]*
   (condition/af::max(deltaP/dPmaxPlus,1.)+(1.-condition)/af::max(deltaP/dPmaxMinus,1.));
       prim->vars[vars::DP].eval();
     }
   if(params::conduction || params::viscosity) elem->set(*prim, *geom, numReads,numWrites);
+
+  return numNaNs;
 }
 
-void timeStepper::halfStepDiagnostics(int &numReads,int &numWrites)
+// Smallest box of global zones, start <= i < end in X1 and X2, holding every
+// zone within the radius and theta ranges of the window dumps. All of X3
+void windowIndices(grid* prim, geometry* geom, int start[3], int end[3])
 {
-  applyFloor(primHalfStep,elemHalfStep,geomCenter,numReads,numWrites);
+  array xCoords[3];
+  geom->getxCoords(xCoords);
+  af::seq domainX1 = *prim->domainX1;
+  af::seq domainX2 = *prim->domainX2;
+  af::seq domainX3 = *prim->domainX3;
+  array inWindow =   (xCoords[0] >= params::WindowRadiusMin)
+                   * (xCoords[0] <= params::WindowRadiusMax)
+                   * (xCoords[1] >= params::WindowThetaMin)
+                   * (xCoords[1] <= params::WindowThetaMax);
+  inWindow = inWindow(domainX1, domainX2, domainX3) > 0.;
+
+  const int N[2]          = {prim->N1,prim->N2};
+  const int localStart[2] = {prim->iLocalStart,prim->jLocalStart};
+  const int numGhost[2]   = {prim->numGhostX1,prim->numGhostX2};
+  int first[2], last[2];
+  for(int d=0;d<2;d++)
+  {
+    array index = af::range(prim->N1Total,prim->N2Total,prim->N3Total,1,d,f64)
+                  - numGhost[d] + localStart[d];
+    index = index(domainX1, domainX2, domainX3);
+    first[d] = af::min<double>(af::select(inWindow, index, (double)N[d]));
+    last[d]  = af::max<double>(af::select(inWindow, index, -1.));
+  }
+  int firstGlobal[2], lastGlobal[2];
+  MPI_Allreduce(first, firstGlobal, 2, MPI_INT, MPI_MIN, PETSC_COMM_WORLD);
+  MPI_Allreduce(last,  lastGlobal,  2, MPI_INT, MPI_MAX, PETSC_COMM_WORLD);
+
+  for(int d=0;d<2;d++)
+  {
+    start[d] = firstGlobal[d];
+    end[d]   = std::max(firstGlobal[d],lastGlobal[d]+1);
+  }
+  start[2] = 0;
+  end[2]   = prim->N3;
 }
 
-void timeStepper::fullStepDiagnostics(int &numReads,int &numWrites)
+// Error bounds of the lossy analysis dumps, for vars (isDerived false) or
+// dumpVars (isDerived true). The velocities and the other derived
+// quantities stay exact
+dumpWriter::errorBounds analysisErrorBounds(const bool isDerived)
 {
-  af::seq domainX1 = *primOld->domainX1;
-  af::seq domainX2 = *primOld->domainX2;
-  af::seq domainX3 = *primOld->domainX3;
-
-  // Check for Nan's
-  array conditionNan = elemOld->zero;
-  for(int var=0;var<vars::dof;var++)
+  const int dof = isDerived ? dumpVars::dof : vars::dof;
+  dumpWriter::errorBounds bounds;
+  bounds.relative.assign(dof, 0.);
+  bounds.absolute.assign(dof, 0.);
+
+  bounds.relative[vars::RHO] = params::RhoErrorRel;
+  bounds.absolute[vars::RHO] = params::RhoErrorAbs;
+  bounds.relative[vars::U]   = params::UErrorRel;
+  bounds.absolute[vars::U]   = params::UErrorAbs;
+  if(params::conduction)
   {
-    conditionNan = conditionNan+af::isNaN(primOld->vars[var]);
+    const int Q = isDerived ? dumpVars::Q : vars::Q;
+    bounds.relative[Q] = params::QErrorRel;
+    bounds.absolute[Q] = params::QErrorAbs;
   }
-  double NaNnorm = af::norm(af::flat(conditionNan(domainX1,domainX2,domainX3)),
-			                      AF_NORM_VECTOR_1
-                           );
-  if(NaNnorm>0)
+  if(params::viscosity)
+  {
+    const int DP = isDerived ? dumpVars::DP : vars::DP;
+    bounds.relative[DP] = params::DPErrorRel;
+    bounds.absolute[DP] = params::DPErrorAbs;
+  }
+  const int B1 = isDerived ? dumpVars::B1 : vars::B1;
+  for(int d=0;d<3;d++)
   {
-    std::cout << "Found " << NaNnorm 
+    bounds.relative[B1+d] = params::BErrorRel;
+    bounds.absolute[B1+d] = params::BErrorAbs;
+  }
+  return bounds;
+}
+
+void timeStepper::halfStepDiagnostics(int &numReads,int &numWrites)
+{
+  applyFloor(primHalfStep,elemHalfStep,geomCenter,false,numReads,numWrites);
+}
+
+void timeStepper::fullStepDiagnostics(int &numReads,int &numWrites)
+{
+  // Bad points are set to atmosphere in the same pass as the floors
+  double numNaNs = applyFloor(primOld,elemOld,geomCenter,true,
+                              numReads,numWrites
+                             );
+  if(numNaNs>0)
+  {
+    std::cout << "Found " << numNaNs 
               << " NaN's in data! Bad points will be set to atmopshere." 
               << std::endl;
-    array NaNIdx = where(conditionNan>0.);
-    for(int var=0;var<vars::dof;var++)
-	  {
-	    primOld->vars[var](NaNIdx)=0.;
-	  }
   }
 
-  applyFloor(primOld,elemOld,geomCenter,numReads,numWrites);
-
   int world_rank;
   MPI_Comm_rank(PETSC_COMM_WORLD, &world_rank);
   int world_size;
   MPI_Comm_size(PETSC_COMM_WORLD, &world_size);
   
+  // Restart files are always written exactly, by grid::dump()
+  static const dumpWriter::errorBounds primBounds    = analysisErrorBounds(false);
+  static const dumpWriter::errorBounds derivedBounds = analysisErrorBounds(true);
+
+  // Names of the primitives in the XDMF indices
+  std::string primNames[vars::dof];
+  primNames[vars::RHO] = "rho";
+  primNames[vars::U]   = "u";
+  primNames[vars::U1]  = "u1";
+  primNames[vars::U2]  = "u2";
+  primNames[vars::U3]  = "u3";
+  primNames[vars::B1]  = "B1";
+  primNames[vars::B2]  = "B2";
+  primNames[vars::B3]  = "B3";
+  if (params::conduction)
+  {
+    primNames[vars::Q]  = "qTilde";
+  }
+  if (params::viscosity)
+  {
+    primNames[vars::DP] = "dPTilde";
+  }
+
   // On-the-fly observers
   bool ObserveData = (floor(time/params::ObserveEveryDt) != floor((time-dt)/params::ObserveEveryDt));
   bool WriteData   = (floor(time/params::WriteDataEveryDt) != floor((time-dt)/params::WriteDataEveryDt));
+  bool WriteWindow = (   params::WriteWindowEveryDt > 0.
+                      && floor(time/params::WriteWindowEveryDt) != floor((time-dt)/params::WriteWindowEveryDt));
   if(ObserveData)
   {
     TimeStamp tStep;
@@ -774,12 +1088,27 @@ void timeStepper::fullStepDiagnostics(int &numReads,int &numWrites)
       
     ComputeEnergyIntegrals(elemOld,primOld,geomCenter,volElem);
     ComputeBoundaryFluxes(elemOld,primOld,geomCenter,volElem);
+
+    if(params::WriteReducedVars)
+    {
+      // A restarted run appends to the file of the run it continues
+      static reducedOutputFile *reducedOutput = NULL;
+      if(reducedOutput==NULL)
+      {
+        reducedOutput = new reducedOutputFile("reducedVars.h5",restarted);
+      }
+      WriteReducedOutputs(reducedOutput,elemOld,primOld,geomCenter,
+                          volElem/XCoords->dX1,time);
+    }
   }
 
   if(WriteData)
   {
     long long int WriteIdx = floor(time/params::WriteDataEveryDt);
-    if(WriteIdx==0)
+    // The XDMF index points to the coordinates, so they are written by every
+    // run (restarts included) before the first dump
+    static xdmfSeries *series = NULL;
+    if(series==NULL)
     {
       PetscPrintf(PETSC_COMM_WORLD, "\n");
       PetscPrintf(PETSC_COMM_WORLD, "  Printing metric at zone CENTER...");
@@ -788,91 +1117,154 @@ void timeStepper::fullStepDiagnostics(int &numReads,int &numWrites)
       geomCenter->gGrid->dump("sqrtDetg","sqrtDetg.h5");
       geomCenter->xCoordsGrid->dump("xCoords","xCoords.h5");
       PetscPrintf(PETSC_COMM_WORLD, "done\n\n");
+
+      series = new xdmfSeries("primVars.xmf",*primOld,"xCoords.h5","xCoords",
+                              WriteIdx>0
+                             );
     }
       
-    std::string filename    = "primVarsT";
-    std::string filenameVTS = "dump";
+    std::string filename        = "primVarsT";
+    std::string filenameDerived = "derivedVarsT";
     std::string s_idx = std::to_string(WriteIdx);
       
     for(int i=0;i<6-s_idx.size();i++)
     {
-      filename    = filename    + "0";
-      filenameVTS = filenameVTS + "0";
+      filename        = filename        + "0";
+      filenameDerived = filenameDerived + "0";
     }
-    filename    = filename    + s_idx + ".h5";
-    filenameVTS = filenameVTS + s_idx + ".vts";
+    filename        = filename        + s_idx + ".h5";
+    filenameDerived = filenameDerived + s_idx + ".h5";
     
-    primOld->dump("primitives", filename);
-
-    std::string varNames[dumpVars::dof];
-    varNames[dumpVars::RHO]   = "rho";
-    varNames[dumpVars::U]     = "u";
-    varNames[dumpVars::U1]    = "u1";
-    varNames[dumpVars::U2]    = "u2";
-    varNames[dumpVars::U3]    = "u3";
-    varNames[dumpVars::B1]    = "B1";
-    varNames[dumpVars::B2]    = "B2";
-    varNames[dumpVars::B3]    = "B3";
-    varNames[dumpVars::BSQR]  = "bSqr";
-    varNames[dumpVars::GAMMA] = "gamma";
-    if (params::conduction)
-    {
-      varNames[dumpVars::Q]   = "q";
-    }
-    if (params::viscosity)
+    dumpWriter::write(*primOld, "primitives", filename,
+                      params::LossyPrimVars ? &primBounds : NULL
+                     );
+
+    series->beginStep(time);
+    series->addVars(filename, "primitives", vars::dof, primNames);
+
+    // Quantities in the x coordinates, only on request
+    if(params::WriteDerivedVars)
     {
-      varNames[dumpVars::DP]  = "dP";
-    }
-    
-    dump->vars[dumpVars::RHO] = elemOld->rho;
-    dump->vars[dumpVars::U]   = elemOld->u;
+      // rho and u are already in the primitives
+      std::string varNames[dumpVars::dof];
+      varNames[dumpVars::U1]    = "v1";
+      varNames[dumpVars::U2]    = "v2";
+      varNames[dumpVars::U3]    = "v3";
+      varNames[dumpVars::B1]    = "Bx1";
+      varNames[dumpVars::B2]    = "Bx2";
+      varNames[dumpVars::B3]    = "Bx3";
+      varNames[dumpVars::BSQR]  = "bSqr";
+      varNames[dumpVars::GAMMA] = "gamma";
+      if (params::conduction)
+      {
+        varNames[dumpVars::Q]   = "q";
+      }
+      if (params::viscosity)
+      {
+        varNames[dumpVars::DP]  = "dP";
+      }
+      dump->vars[dumpVars::RHO] = elemOld->rho;
+      dump->vars[dumpVars::U]   = elemOld->u;
 
-    array uConxCoords[NDIM];
-    array bConxCoords[NDIM];
-    geomCenter->conXTox(elemOld->uCon, uConxCoords);
-    geomCenter->conXTox(elemOld->bCon, bConxCoords);
+      array uConxCoords[NDIM];
+      array bConxCoords[NDIM];
+      geomCenter->conXTox(elemOld->uCon, uConxCoords);
+      geomCenter->conXTox(elemOld->bCon, bConxCoords);
     
-    /* 3-velocity v^i = u^i/u^t */
+      /* 3-velocity v^i = u^i/u^t */
 
-    dump->vars[dumpVars::U1] = uConxCoords[1]/uConxCoords[0];
-    dump->vars[dumpVars::U2] = uConxCoords[2]/uConxCoords[0];
-    dump->vars[dumpVars::U3] = uConxCoords[3]/uConxCoords[0];
+      dump->vars[dumpVars::U1] = uConxCoords[1]/uConxCoords[0];
+      dump->vars[dumpVars::U2] = uConxCoords[2]/uConxCoords[0];
+      dump->vars[dumpVars::U3] = uConxCoords[3]/uConxCoords[0];
 
-    /* Magnetic field 3-vector B^i = *(F)^{it} = b^i u^t - b^t u^i */
+      /* Magnetic field 3-vector B^i = *(F)^{it} = b^i u^t - b^t u^i */
 
-    dump->vars[dumpVars::B1] =   bConxCoords[1] * uConxCoords[0]
-                               - bConxCoords[0] * uConxCoords[1];
+      dump->vars[dumpVars::B1] =   bConxCoords[1] * uConxCoords[0]
+                                 - bConxCoords[0] * uConxCoords[1];
 
-    dump->vars[dumpVars::B2] =   bConxCoords[2] * uConxCoords[0]
-                               - bConxCoords[0] * uConxCoords[2];
+      dump->vars[dumpVars::B2] =   bConxCoords[2] * uConxCoords[0]
+                                 - bConxCoords[0] * uConxCoords[2];
 
-    dump->vars[dumpVars::B3] =   bConxCoords[3] * uConxCoords[0]
-                               - bConxCoords[0] * uConxCoords[3];
+      dump->vars[dumpVars::B3] =   bConxCoords[3] * uConxCoords[0]
+                                 - bConxCoords[0] * uConxCoords[3];
 
-    dump->vars[dumpVars::Q]    = elemOld->q; 
-    dump->vars[dumpVars::DP]   = elemOld->deltaP; 
-    dump->vars[dumpVars::BSQR] = elemOld->bSqr;
+      dump->vars[dumpVars::Q]    = elemOld->q; 
+      dump->vars[dumpVars::DP]   = elemOld->deltaP; 
+      dump->vars[dumpVars::BSQR] = elemOld->bSqr;
 
-    /* uCon[0] = lorentzFactor/alpha, where alpha = 1/(-gCon[0][0])^{1/2}
-     * 
-     * To get the lorentzFactor, we need gCon[0][0] in x Coords. Performing the
-     * transformation here: */
-    array gCon00xCoords = 0.*geomCenter->gCon[0][0];
-    for (int MU=0; MU < NDIM; MU++)
-    {
-      for (int NU=0; NU < NDIM; NU++)
+      /* uCon[0] = lorentzFactor/alpha, where alpha = 1/(-gCon[0][0])^{1/2}
+       * 
+       * To get the lorentzFactor, we need gCon[0][0] in x Coords. Performing the
+       * transformation here: */
+      array gCon00xCoords = 0.*geomCenter->gCon[0][0];
+      for (int MU=0; MU < NDIM; MU++)
       {
-        gCon00xCoords +=  geomCenter->dxdX[0][MU]
-                        * geomCenter->dxdX[0][NU]
-                        * geomCenter->gCon[MU][NU];
+        for (int NU=0; NU < NDIM; NU++)
+        {
+          gCon00xCoords +=  geomCenter->dxdX[0][MU]
+                          * geomCenter->dxdX[0][NU]
+                          * geomCenter->gCon[MU][NU];
+        }
       }
+      array alphaxCoords  = 1./af::sqrt(-gCon00xCoords);
+      array lorentzFactor = uConxCoords[0] * alphaxCoords;
+
+      dump->vars[dumpVars::GAMMA] = lorentzFactor;
+
+      dumpWriter::write(*dump, "derived", filenameDerived,
+                        params::LossyDerivedVars ? &derivedBounds : NULL
+                       );
+      series->addVars(filenameDerived, "derived", dumpVars::dof, varNames);
+    }
+
+    series->endStep();
+  }
+
+  // Downsampled dumps of the region of interest, with their own index
+  if(WriteWindow)
+  {
+    long long int WindowIdx = floor(time/params::WriteWindowEveryDt);
+    static int windowStart[3], windowEnd[3];
+    const int windowStride[3] = {params::WindowStrideX1,
+                                 params::WindowStrideX2,
+                                 params::WindowStrideX3};
+    static xdmfSeries *windowSeries = NULL;
+    if(windowSeries==NULL)
+    {
+      windowIndices(primOld,geomCenter,windowStart,windowEnd);
+      dumpWriter::writeWindow(*geomCenter->xCoordsGrid,
+                              windowStart,windowEnd,windowStride,
+                              "xCoords","xCoordsWindow.h5"
+                             );
+
+      int windowSize[3];
+      dumpWriter::windowSize(windowStart,windowEnd,windowStride,windowSize);
+      PetscPrintf(PETSC_COMM_WORLD,
+                  "  Window dumps: zones [%d, %d) x [%d, %d), %d x %d x %d\n",
+                  windowStart[0],windowEnd[0],windowStart[1],windowEnd[1],
+                  windowSize[0],windowSize[1],windowSize[2]
+                 );
+      windowSeries = new xdmfSeries("windowVars.xmf",params::dim,
+                                    windowSize[0],windowSize[1],windowSize[2],
+                                    "xCoordsWindow.h5","xCoords",WindowIdx>0
+                                   );
     }
-    array alphaxCoords  = 1./af::sqrt(-gCon00xCoords);
-    array lorentzFactor = uConxCoords[0] * alphaxCoords;
 
-    dump->vars[dumpVars::GAMMA] = lorentzFactor;
+    std::string s_idx = std::to_string(WindowIdx);
+    std::string filename = "windowVarsT";
+    for(int i=0;i<6-s_idx.size();i++)
+    {
+      filename = filename + "0";
+    }
+    filename = filename + s_idx + ".h5";
 
-    dump->dumpVTS(*geomCenter->xCoordsGrid, varNames, filenameVTS);
+    dumpWriter::writeWindow(*primOld,windowStart,windowEnd,windowStride,
+                            "primitives",filename,
+                            params::LossyWindowVars ? &primBounds : NULL
+                           );
+    windowSeries->beginStep(time);
+    windowSeries->addVars(filename, "primitives", vars::dof, primNames);
+    windowSeries->endStep();
   }
 }
 
@@ -895,6 +1287,13 @@ int timeStepper::CheckWallClockTermination()
       filename=filename+s_idx;
       filename=filename+".h5";
       primOld->dump("primitives",filename);
+      if(params::rawRestart)
+	{
+	  restartFile::write(*primOld,restartFile::fileBaseOf(filename),
+			     time,dt,numSteps);
+	}
+      // Only point to the restart file once it is complete
+      dumpWriter::wait();
       std::ofstream fName(params::restartFileName.c_str());
       fName<<filename<<std::endl;
       fName.close();
@@ -905,38 +1304,55 @@ int timeStepper::CheckWallClockTermination()
   return StopRunning;
 }
 
-void dampedOutflowBC(grid& primBC, 
-         const geometry& geom, int &numReads,int &numWrites)
+/* The boundary copies below only depend on the grid layout and on the
+ * (static) metric, so they are built on the first call and reused */
+void addDampedOutflowCopies(const grid& primBC, const geometry& geom,
+                            boundaries::copyDescriptors& copies)
 {
   const int numGhost = params::numGhost;
   if(primBC.iLocalStart == 0)
     {
-      const array& g = geom.g;
+      /* g(numGhost)/g(i) as the ratio scale[dest]/scale[source] */
+      array invG = 1./geom.g;
+      std::vector<double> scale(invG.elements());
+      invG.host(&scale[0]);
 
       for(int i=0;i<numGhost;i++)
   {
-    primBC.vars[vars::RHO](i,span,span)=g(numGhost,span,span)/g(i,span,span)*primBC.vars[vars::RHO](numGhost,span,span);
-    primBC.vars[vars::U](i,span,span)=g(numGhost,span,span)/g(i,span,span)*primBC.vars[vars::U](numGhost,span,span);
-    primBC.vars[vars::B1](i,span,span)=g(numGhost,span,span)/g(i,span,span)*primBC.vars[vars::B1](numGhost,span,span);
+    copies.addLayerCopy(directions::X1,i,numGhost,vars::RHO,1.,&scale[0]);
+    copies.addLayerCopy(directions::X1,i,numGhost,vars::U,1.,&scale[0]);
+    copies.addLayerCopy(directions::X1,i,numGhost,vars::B1,1.,&scale[0]);
     if(params::conduction)
       {
-        primBC.vars[vars::Q](i,span,span)=g(numGhost,span,span)/g(i,span,span)*primBC.vars[vars::Q](numGhost,span,span);
+        copies.addLayerCopy(directions::X1,i,numGhost,vars::Q,1.,&scale[0]);
       }
     if(params::viscosity)
       {
-        primBC.vars[vars::DP](i,span,span)=g(numGhost,span,span)/g(i,span,span)*primBC.vars[vars::DP](numGhost,span,span);
+        copies.addLayerCopy(directions::X1,i,numGhost,vars::DP,1.,&scale[0]);
       }
     double fac = (params::X1End-params::X1Start)/(params::N1-1.);
     fac = exp(fac*i);
-    primBC.vars[vars::U1](i,span,span)=primBC.vars[vars::U1](numGhost,span,span)*fac;
-    primBC.vars[vars::U2](i,span,span)=primBC.vars[vars::U2](numGhost,span,span)*(2.-fac);
-    primBC.vars[vars::U3](i,span,span)=primBC.vars[vars::U3](numGhost,span,span)*(2.-fac);
-    primBC.vars[vars::B2](i,span,span)=primBC.vars[vars::B2](numGhost,span,span)*(2.-fac);
-    primBC.vars[vars::B3](i,span,span)=primBC.vars[vars::B3](numGhost,span,span)*(2.-fac);
+    copies.addLayerCopy(directions::X1,i,numGhost,vars::U1,fac);
+    copies.addLayerCopy(directions::X1,i,numGhost,vars::U2,2.-fac);
+    copies.addLayerCopy(directions::X1,i,numGhost,vars::U3,2.-fac);
+    copies.addLayerCopy(directions::X1,i,numGhost,vars::B2,2.-fac);
+    copies.addLayerCopy(directions::X1,i,numGhost,vars::B3,2.-fac);
   }
     }
 }
 
+void dampedOutflowBC(grid& primBC, 
+         const geometry& geom, int &numReads,int &numWrites)
+{
+  static boundaries::copyDescriptors *dampedOutflowCopies = NULL;
+  if(dampedOutflowCopies == NULL)
+    {
+      dampedOutflowCopies = new boundaries::copyDescriptors(primBC);
+      addDampedOutflowCopies(primBC,geom,*dampedOutflowCopies);
+    }
+  dampedOutflowCopies->apply(primBC);
+}
+
 void inflowCheck(grid& primBC,fluidElement& elemBC,
      geometry& geom, int &numReads,int &numWrites)
 {
@@ -1042,175 +1458,86 @@ void inflowCheck(grid& primBC,fluidElement& elemBC,
     }
 }
 
-void fixPoles(grid& primBC, const geometry& geom, int &numReads,int &numWrites)
+/* Copies of one pole. first, second, third are the first three active
+ * zones counted from the pole, ghost(i) the i'th ghost zone and Theta the
+ * angle to the pole (host array of one grid) */
+void addPoleCopies(const int first, const int second, const int third,
+                   const int ghostDir, const double *Theta,
+                   boundaries::copyDescriptors& copies)
 {
   const int numGhost = params::numGhost;
-  if(primBC.jLocalStart == 0)
-    {
-      array xCoords[3];
-      geom.getxCoords(xCoords);
-      array Theta = xCoords[1];
-      int idx0 = numGhost;
-      int idx1 = numGhost+1;
-      int idx2 = numGhost+2;
-      primBC.vars[vars::RHO](span,idx0,span)=
-  primBC.vars[vars::RHO](span,idx2,span);
-      primBC.vars[vars::U](span,idx0,span)=
-  primBC.vars[vars::U](span,idx2,span);
-      primBC.vars[vars::U1](span,idx0,span)=
-  primBC.vars[vars::U1](span,idx2,span);
-      primBC.vars[vars::U2](span,idx0,span)=
-        primBC.vars[vars::U2](span,idx2,span)*Theta(span,idx0,span)/Theta(span,idx2,span);
-      primBC.vars[vars::U3](span,idx0,span)=
-        primBC.vars[vars::U3](span,idx2,span);
-      if(params::conduction)
-  {
-    primBC.vars[vars::Q](span,idx0,span)=
-      primBC.vars[vars::Q](span,idx2,span)*Theta(span,idx0,span)/Theta(span,idx2,span);
-  }
-      if(params::viscosity)
-  {
-    primBC.vars[vars::DP](span,idx0,span)=
-      primBC.vars[vars::DP](span,idx2,span)*Theta(span,idx0,span)/Theta(span,idx2,span);
-  }
-
-      primBC.vars[vars::RHO](span,idx1,span)=
-  primBC.vars[vars::RHO](span,idx2,span);
-      primBC.vars[vars::U](span,idx1,span)=
-  primBC.vars[vars::U](span,idx2,span);
-      primBC.vars[vars::U1](span,idx1,span)=
-  primBC.vars[vars::U1](span,idx2,span);
-      primBC.vars[vars::U2](span,idx1,span)=
-        primBC.vars[vars::U2](span,idx2,span)*Theta(span,idx1,span)/Theta(span,idx2,span);
-      primBC.vars[vars::U3](span,idx1,span)=
-        primBC.vars[vars::U3](span,idx2,span);
-      if(params::conduction)
-  {
-    primBC.vars[vars::Q](span,idx1,span)=
-      primBC.vars[vars::Q](span,idx2,span)*Theta(span,idx1,span)/Theta(span,idx2,span);
-  }
-      if(params::viscosity)
-        {
-    primBC.vars[vars::DP](span,idx1,span)=
-      primBC.vars[vars::DP](span,idx2,span)*Theta(span,idx1,span)/Theta(span,idx2,span);
-  }
-
+  const int X2 = directions::X2;
 
-      for(int i=0;i<numGhost;i++)
-  {
-    primBC.vars[vars::RHO](span,numGhost-1-i,span)=
-      primBC.vars[vars::RHO](span,numGhost+i,span);
-    primBC.vars[vars::U](span,numGhost-1-i,span)=
-            primBC.vars[vars::U](span,numGhost+i,span);
-    primBC.vars[vars::U1](span,numGhost-1-i,span)=
-            primBC.vars[vars::U1](span,numGhost+i,span);
-    primBC.vars[vars::U3](span,numGhost-1-i,span)=
-            primBC.vars[vars::U3](span,numGhost+i,span);
-    primBC.vars[vars::U2](span,numGhost-1-i,span)=
-      primBC.vars[vars::U2](span,numGhost+i,span)*(-1.0);
-    primBC.vars[vars::B1](span,numGhost-1-i,span)=
-            primBC.vars[vars::B1](span,numGhost+i,span);
-    primBC.vars[vars::B3](span,numGhost-1-i,span)=
-            primBC.vars[vars::B3](span,numGhost+i,span);
-    primBC.vars[vars::B2](span,numGhost-1-i,span)=
-            primBC.vars[vars::B2](span,numGhost+i,span)*(-1.0);
-    if(params::conduction)
-      {
-        primBC.vars[vars::Q](span,numGhost-1-i,span)=
-    primBC.vars[vars::Q](span,numGhost+i,span)*(-1.0);
-      }
-    if(params::viscosity)
-      {
-        primBC.vars[vars::DP](span,numGhost-1-i,span)=
-                primBC.vars[vars::DP](span,numGhost+i,span)*(-1.0);
-      }
-  }
-      for(int var=0;var<vars::dof;var++)
-  primBC.vars[var].eval();
-    }
-  if(primBC.jLocalEnd == primBC.N2)
+  /* 'Fix' the first two active zones from the third */
+  const int idx[2] = {first, second};
+  for(int n=0;n<2;n++)
     {
-      array xCoords[3];
-      geom.getxCoords(xCoords);
-      array Theta = xCoords[1]*(-1.)+M_PI;
-      int idx0 = primBC.N2Local+numGhost-1;
-      int idx1 = idx0-1;
-      int idx2 = idx0-2;
-      primBC.vars[vars::RHO](span,idx0,span)=
-  primBC.vars[vars::RHO](span,idx2,span);
-      primBC.vars[vars::U](span,idx0,span)=
-  primBC.vars[vars::U](span,idx2,span);
-      primBC.vars[vars::U1](span,idx0,span)=
-  primBC.vars[vars::U1](span,idx2,span);
-      primBC.vars[vars::U2](span,idx0,span)=
-        primBC.vars[vars::U2](span,idx2,span)*Theta(span,idx0,span)/Theta(span,idx2,span);
-      primBC.vars[vars::U3](span,idx0,span)=
-        primBC.vars[vars::U3](span,idx2,span);
+      copies.addLayerCopy(X2,idx[n],third,vars::RHO,1.);
+      copies.addLayerCopy(X2,idx[n],third,vars::U,1.);
+      copies.addLayerCopy(X2,idx[n],third,vars::U1,1.);
+      copies.addLayerCopy(X2,idx[n],third,vars::U2,1.,Theta);
+      copies.addLayerCopy(X2,idx[n],third,vars::U3,1.);
       if(params::conduction)
         {
-          primBC.vars[vars::Q](span,idx0,span)=
-            primBC.vars[vars::Q](span,idx2,span)*Theta(span,idx0,span)/Theta(span,idx2,span);
+          copies.addLayerCopy(X2,idx[n],third,vars::Q,1.,Theta);
         }
       if(params::viscosity)
         {
-          primBC.vars[vars::DP](span,idx0,span)=
-            primBC.vars[vars::DP](span,idx2,span)*Theta(span,idx0,span)/Theta(span,idx2,span);
+          copies.addLayerCopy(X2,idx[n],third,vars::DP,1.,Theta);
         }
+    }
 
-      primBC.vars[vars::RHO](span,idx1,span)=
-  primBC.vars[vars::RHO](span,idx2,span);
-      primBC.vars[vars::U](span,idx1,span)=
-  primBC.vars[vars::U](span,idx2,span);
-      primBC.vars[vars::U1](span,idx1,span)=
-  primBC.vars[vars::U1](span,idx2,span);
-      primBC.vars[vars::U2](span,idx1,span)=
-        primBC.vars[vars::U2](span,idx2,span)*Theta(span,idx1,span)/Theta(span,idx2,span);
-      primBC.vars[vars::U3](span,idx1,span)=
-        primBC.vars[vars::U3](span,idx2,span);
+  /* Reflect across the pole, changing the sign of the theta components */
+  for(int i=0;i<numGhost;i++)
+    {
+      const int ghost  = first - ghostDir*(1+i);
+      const int active = first + ghostDir*i;
+      copies.addLayerCopy(X2,ghost,active,vars::RHO,1.);
+      copies.addLayerCopy(X2,ghost,active,vars::U,1.);
+      copies.addLayerCopy(X2,ghost,active,vars::U1,1.);
+      copies.addLayerCopy(X2,ghost,active,vars::U3,1.);
+      copies.addLayerCopy(X2,ghost,active,vars::U2,-1.);
+      copies.addLayerCopy(X2,ghost,active,vars::B1,1.);
+      copies.addLayerCopy(X2,ghost,active,vars::B3,1.);
+      copies.addLayerCopy(X2,ghost,active,vars::B2,-1.);
       if(params::conduction)
         {
-          primBC.vars[vars::Q](span,idx1,span)=
-            primBC.vars[vars::Q](span,idx2,span)*Theta(span,idx1,span)/Theta(span,idx2,span);
+          copies.addLayerCopy(X2,ghost,active,vars::Q,-1.);
         }
       if(params::viscosity)
         {
-          primBC.vars[vars::DP](span,idx1,span)=
-            primBC.vars[vars::DP](span,idx2,span)*Theta(span,idx1,span)/Theta(span,idx2,span);
+          copies.addLayerCopy(X2,ghost,active,vars::DP,-1.);
         }
+    }
+}
 
-      for(int i=0;i<numGhost;i++)
-  {
-    primBC.vars[vars::RHO](span,primBC.N2Local+numGhost+i,span)=
-            primBC.vars[vars::RHO](span,primBC.N2Local+numGhost-1-i,span);
-    primBC.vars[vars::U](span,primBC.N2Local+numGhost+i,span)=
-            primBC.vars[vars::U](span,primBC.N2Local+numGhost-1-i,span);
-    primBC.vars[vars::U1](span,primBC.N2Local+numGhost+i,span)=
-            primBC.vars[vars::U1](span,primBC.N2Local+numGhost-1-i,span);
-    primBC.vars[vars::U3](span,primBC.N2Local+numGhost+i,span)=
-            primBC.vars[vars::U3](span,primBC.N2Local+numGhost-1-i,span);
-    primBC.vars[vars::U2](span,primBC.N2Local+numGhost+i,span)=
-      primBC.vars[vars::U2](span,primBC.N2Local+numGhost-1-i,span)*(-1.0);
-    primBC.vars[vars::B1](span,primBC.N2Local+numGhost+i,span)=
-            primBC.vars[vars::B1](span,primBC.N2Local+numGhost-1-i,span);
-    primBC.vars[vars::B3](span,primBC.N2Local+numGhost+i,span)=
-            primBC.vars[vars::B3](span,primBC.N2Local+numGhost-1-i,span);
-    primBC.vars[vars::B2](span,primBC.N2Local+numGhost+i,span)=
-            primBC.vars[vars::B2](span,primBC.N2Local+numGhost-1-i,span)*(-1.0);
-    if(params::conduction)
-      {
-        primBC.vars[vars::Q](span,primBC.N2Local+numGhost+i,span)=
-    primBC.vars[vars::Q](span,primBC.N2Local+numGhost-1-i,span)*(-1.0);
-      }
-    if(params::viscosity)
-      {
-        primBC.vars[vars::DP](span,primBC.N2Local+numGhost+i,span)=
-                primBC.vars[vars::DP](span,primBC.N2Local+numGhost-1-i,span)*(-1.0);
-      }
-  }
+void fixPoles(grid& primBC, const geometry& geom, int &numReads,int &numWrites)
+{
+  static boundaries::copyDescriptors *poleCopies = NULL;
+  if(poleCopies == NULL)
+    {
+      const int numGhost = params::numGhost;
+      poleCopies = new boundaries::copyDescriptors(primBC);
 
-      for(int var=0;var<vars::dof;var++)
-  primBC.vars[var].eval();
+      array xCoords[3];
+      geom.getxCoords(xCoords);
+      std::vector<double> Theta(xCoords[1].elements());
+
+      if(primBC.jLocalStart == 0)
+        {
+          xCoords[1].host(&Theta[0]);
+          addPoleCopies(numGhost,numGhost+1,numGhost+2,1,&Theta[0],
+                        *poleCopies);
+        }
+      if(primBC.jLocalEnd == primBC.N2)
+        {
+          array ThetaUpper = xCoords[1]*(-1.)+M_PI;
+          ThetaUpper.host(&Theta[0]);
+          const int idx0 = primBC.N2Local+numGhost-1;
+          addPoleCopies(idx0,idx0-1,idx0-2,-1,&Theta[0],*poleCopies);
+        }
     }
+  poleCopies->apply(primBC);
 }
 
 void timeStepper::setProblemSpecificBCs(int &numReads,int &numWrites)
@@ -1239,46 +1566,62 @@ void timeStepper::setProblemSpecificBCs(int &numReads,int &numWrites)
   fixPoles(*primBC,*geomCenter,numReads,numWrites);
 };
 
-void timeStepper::applyProblemSpecificFluxFilter(int &numReads,int &numWrites)
+void timeStepper::applyProblemSpecificFluxFilter(grid &fluxX1, grid &fluxX2,
+                                                 grid &fluxX3,
+                                                 const int tileOffset[3],
+                                                 int &numReads,int &numWrites
+                                                )
 {
   const int numGhost = params::numGhost;
+  // Rows of the faces in the arrays of fluxX1, fluxX2, which may only hold
+  // a slab of the grid along X2: the faces outside of it are left out
+  const int offsetX1 = tileOffset[directions::X1];
+  const int offsetX2 = tileOffset[directions::X2];
+  const int N2Rows   = fluxX2.N2Total;
+
   // Prevents matter from flowing into the computational domain
   if(primOld->iLocalStart == 0)
     {
-      int idx = numGhost;
-      fluxesX1->vars[vars::RHO](idx,span,span)=
-	af::min(fluxesX1->vars[vars::RHO](idx,span,span),0.);
-      fluxesX1->vars[vars::RHO].eval();
+      int idx = numGhost - offsetX1;
+      fluxX1.vars[vars::RHO](idx,span,span)=
+	af::min(fluxX1.vars[vars::RHO](idx,span,span),0.);
+      fluxX1.vars[vars::RHO].eval();
     }
   if(primOld->iLocalEnd == primOld->N1)
     {
-      int idx = primOld->N1Local+numGhost;
-      fluxesX1->vars[vars::RHO](idx,span,span)=
-        af::max(fluxesX1->vars[vars::RHO](idx,span,span),0.);
-      fluxesX1->vars[vars::RHO].eval();
+      int idx = primOld->N1Local+numGhost - offsetX1;
+      fluxX1.vars[vars::RHO](idx,span,span)=
+        af::max(fluxX1.vars[vars::RHO](idx,span,span),0.);
+      fluxX1.vars[vars::RHO].eval();
     }
   
   // Set fluxes to 0 on the polar axis
   if(primOld->jLocalStart == 0)
     {
-      int idx = numGhost;
-      for(int var=0;var<vars::dof;var++)
-  {
-    fluxesX2->vars[var](span,idx,span)=0.;
-    fluxesX2->vars[var].eval();
-  }
-      fluxesX1->vars[vars::B2](span,idx-1,span)=fluxesX1->vars[vars::B2](span,idx,span)*(-1.0);
-      fluxesX1->vars[vars::B2].eval();
+      int idx = numGhost - offsetX2;
+      if(idx >= 1 && idx < N2Rows)
+        {
+          for(int var=0;var<vars::dof;var++)
+            {
+              fluxX2.vars[var](span,idx,span)=0.;
+              fluxX2.vars[var].eval();
+            }
+          fluxX1.vars[vars::B2](span,idx-1,span)=fluxX1.vars[vars::B2](span,idx,span)*(-1.0);
+          fluxX1.vars[vars::B2].eval();
+        }
     }
   if(primOld->jLocalEnd == primOld->N2)
     {
-      int idx = primOld->N2Local+numGhost;
-      for(int var=0;var<vars::dof;var++)
-  {
-    fluxesX2->vars[var](span,idx,span)=0.;
-    fluxesX2->vars[var].eval();
-  }
-      fluxesX1->vars[vars::B2](span,idx,span)=fluxesX1->vars[vars::B2](span,idx-1,span)*(-1.0);
-      fluxesX1->vars[vars::B2].eval();
+      int idx = primOld->N2Local+numGhost - offsetX2;
+      if(idx >= 1 && idx < N2Rows)
+        {
+          for(int var=0;var<vars::dof;var++)
+            {
+              fluxX2.vars[var](span,idx,span)=0.;
+              fluxX2.vars[var].eval();
+            }
+          fluxX1.vars[vars::B2](span,idx,span)=fluxX1.vars[vars::B2](span,idx-1,span)*(-1.0);
+          fluxX1.vars[vars::B2].eval();
+        }
     }
 }
@@ -2,6 +2,7 @@
 #define GRIM_TORUS_HPP
 
 #include "../problem.hpp"
+#include "../../grid/dumpwriter.hpp"
 
 /* Internal functions */
 double lFishboneMoncrief(double a, double r, double theta);
@@ -26,6 +27,13 @@ double computeSigma(double a, double r, double theta);
 
 double computeA(double a, double r, double theta);
 
-void applyFloor(grid* prim, fluidElement* elem, geometry* geom, int &numReads,int &numWrites);
+double uniformRandom(const int i, const int j, const int k);
+
+dumpWriter::errorBounds analysisErrorBounds(const bool isDerived);
+
+void windowIndices(grid* prim, geometry* geom, int start[3], int end[3]);
+
+double applyFloor(grid* prim, fluidElement* elem, geometry* geom,
+                  const bool repairNaNs, int &numReads,int &numWrites);
 
 #endif
@@ -0,0 +1,18 @@
+import sys
+import pytest
+
+def pytest_addoption(parser):
+  parser.addoption("--build_path", action="store", default=None,
+                   help='set build directory path'
+                  )
+  parser.addoption("--N1", action="store", default=64,
+                   help='grid zones in X1'
+                  )
+
+
+def pytest_configure(config):
+  buildPath =  config.getvalue('build_path')
+  gridPath           = buildPath + '/grid/'
+  reconstructionPath = buildPath + '/reconstruction/'
+  sys.path.append(gridPath)
+  sys.path.append(reconstructionPath)
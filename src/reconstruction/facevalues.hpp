@@ -0,0 +1,230 @@
+#ifndef GRIM_FACEVALUES_H_
+#define GRIM_FACEVALUES_H_
+
+#include "../params.hpp"
+#include "../grid/stencil.hpp"
+
+/* Reconstruction of the face values of a single zone from the zone and its
+ * neighbours along one direction. Templated so that the same code serves the
+ * ArrayFire stencils (T = af::array) and the zone-by-zone loops of the
+ * native backend (T = double), see grid/stencil.hpp.
+ *
+ * y0..y4 are the values at offsets -2..2. left is the value on the face
+ * i-1/2 and right the value on the face i+1/2. */
+namespace reconstruction
+{
+  template <typename T>
+  T minmodOf(const T &x, const T &y, const T &z)
+  {
+    T minOfAll = stencil::min(stencil::min(stencil::abs(x), stencil::abs(y)),
+                              stencil::abs(z)
+                             );
+
+    /* +1 for x>=0 and -1 for x<0 */
+    T signx = 1.-2.*(x < 0.);
+    T signy = 1.-2.*(y < 0.);
+    T signz = 1.-2.*(z < 0.);
+
+    return 0.25 * stencil::abs(signx + signy ) * (signx + signz ) * minOfAll;
+  }
+
+  template <typename T>
+  void faceValuesMM(const T &y1, const T &y2, const T &y3,
+                    T &left, T &right
+                   )
+  {
+    /* TODO: add an argument to slopeLimTheta.*/
+    const double slopeLimTheta = params::slopeLimTheta;
+
+    //Note: the slope is computed with dX=1., because the 1/dX in the slope
+    //exactly cancels the dX in the computation of the value on cell faces...
+    T slope = minmodOf<T>(slopeLimTheta * (y2 - y1),
+                          0.5 * (y3 - y1),
+                          slopeLimTheta * (y3 - y2)
+                         );
+
+    left  = y2 - 0.5*slope;
+    right = y2 + 0.5*slope;
+  }
+
+  //WENO5 algorithm, copied from SpEC (up to some left/right conventions, and
+  //the use of AF...)
+  //With wenoZ, the nonlinear weights are those of WENO-Z (Borges et al 2008,
+  //with the exponent 2 of the original weights), which are less dissipative
+  //near smooth extrema. All the work is done on the five values passed in,
+  //so that the whole reconstruction is a single fused stencil.
+  template <typename T>
+  void faceValuesWENO(const T &y0, const T &y1, const T &y2,
+                      const T &y3, const T &y4,
+                      const bool wenoZ,
+                      T &left, T &right
+                     )
+  {
+    const double eps2 = 1.0e-17;
+
+    //Compute smoothness operators
+    T beta1 = (( 4.0/3.0)*y0*y0 - (19.0/3.0)*y0*y1 +
+               (25.0/3.0)*y1*y1 + (11.0/3.0)*y0*y2 -
+               (31.0/3.0)*y1*y2 + (10.0/3.0)*y2*y2
+              )
+            + eps2*(1.0 + stencil::abs(y0) + stencil::abs(y1)
+                        + stencil::abs(y2)
+                   );
+
+    T beta2 = (( 4.0/3.0)*y1*y1 - (13.0/3.0)*y1*y2 +
+               (13.0/3.0)*y2*y2 + ( 5.0/3.0)*y1*y3 -
+               (13.0/3.0)*y2*y3 + ( 4.0/3.0)*y3*y3
+              )
+            + eps2*(1.0 + stencil::abs(y1) + stencil::abs(y2)
+                        + stencil::abs(y3)
+                   );
+
+    T beta3 = ((10.0/3.0)*y2*y2 - (31.0/3.0)*y2*y3 +
+               (25.0/3.0)*y3*y3 + (11.0/3.0)*y2*y4 -
+               (19.0/3.0)*y3*y4 + ( 4.0/3.0)*y4*y4
+              )
+            + eps2*(1.0 + stencil::abs(y2) + stencil::abs(y3)
+                        + stencil::abs(y4)
+                   );
+
+    //Compute the unnormalized weights 1/beta^2 (WENO5) or
+    //1 + (tau5/beta)^2 (WENO-Z), without the linear weights
+    T a1, a2, a3;
+    if (wenoZ)
+    {
+      T tau5 = stencil::abs(beta1 - beta3);
+      a1 = 1.0 + (tau5*tau5)/(beta1*beta1);
+      a2 = 1.0 + (tau5*tau5)/(beta2*beta2);
+      a3 = 1.0 + (tau5*tau5)/(beta3*beta3);
+    }
+    else
+    {
+      a1 = 1.0/(beta1*beta1);
+      a2 = 1.0/(beta2*beta2);
+      a3 = 1.0/(beta3*beta3);
+    }
+
+    //Compute weights
+    T w1r = (1.0/16.0)*a1;
+    T w2r = (5.0/ 8.0)*a2;
+    T w3r = (5.0/16.0)*a3;
+    T w1l = (5.0/16.0)*a1;
+    T w2l = (5.0/ 8.0)*a2;
+    T w3l = (1.0/16.0)*a3;
+    T denl = w1l + w2l + w3l;
+    T denr = w1r + w2r + w3r;
+
+    // Substencil Interpolations
+    T u1r =  0.375*y0 - 1.25*y1 + 1.875*y2;
+    T u2r = -0.125*y1 + 0.75*y2 + 0.375*y3;
+    T u3r =  0.375*y2 + 0.75*y3 - 0.125*y4;
+    T u1l = -0.125*y0 + 0.75*y1 + 0.375*y2;
+    T u2l =  0.375*y1 + 0.75*y2 - 0.125*y3;
+    T u3l =  1.875*y2 - 1.25*y3 + 0.375*y4;
+
+    //Reconstruction
+    left  = (w1l*u1l + w2l*u2l + w3l*u3l) / denl;
+    right = (w1r*u1r + w2r*u2r + w3r*u3r) / denr;
+  }
+
+  template <typename T>
+  void faceValuesWENO5(const T &y0, const T &y1, const T &y2,
+                       const T &y3, const T &y4,
+                       T &left, T &right
+                      )
+  {
+    faceValuesWENO<T>(y0, y1, y2, y3, y4, false, left, right);
+  }
+
+  template <typename T>
+  void faceValuesWENOZ(const T &y0, const T &y1, const T &y2,
+                       const T &y3, const T &y4,
+                       T &left, T &right
+                      )
+  {
+    faceValuesWENO<T>(y0, y1, y2, y3, y4, true, left, right);
+  }
+
+  // PPM algorithm, adapted from HARM code (by X. Guan)
+  // ref. Colella && Woodward's PPM paper
+  template <typename T>
+  void faceValuesPPM(const T &y0, const T &y1, const T &y2,
+                     const T &y3, const T &y4,
+                     T &leftV, T &rightV
+                    )
+  {
+    // Approximants for slopes
+    T d0 = 2.*(y1-y0);
+    T d1 = 2.*(y2-y1);
+    T d2 = 2.*(y3-y2);
+    T d3 = 2.*(y4-y3);
+    T D1 = 0.5*(y2-y0);
+    T D2 = 0.5*(y3-y1);
+    T D3 = 0.5*(y4-y2);
+
+    T condZeroSlope1 = 1.*(d1*d0<=0.);
+    T sign1 = (D1>0.)*2.-1.;
+    T DQ1 = (1.-condZeroSlope1)*sign1
+           *stencil::min(stencil::abs(D1),
+                         stencil::min(stencil::abs(d0),stencil::abs(d1))
+                        );
+    T condZeroSlope2 = 1.*(d2*d1<=0.);
+    T sign2 = (D2>0.)*2.-1.;
+    T DQ2 = (1.-condZeroSlope2)*sign2
+           *stencil::min(stencil::abs(D2),
+                         stencil::min(stencil::abs(d1),stencil::abs(d2))
+                        );
+    T condZeroSlope3 = 1.*(d3*d2<=0.);
+    T sign3 = (D3>0.)*2.-1.;
+    T DQ3 = (1.-condZeroSlope3)*sign3
+           *stencil::min(stencil::abs(D3),
+                         stencil::min(stencil::abs(d2),stencil::abs(d3))
+                        );
+
+    // Base high-order PPM reconstruction
+    leftV  = 0.5*(y2+y1)-1./6.*(DQ2-DQ1);
+    rightV = 0.5*(y3+y2)-1./6.*(DQ3-DQ2);
+
+    // Corrections
+    T corr1 = 1.*((rightV-y2)*(y2-leftV)<=0.);
+    T qd = rightV-leftV;
+    T qe = 6.*(y2-0.5*(rightV+leftV));
+    T corr2 = 1.*(qd*(qd-qe)<0.);
+    T corr3 = 1.*(qd*(qd+qe)<0.);
+    leftV  = leftV*(1.-corr1)+corr1*y2;
+    rightV = rightV*(1.-corr1)+corr1*y2;
+
+    T leftCorrected = leftV*(1.-corr2)+corr2*(3.*y2-2.*rightV);
+    rightV =   rightV*corr2+(1.-corr2)*rightV*(1.-corr3)
+             + (1.-corr2)*corr3*(3.*y2-2.*leftCorrected);
+    leftV  = leftCorrected;
+  }
+
+  template <typename T>
+  void faceValues(const T &y0, const T &y1, const T &y2,
+                  const T &y3, const T &y4,
+                  T &left, T &right
+                 )
+  {
+    switch (params::reconstruction)
+    {
+      case reconstructionOptions::MINMOD:
+        faceValuesMM<T>(y1, y2, y3, left, right);
+        break;
+
+      case reconstructionOptions::WENO5:
+        faceValuesWENO5<T>(y0, y1, y2, y3, y4, left, right);
+        break;
+
+      case reconstructionOptions::WENOZ:
+        faceValuesWENOZ<T>(y0, y1, y2, y3, y4, left, right);
+        break;
+
+      case reconstructionOptions::PPM:
+        faceValuesPPM<T>(y0, y1, y2, y3, y4, left, right);
+        break;
+    }
+  }
+}
+
+#endif /* GRIM_FACEVALUES_H_ */
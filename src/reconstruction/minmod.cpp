@@ -1,19 +1,63 @@
 #include "reconstruction.hpp"
 
+namespace
+{
+  template <typename field, typename T>
+  T slopeMMAt(const field &in, const int dir, const double dX)
+  {
+    T forwardDiff  = (in.at(dir, 1) - in.at(dir, 0))/dX;
+    T backwardDiff = (in.at(dir, 0) - in.at(dir,-1))/dX;
+    T centralDiff  = backwardDiff + forwardDiff;
+
+    /* TODO: add an argument to slopeLimTheta.*/
+    const double slopeLimTheta = params::slopeLimTheta;
+    return reconstruction::minmodOf<T>(slopeLimTheta * backwardDiff,
+                                       0.5 * centralDiff,
+                                       slopeLimTheta * forwardDiff
+                                      );
+  }
+
+  struct slopeMMKernel
+  {
+    static const int numInputs  = 1;
+    static const int numOutputs = 1;
+
+    int dir;
+    double dX;
+
+    template <typename field, typename T>
+    void operator()(const field in[], T out[]) const
+    {
+      out[0] = slopeMMAt<field, T>(in[0], dir, dX);
+    }
+  };
+
+  /* in -> out[0] (left), out[1] (right), for every variable along the 4th
+   * dimension at once */
+  struct reconstructMMKernel
+  {
+    static const int numInputs  = 1;
+    static const int numOutputs = 2;
+
+    int dir;
+
+    template <typename field, typename T>
+    void operator()(const field in[], T out[]) const
+    {
+      reconstruction::faceValuesMM<T>(in[0].at(dir,-1),
+                                      in[0].at(dir, 0),
+                                      in[0].at(dir, 1),
+                                      out[0], out[1]
+                                     );
+    }
+  };
+}
+
 array reconstruction::minmod(array &x, array &y, array &z,
                              int &numReads, int &numWrites
                             )
 {
-  array minOfAll = af::min(af::min(af::abs(x), af::abs(y)), 
-		                       af::abs(z)
-               			      );
-  
-  //Stupid convention in ArrayFire: sign(x)=1 for x<0 and sign(x)=0 for x>0
-  array signx = 1.-2.*sign(x);
-  array signy = 1.-2.*sign(y);
-  array signz = 1.-2.*sign(z);
-  
-  array result = 0.25 * af::abs(signx + signy ) * (signx + signz ) * minOfAll;
+  array result = minmodOf<array>(x, y, z);
 
   return result;
 }
@@ -23,41 +67,20 @@ array reconstruction::slopeMM(const int dir,const double dX, const array& in,
                               int &numWrites
                              )
 {
-  double filter1D[]  = {1,-1, 0, /* Forward difference */
-                        0, 1,-1  /* Backward difference */
-                       };
-  array filter;
-  switch (dir)
-  {
-    case directions::X1:
-    	filter =  array(3, 1, 1, 2, filter1D)/dX;
-    	break;
-
-    case directions::X2:
-    	filter =  array(1, 3, 1, 2, filter1D)/dX;
-    	break;
+  slopeMMKernel kernel;
+  kernel.dir = dir;
+  kernel.dX  = dX;
 
-    case directions::X3:
-    	filter =  array(1, 1, 3, 2, filter1D)/dX;
-    	break;
-  }
-  
-  array dvar_dX = convolve(in, filter);
-  
-  array forwardDiff  = dvar_dX(span, span, span, 0);
-  array backwardDiff = dvar_dX(span, span, span, 1);
-  array centralDiff  = backwardDiff + forwardDiff;
-  
-  /* TODO: add an argument to slopeLimTheta.*/
-  double slopeLimTheta = params::slopeLimTheta;
-  array left   = slopeLimTheta * backwardDiff;
-  array center = 0.5 * centralDiff;
-  array right  = slopeLimTheta * forwardDiff;
-  
-  int numReadsMinMod, numWritesMinMod;
-  array result = minmod(left, center, right,
-                        numReadsMinMod, numWritesMinMod
-                       );
+  array result = stencil::apply(kernel, 1, in);
+  /* Reads:
+   * -----
+   * in : 1
+   *
+   * Writes:
+   * ------
+   * result : 1 */
+  numReads  = 1;
+  numWrites = 1;
 
   return result;
 }
@@ -70,22 +93,58 @@ void reconstruction::reconstructMM(const grid &prim,
                                    int &numWrites
                           		    )
 {
-  int numReadsMinMod, numWritesMinMod;
-  std::vector<af::array *> arraysThatNeedEval;
-  for(int var=0; var<prim.numVars; var++)
-  {
-  	//Note: we set dX=1., because the 1/dX in slope
-  	//exactly cancels the dX in the computation of the
-  	//value on cell faces...
-  	array slope = slopeMM(dir,1.,prim.vars[var],
-                          numReadsMinMod, numWritesMinMod
-                         );
-  	primLeft.vars[var]  = prim.vars[var] - 0.5*slope;
-  	primRight.vars[var] = prim.vars[var] + 0.5*slope;
-
-    arraysThatNeedEval.push_back(&primLeft.vars[var]);
-    arraysThatNeedEval.push_back(&primRight.vars[var]);
-  }
-  af::eval(arraysThatNeedEval.size(), &arraysThatNeedEval[0]);
+  array primLeftSoA, primRightSoA;
+  reconstructMM(prim.getVarsSoA(), dir, primLeftSoA, primRightSoA,
+                numReads, numWrites
+               );
+  primLeft.setVarsFromSoA(primLeftSoA);
+  primRight.setVarsFromSoA(primRightSoA);
+}
+
+void reconstruction::reconstructMM(const array &primSoA,
+                                   const int dir,
+                                   array &primLeftSoA,
+                                   array &primRightSoA,
+                                   int &numReads,
+                                   int &numWrites
+                                  )
+{
+  reconstructMMKernel kernel;
+  kernel.dir = dir;
+
+  const af::array *in[] = {&primSoA};
+  af::array *out[] = {&primLeftSoA, &primRightSoA};
+  stencil::apply(kernel, 1, in, out);
+  /* Reads:
+   * -----
+   * prim : numVars
+   *
+   * Writes:
+   * ------
+   * primLeft, primRight : 2*numVars */
+  numReads  = primSoA.dims(3);
+  numWrites = 2*primSoA.dims(3);
 }
 
+void reconstruction::reconstructFacesMM(const array &primSoA,
+                                        const int dir,
+                                        array &primFacesSoA,
+                                        int &numReads,
+                                        int &numWrites
+                                       )
+{
+  reconstructMMKernel kernel;
+  kernel.dir = dir;
+
+  const af::array *in[] = {&primSoA};
+  stencil::applyInterleaved(kernel, 1, in, primFacesSoA);
+  /* Reads:
+   * -----
+   * prim : numVars
+   *
+   * Writes:
+   * ------
+   * primFaces : 2*numVars */
+  numReads  = primSoA.dims(3);
+  numWrites = 2*primSoA.dims(3);
+}
@@ -7,20 +7,38 @@ void reconstruction::reconstruct(const grid &prim,
                                  int &numReads,
                                  int &numWrites
                                 )
+{
+  array primLeftSoA, primRightSoA;
+  reconstruct(prim.getVarsSoA(), dir, primLeftSoA, primRightSoA,
+              numReads, numWrites
+             );
+  primLeft.setVarsFromSoA(primLeftSoA);
+  primRight.setVarsFromSoA(primRightSoA);
+}
+
+void reconstruction::reconstruct(const array &primSoA,
+                                 const int dir,
+                                 array &primLeftSoA,
+                                 array &primRightSoA,
+                                 int &numReads,
+                                 int &numWrites
+                                )
 {
   switch (params::reconstruction)
   {
     case reconstructionOptions::MINMOD:
 
-      reconstruction::reconstructMM(prim, dir, primLeft, primRight,
+      reconstruction::reconstructMM(primSoA, dir, primLeftSoA, primRightSoA,
                                     numReads, numWrites
                                    );
 
       break;
 
     case reconstructionOptions::WENO5:
+    case reconstructionOptions::WENOZ:
 
-      reconstruction::reconstructWENO5(prim, dir, primLeft, primRight,
+      reconstruction::reconstructWENO5(primSoA, dir,
+                                       primLeftSoA, primRightSoA,
                                        numReads, numWrites
                                       );
 
@@ -28,15 +46,52 @@ void reconstruction::reconstruct(const grid &prim,
 
   case reconstructionOptions::PPM:
 
-      reconstruction::reconstructPPM(prim, dir, primLeft, primRight,
-                                       numReads, numWrites
-                                      );
+      reconstruction::reconstructPPM(primSoA, dir,
+                                     primLeftSoA, primRightSoA,
+                                     numReads, numWrites
+                                    );
 
       break;
   }
 
 }
 
+void reconstruction::reconstructFaces(const array &primSoA,
+                                      const int dir,
+                                      array &primFacesSoA,
+                                      int &numReads,
+                                      int &numWrites
+                                     )
+{
+  switch (params::reconstruction)
+  {
+    case reconstructionOptions::MINMOD:
+
+      reconstruction::reconstructFacesMM(primSoA, dir, primFacesSoA,
+                                         numReads, numWrites
+                                        );
+
+      break;
+
+    case reconstructionOptions::WENO5:
+    case reconstructionOptions::WENOZ:
+
+      reconstruction::reconstructFacesWENO5(primSoA, dir, primFacesSoA,
+                                            numReads, numWrites
+                                           );
+
+      break;
+
+    case reconstructionOptions::PPM:
+
+      reconstruction::reconstructFacesPPM(primSoA, dir, primFacesSoA,
+                                          numReads, numWrites
+                                         );
+
+      break;
+  }
+}
+
 array reconstruction::slope(const int dir, const double dX,
 			                      const array& in,
                             int &numReads,
@@ -50,6 +105,7 @@ array reconstruction::slope(const int dir, const double dX,
       return reconstruction::slopeMM(dir,dX,in, numReads, numWrites);
 
     case reconstructionOptions::WENO5:
+    case reconstructionOptions::WENOZ:
 
       return reconstruction::slopeWENO5(dir,dX,in, numReads, numWrites);
 
@@ -2,6 +2,8 @@
 #define GRIM_RECONSTRUCT_H_
 
 #include "../grid/grid.hpp"
+#include "../grid/stencil.hpp"
+#include "facevalues.hpp"
 
 /* Reconstruction routines */
 namespace reconstruction
@@ -65,6 +67,73 @@ namespace reconstruction
                    int &numReads,
                    int &numWrites
                   );
+
+  /* Batched versions: primSoA holds all the variables along the 4th
+   * dimension (see grid::getVarsSoA()) and the whole N1 x N2 x N3 x numVars
+   * block is reconstructed in one operation */
+  void reconstructMM(const array &primSoA,
+                     const int dir,
+                     array &primLeftSoA,
+                     array &primRightSoA,
+                     int &numReads,
+                     int &numWrites
+                    );
+
+  void reconstructWENO5(const array &primSoA,
+                        const int dir,
+                        array &primLeftSoA,
+                        array &primRightSoA,
+                        int &numReads,
+                        int &numWrites
+                       );
+
+  void reconstructPPM(const array &primSoA,
+                      const int dir,
+                      array &primLeftSoA,
+                      array &primRightSoA,
+                      int &numReads,
+                      int &numWrites
+                     );
+
+  void reconstruct(const array &primSoA,
+                   const int dir,
+                   array &primLeftSoA,
+                   array &primRightSoA,
+                   int &numReads,
+                   int &numWrites
+                  );
+
+  /* Both face states in one array: primFacesSoA is N1 x N2 x N3 x
+   * 2*numVars, with the left state (face i-1/2) of var at 2*var and its
+   * right state (face i+1/2) at 2*var+1. The states of a variable are thus a
+   * contiguous view, which riemannSolver::solve() uses without a copy */
+  void reconstructFacesMM(const array &primSoA,
+                          const int dir,
+                          array &primFacesSoA,
+                          int &numReads,
+                          int &numWrites
+                         );
+
+  void reconstructFacesWENO5(const array &primSoA,
+                             const int dir,
+                             array &primFacesSoA,
+                             int &numReads,
+                             int &numWrites
+                            );
+
+  void reconstructFacesPPM(const array &primSoA,
+                           const int dir,
+                           array &primFacesSoA,
+                           int &numReads,
+                           int &numWrites
+                          );
+
+  void reconstructFaces(const array &primSoA,
+                        const int dir,
+                        array &primFacesSoA,
+                        int &numReads,
+                        int &numWrites
+                       );
 }
 
 #endif /* GRIM_RECONSTRUCT_H_ */
@@ -22,3 +22,13 @@ cdef extern from "reconstruction.hpp" namespace "reconstruction":
                         int &numReads,
                         int &numWrites
                        )
+
+cdef extern from "reconstruction.hpp":
+  cdef enum:
+    RECONSTRUCTION_MINMOD "reconstructionOptions::MINMOD"
+    RECONSTRUCTION_WENO5  "reconstructionOptions::WENO5"
+    RECONSTRUCTION_PPM    "reconstructionOptions::PPM"
+    RECONSTRUCTION_WENOZ  "reconstructionOptions::WENOZ"
+
+cdef extern from "reconstruction.hpp" namespace "params":
+  int reconstruction
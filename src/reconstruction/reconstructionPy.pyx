@@ -2,9 +2,25 @@ from gridPy cimport gridPy # cimport stands for importing C types. Needed here
                            # to set the definitions for the arguments of
                            # reconstructPy
 # Import the C++ functions
+cimport reconstructionHeaders
 from reconstructionHeaders cimport reconstruct
 from reconstructionHeaders cimport reconstructMM
 from reconstructionHeaders cimport reconstructWENO5
+from reconstructionHeaders cimport RECONSTRUCTION_MINMOD
+from reconstructionHeaders cimport RECONSTRUCTION_WENO5
+from reconstructionHeaders cimport RECONSTRUCTION_PPM
+from reconstructionHeaders cimport RECONSTRUCTION_WENOZ
+
+# reconstruction options
+MINMOD = RECONSTRUCTION_MINMOD
+WENO5  = RECONSTRUCTION_WENO5
+PPM    = RECONSTRUCTION_PPM
+WENOZ  = RECONSTRUCTION_WENOZ
+
+# Sets params::reconstruction, which also selects the WENO5 or the WENO-Z
+# weights of reconstructWENO5Py()
+def setReconstructionPy(int option):
+  reconstructionHeaders.reconstruction = option
 
 def reconstructPy(gridPy prim,
                   int dir, 
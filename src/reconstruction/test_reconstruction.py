@@ -0,0 +1,120 @@
+import mpi4py, petsc4py
+from petsc4py import PETSc
+import numpy as np
+import pytest
+import gridPy
+import reconstructionPy
+
+petsc4py.init()
+petscComm  = petsc4py.PETSc.COMM_WORLD
+comm = petscComm.tompi4py()
+rank = comm.Get_rank()
+numProcs = comm.Get_size()
+PETSc.Sys.Print("Using %d procs" % numProcs)
+
+# Face values of the WENO reconstructions along X1, on a 1D grid. The ghost
+# zones are filled in with the data too, so that every interior zone has its
+# full stencil
+N1 = int(pytest.config.getoption('N1'))
+dim = 1
+numVars = 1
+numGhost = 3
+
+# No extremum of the polynomials below in the domain
+X1Start = 1.; X1End = 2.
+
+def faceValues(option, N1, data):
+  XCoords = gridPy.coordinatesGridPy(N1, 1, 1,
+                                     dim, numGhost,
+                                     X1Start, X1End,
+                                     0., 1., 0., 1.
+                                    )
+  X1Coords, X2Coords, X3Coords = XCoords.getCoords(gridPy.CENTER)
+  dX1 = XCoords.dX1
+
+  prim      = gridPy.gridPy(N1, 1, 1, dim, numVars, numGhost, 0, 0, 0)
+  primLeft  = gridPy.gridPy(N1, 1, 1, dim, numVars, numGhost, 0, 0, 0)
+  primRight = gridPy.gridPy(N1, 1, 1, dim, numVars, numGhost, 0, 0, 0)
+
+  primVars = np.zeros(prim.shape)
+  primVars[0] = data(X1Coords)
+  prim.setVars(primVars)
+
+  reconstructionPy.setReconstructionPy(option)
+  reconstructionPy.reconstructWENO5Py(prim, gridPy.X1, primLeft, primRight)
+
+  interior = np.s_[0, 0, 0, numGhost:-numGhost]
+  return [X1Coords[0, 0, numGhost:-numGhost] - 0.5*dX1,
+          X1Coords[0, 0, numGhost:-numGhost] + 0.5*dX1,
+          primVars[interior],
+          primLeft.getVars()[interior],
+          primRight.getVars()[interior]
+         ]
+
+def globalMax(localValue):
+  return comm.allreduce(localValue, op=mpi4py.MPI.MAX)
+
+def polynomial(degree):
+  return lambda X: (X + 0.5)**degree
+
+def faceError(option, N, p):
+  XLeft, XRight, values, left, right = faceValues(option, N, p)
+  return globalMax(max(np.max(np.abs(left  - p(XLeft))),
+                       np.max(np.abs(right - p(XRight)))
+                      )
+                  )
+
+@pytest.mark.parametrize("option", [reconstructionPy.WENO5,
+                                    reconstructionPy.WENOZ
+                                   ]
+                        )
+def test_weno_exact_polynomials(option):
+  # Every sub-stencil interpolates polynomials up to degree 2 exactly, so do
+  # the faces whatever the nonlinear weights
+  for degree in range(3):
+    p = polynomial(degree)
+    XLeft, XRight, values, left, right = faceValues(option, N1, p)
+    np.testing.assert_allclose(left,  p(XLeft),  rtol=1e-12, atol=1e-13)
+    np.testing.assert_allclose(right, p(XRight), rtol=1e-12, atol=1e-13)
+
+def test_weno_fifth_order():
+  # Beyond degree 2 the WENO5 faces are only exact with the linear weights:
+  # away from extrema the nonlinear weights tend to them fast enough for
+  # the faces to converge at fifth order
+  for degree in [3, 4]:
+    p = polynomial(degree)
+    errors = [faceError(reconstructionPy.WENO5, N, p) for N in [N1, 2*N1]]
+    assert(errors[1] < errors[0]/16.)
+
+def test_wenoz_less_dissipative():
+  # The WENO-Z weights are much closer to the linear ones on smooth data
+  for degree in [3, 4]:
+    p = polynomial(degree)
+    assert(  faceError(reconstructionPy.WENOZ, N1, p)
+           < 1e-2*faceError(reconstructionPy.WENO5, N1, p)
+          )
+
+@pytest.mark.parametrize("option", [reconstructionPy.WENO5,
+                                    reconstructionPy.WENOZ
+                                   ]
+                        )
+def test_weno_step_no_new_extrema(option):
+  low = 0.5; high = 2.
+  step = lambda X: np.where(X < 0.5*(X1Start + X1End) + 1e-3, low, high)
+  XLeft, XRight, values, left, right = faceValues(option, N1, step)
+
+  tolerance = 1e-12*high
+  assert(np.all(left  >= low  - tolerance))
+  assert(np.all(left  <= high + tolerance))
+  assert(np.all(right >= low  - tolerance))
+  assert(np.all(right <= high + tolerance))
+
+  # Away from the step the data is constant over the whole stencil
+  stepDistance = np.abs(XLeft + XRight - (X1Start + X1End))
+  farFromStep  = stepDistance > 8.*(X1End - X1Start)/N1
+  np.testing.assert_allclose(left[farFromStep],  values[farFromStep],
+                             rtol=1e-12
+                            )
+  np.testing.assert_allclose(right[farFromStep], values[farFromStep],
+                             rtol=1e-12
+                            )
@@ -1,58 +1,158 @@
 #include "timestepper.hpp"
 
-void timeStepper::fluxCT(int &numReads,
-                         int &numWrites
-                        )
+namespace
 {
-  if (fluxesX1->dim >= 2)
+  /* 2D: in = {emfX3}, out = {fluxesX1[B2], fluxesX2[B1]}
+   * 3D: in = {emfX3, emfX1, emfX2},
+   *     out = {fluxesX1[B2], fluxesX2[B1],
+   *            fluxesX1[B3], fluxesX2[B3], fluxesX3[B1], fluxesX3[B2]} */
+  template <int Dim>
+  struct fluxCTKernel
   {
-    int numReadsEMF, numWritesEMF;
-    computeEMF(numReadsEMF, numWritesEMF);
+    static const int numInputs  = (Dim == 3 ? 3 : 1);
+    static const int numOutputs = (Dim == 3 ? 6 : 2);
 
-    fluxesX1->vars[vars::B1] = 0.;
+    template <typename field, typename T>
+    void operator()(const field in[], T out[]) const
+    {
+      const field &emfX3 = in[0];
 
-    fluxesX1->vars[vars::B2] = 
-      0.5*(  emfX3->vars[0]
-           + shift(emfX3->vars[0], 0, -1, 0)
-          );
-    fluxesX1->vars[vars::B2].eval();
+      out[0] =  0.5*(emfX3(0, 0, 0) + emfX3(0, 1, 0));
+      out[1] = -0.5*(emfX3(0, 0, 0) + emfX3(1, 0, 0));
 
-    fluxesX2->vars[vars::B1] =
-      -0.5*(  emfX3->vars[0]
-            + shift(emfX3->vars[0], -1, 0, 0)
-           );
-    fluxesX2->vars[vars::B1].eval();
+      if (Dim == 3)
+      {
+        const field &emfX1 = in[1];
+        const field &emfX2 = in[2];
 
-    fluxesX2->vars[vars::B2] = 0.;
+        out[2] = -0.5*(emfX2(0, 0, 0) + emfX2(0, 0, 1));
+        out[3] =  0.5*(emfX1(0, 0, 0) + emfX1(0, 0, 1));
+        out[4] =  0.5*(emfX2(0, 0, 0) + emfX2(1, 0, 0));
+        out[5] = -0.5*(emfX1(0, 0, 0) + emfX1(0, 1, 0));
+      }
+    }
+  };
+
+  /* 2D: in = {fluxesX1[B2], fluxesX2[B1]}, out = {emfX3}
+   * 3D: in = {fluxesX1[B2], fluxesX2[B1],
+   *           fluxesX2[B3], fluxesX3[B2], fluxesX3[B1], fluxesX1[B3]},
+   *     out = {emfX3, emfX1, emfX2} */
+  template <int Dim>
+  struct emfKernel
+  {
+    static const int numInputs  = (Dim == 3 ? 6 : 2);
+    static const int numOutputs = (Dim == 3 ? 3 : 1);
 
-    if (fluxesX1->dim == 3)
+    template <typename field, typename T>
+    void operator()(const field in[], T out[]) const
     {
-      fluxesX1->vars[vars::B3] =
-        -0.5*(  emfX2->vars[0]
-              + shift(emfX2->vars[0], 0, 0, -1)
-             );
-      fluxesX1->vars[vars::B3].eval();
-
-      fluxesX2->vars[vars::B3] =
-        0.5*(  emfX1->vars[0]
-             + shift(emfX1->vars[0], 0, 0, -1)
-            );
-      fluxesX2->vars[vars::B3].eval();
-      
-      fluxesX3->vars[vars::B1] =
-        0.5*(  emfX2->vars[0]
-             + shift(emfX2->vars[0], -1, 0, 0)
-            );
-      fluxesX3->vars[vars::B1].eval();
+      const field &F1B2 = in[0];
+      const field &F2B1 = in[1];
+
+      out[0] = 0.25*(  F1B2(0, 0, 0) + F1B2(0, -1, 0)
+                     - F2B1(0, 0, 0) - F2B1(-1, 0, 0)
+                    );
+
+      if (Dim == 3)
+      {
+        const field &F2B3 = in[2];
+        const field &F3B2 = in[3];
+        const field &F3B1 = in[4];
+        const field &F1B3 = in[5];
+
+        out[1] = 0.25*(  F2B3(0, 0, 0) + F2B3(0, 0, -1)
+                       - F3B2(0, 0, 0) - F3B2(0, -1, 0)
+                      );
+
+        out[2] = 0.25*(  F3B1(0, 0, 0) + F3B1(-1, 0, 0)
+                       - F1B3(0, 0, 0) - F1B3(0, 0, -1)
+                      );
+      }
+    }
+  };
+
+  /* in = {g, B1, B2} */
+  struct divBKernel
+  {
+    static const int numInputs  = 3;
+    static const int numOutputs = 1;
+
+    double dX1, dX2;
+
+    template <typename field, typename T>
+    void operator()(const field in[], T out[]) const
+    {
+      const field &g  = in[0];
+      const field &B1 = in[1];
+      const field &B2 = in[2];
+
+      out[0] =
+        (  g( 0, 0, 0)*B1( 0, 0, 0) + g( 0,-1, 0)*B1( 0,-1, 0)
+         - g(-1, 0, 0)*B1(-1, 0, 0) - g(-1,-1, 0)*B1(-1,-1, 0)
+        )/(2.*dX1)
+      +
+        (  g( 0, 0, 0)*B2( 0, 0, 0) + g(-1, 0, 0)*B2(-1, 0, 0)
+         - g( 0,-1, 0)*B2( 0,-1, 0) - g(-1,-1, 0)*B2(-1,-1, 0)
+        )/(2.*dX2);
+    }
+  };
+}
+
+void timeStepper::fluxCT(int &numReads,
+                         int &numWrites
+                        )
+{
+  fluxCT(*fluxesX1, *fluxesX2, *fluxesX3, *emfX1, *emfX2, *emfX3,
+         numReads, numWrites
+        );
+}
+
+/* Also used on the tiles of computeDivOfFluxes(), which hold the fluxes and
+ * the emfs of a slab of the grid */
+void timeStepper::fluxCT(grid &fluxX1, grid &fluxX2, grid &fluxX3,
+                         grid &emf1, grid &emf2, grid &emf3,
+                         int &numReads,
+                         int &numWrites
+                        )
+{
+  numReads = 0; numWrites = 0;
+  if (fluxX1.dim >= 2)
+  {
+    int numReadsEMF, numWritesEMF;
+    computeEMF(fluxX1, fluxX2, fluxX3, emf1, emf2, emf3,
+               numReadsEMF, numWritesEMF
+              );
+
+    const af::array *in[] = {&emf3.vars[0], &emf1.vars[0], &emf2.vars[0]};
+    af::array *out[] = {&fluxX1.vars[vars::B2], &fluxX2.vars[vars::B1],
+                        &fluxX1.vars[vars::B3], &fluxX2.vars[vars::B3],
+                        &fluxX3.vars[vars::B1], &fluxX3.vars[vars::B2]
+                       };
+    if (fluxX1.dim == 2)
+    {
+      stencil::apply(fluxCTKernel<2>(), 1, in, out);
+    }
+    else
+    {
+      stencil::apply(fluxCTKernel<3>(), 1, in, out);
+    }
 
-      fluxesX3->vars[vars::B2] =
-        -0.5*(  emfX1->vars[0]
-              + shift(emfX1->vars[0], 0, -1, 0)
-             );
-      fluxesX3->vars[vars::B2].eval();
+    fluxX1.vars[vars::B1] = 0.;
+    fluxX2.vars[vars::B2] = 0.;
 
-      fluxesX3->vars[vars::B3] = 0.;
+    if (fluxX1.dim == 3)
+    {
+      fluxX3.vars[vars::B3] = 0.;
     }
+    /* Reads:
+     * -----
+     *  emfs : 1 (2D), 3 (3D)
+     *
+     * Writes:
+     * ------
+     * fluxes of B : 4 (2D), 9 (3D) */
+    numReads  = numReadsEMF  + (fluxX1.dim == 2 ? 1 : 3);
+    numWrites = numWritesEMF + (fluxX1.dim == 2 ? 4 : 9);
   }
 }
 
@@ -60,35 +160,48 @@ void timeStepper::computeEMF(int &numReadsEMF,
                              int &numWritesEMF
                             )
 {
-  if (fluxesX1->dim >= 2)
-  {
-    emfX3->vars[0] = 
-      0.25*(  fluxesX1->vars[vars::B2] 
-            + shift(fluxesX1->vars[vars::B2], 0, 1, 0)
-            - fluxesX2->vars[vars::B1]
-            - shift(fluxesX2->vars[vars::B1], 1, 0, 0)
-           );
-
-    emfX3->vars[0].eval();
+  computeEMF(*fluxesX1, *fluxesX2, *fluxesX3, *emfX1, *emfX2, *emfX3,
+             numReadsEMF, numWritesEMF
+            );
+}
 
-    if (fluxesX1->dim == 3)
+void timeStepper::computeEMF(const grid &fluxX1,
+                             const grid &fluxX2,
+                             const grid &fluxX3,
+                             grid &emf1, grid &emf2, grid &emf3,
+                             int &numReadsEMF,
+                             int &numWritesEMF
+                            )
+{
+  numReadsEMF = 0; numWritesEMF = 0;
+  if (fluxX1.dim >= 2)
+  {
+    const af::array *in[] = {&fluxX1.vars[vars::B2],
+                             &fluxX2.vars[vars::B1],
+                             &fluxX2.vars[vars::B3],
+                             &fluxX3.vars[vars::B2],
+                             &fluxX3.vars[vars::B1],
+                             &fluxX1.vars[vars::B3]
+                            };
+    af::array *out[] = {&emf3.vars[0], &emf1.vars[0], &emf2.vars[0]};
+
+    if (fluxX1.dim == 2)
     {
-      emfX1->vars[0] =
-        0.25*(  fluxesX2->vars[vars::B3]
-              + shift(fluxesX2->vars[vars::B3], 0, 0, 1)
-              - fluxesX3->vars[vars::B2]
-              - shift(fluxesX3->vars[vars::B2], 0, 1, 0)
-             );
-      emfX1->vars[0].eval();
-
-      emfX2->vars[0] =
-        0.25*(  fluxesX3->vars[vars::B1]
-              + shift(fluxesX3->vars[vars::B1], 1, 0, 0)
-              - fluxesX1->vars[vars::B3]
-              - shift(fluxesX1->vars[vars::B3], 0, 0, 1)
-             );
-      emfX2->vars[0].eval();
+      stencil::apply(emfKernel<2>(), 1, in, out);
     }
+    else
+    {
+      stencil::apply(emfKernel<3>(), 1, in, out);
+    }
+    /* Reads:
+     * -----
+     *  fluxes of B : 2 (2D), 6 (3D)
+     *
+     * Writes:
+     * ------
+     * emfs : 1 (2D), 3 (3D) */
+    numReadsEMF  = (fluxX1.dim == 2 ? 2 : 6);
+    numWritesEMF = (fluxX1.dim == 2 ? 1 : 3);
   }
 }
 
@@ -97,21 +210,18 @@ void timeStepper::computeDivB(const grid &prim,
                               int &numWrites
                              )
 {
-
-  array B1 = prim.vars[vars::B1];
-  array B2 = prim.vars[vars::B2];
-  array B3 = prim.vars[vars::B3];
-  array g  = geomCenter->g;
-
   if (prim.dim == 2)
   {
-    divB->vars[0] =
-      (  g*B1 + shift(g*B1, 0, 1, 0) 
-       - shift(g*B1, 1, 0, 0) - shift(g*B1, 1, 1, 0)
-      )/(2.*XCoords->dX1)
-    +
-      (  g*B2 + shift(g*B2, 1, 0, 0)
-       - shift(g*B2, 0, 1, 0) - shift(g*B2, 1, 1, 0)
-      )/(2.*XCoords->dX2);
+    divBKernel kernel;
+    kernel.dX1 = XCoords->dX1;
+    kernel.dX2 = XCoords->dX2;
+
+    const af::array *in[] = {&geomCenter->g,
+                             &prim.vars[vars::B1],
+                             &prim.vars[vars::B2]
+                            };
+    af::array *out[] = {&divB->vars[0]};
+
+    stencil::apply(kernel, 1, in, out);
   }
 }
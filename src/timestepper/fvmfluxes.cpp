@@ -1,185 +1,691 @@
 #include "timestepper.hpp"
 
-void timeStepper::computeDivOfFluxes(const grid &primFlux,
-                                     int &numReads,
-                                     int &numWrites
-                                    )
+namespace
 {
+  /* Forward difference of the face fluxes, for all variables at once:
+   * divFluxes[i] = (F1[i+1] - F1[i])/dX1 + (F2[j+1] - F2[j])/dX2 + ...
+   *
+   * in = {fluxesX1[0], fluxesX2[0], fluxesX3[0], fluxesX1[1], ...}, with
+   * only the first dim fluxes per variable, out = {divFluxes[0], ...} */
+  template <typename config>
+  struct divFluxKernel
+  {
+    static const int numInputs  = config::dim*config::dof;
+    static const int numOutputs = config::dof;
+
+    double dX1, dX2, dX3;
+
+    template <typename field, typename T>
+    void operator()(const field in[], T out[]) const
+    {
+      const int dim = config::dim;
+      for (int var=0; var < config::dof; var++)
+      {
+        const field &fluxX1 = in[dim*var];
+        out[var] = (fluxX1(1, 0, 0) - fluxX1(0, 0, 0))/dX1;
+
+        if (dim >= 2)
+        {
+          const field &fluxX2 = in[dim*var + 1];
+          out[var] += (fluxX2(0, 1, 0) - fluxX2(0, 0, 0))/dX2;
+        }
+        if (dim == 3)
+        {
+          const field &fluxX3 = in[dim*var + 2];
+          out[var] += (fluxX3(0, 0, 1) - fluxX3(0, 0, 0))/dX3;
+        }
+      }
+    }
+  };
+
+  typedef void (*divFluxLauncher)(const grid * const fluxes[],
+                                  const double dX[3],
+                                  grid &divFluxes
+                                 );
+
+  template <typename config>
+  void applyDivFluxKernel(const grid * const fluxes[], const double dX[3],
+                          grid &divFluxes
+                         )
+  {
+    divFluxKernel<config> kernel;
+    kernel.dX1 = dX[0];
+    kernel.dX2 = dX[1];
+    kernel.dX3 = dX[2];
+
+    const af::array *in[divFluxKernel<config>::numInputs];
+    af::array *out[divFluxKernel<config>::numOutputs];
+    for (int var=0; var < config::dof; var++)
+    {
+      for (int d=0; d < config::dim; d++)
+      {
+        in[config::dim*var + d] = &fluxes[d]->vars[var];
+      }
+      out[var] = &divFluxes.vars[var];
+    }
+    stencil::apply(kernel, 1, in, out);
+  }
+
+  /* The counts of the kernel come from the physicsConfig of the params */
+  template <typename config> struct divFluxKernelTable
+  {
+    static divFluxLauncher get()
+    {
+      return &applyDivFluxKernel<config>;
+    }
+  };
+}
+
+#ifdef GRIM_NATIVE_KERNELS
+namespace
+{
+  /* Ideal MHD. The dimension is not used by the zone-level kernels */
+  typedef physicsConfig<3, false, false, false, false> idealMHD;
+
+  /* Fast path of the native backend for ideal MHD only. Flux on the face
+   * i-1/2 of every zone, computed in one pass without any intermediate grid:
+   * reconstruction of both face states from the prims around the face, fluid
+   * element, fluxes and conserved variables of both states, char speeds and
+   * the HLL/LLF combination. The face fluxes are still stored, since fluxCT
+   * and the problem-specific flux filter need them before the divergence.
+   * It gives the same fluxes as the staged path (reconstruction::
+   * reconstructFaces() and riemannSolver::solve()), which
+   * timestepper/test_fusedFluxes.py checks.
+   *
+   * in = {prim[0..dof-1],
+   *       alpha, g, gCov[0][0], gCov[0][1], ..., gCov[3][3],
+   *       gCon[0][0], ..., gCon[0][3], gCon[dir+1][dir+1]}
+   *
+   * The geometry is that of the faces i-1/2. The state left of the face
+   * comes from zone i-1 and its geometry is read at leftGeomOffset along
+   * dir: 0 for face-centered geometries (the face i+1/2 of zone i-1 is the
+   * face i-1/2 of zone i) and -1 when the zone-centered geometry is used on
+   * both sides, as for X3. */
+  struct faceFluxKernel
+  {
+    static const int numInputs  = idealMHD::dof + 2 + NDIM*NDIM + NDIM + 1;
+    static const int numOutputs = idealMHD::dof;
+
+    int dir;
+    int leftGeomOffset;
+
+    template <typename field>
+    void loadMetric(const field metric[], const int offset,
+                    double &alpha, double &g,
+                    double gCov[NDIM][NDIM], double gCon0[NDIM],
+                    double &gConDirDir
+                   ) const
+    {
+      alpha = metric[0].at(dir, offset);
+      g     = metric[1].at(dir, offset);
+      for (int mu=0; mu<NDIM; mu++)
+      {
+        for (int nu=0; nu<NDIM; nu++)
+        {
+          gCov[mu][nu] = metric[2 + NDIM*mu + nu].at(dir, offset);
+        }
+        gCon0[mu] = metric[2 + NDIM*NDIM + mu].at(dir, offset);
+      }
+      gConDirDir = metric[2 + NDIM*NDIM + NDIM].at(dir, offset);
+    }
+
+    void charSpeeds(const native::zoneState &s,
+                    const double gCon0[NDIM], const double gConDirDir,
+                    double &minSpeed, double &maxSpeed
+                   ) const
+    {
+      const int sdir = dir + 1;
+      const double gamma = params::adiabaticIndex;
+
+      const double enthalpy  = s.rho + gamma*s.u;
+      const double cAlvenSqr = s.bSqr/(enthalpy + s.bSqr);
+      double csSqr = s.soundSpeed*s.soundSpeed;
+      csSqr = std::min(csSqr + cAlvenSqr - csSqr*cAlvenSqr, 1.);
+
+      native::charSpeeds(csSqr,
+                         gConDirDir, gCon0[0],
+                         s.uCon[sdir], s.uCon[0],
+                         gCon0[sdir],
+                         minSpeed, maxSpeed
+                        );
+    }
+
+    template <typename field>
+    void operator()(const field in[], double out[]) const
+    {
+      const int sdir = dir + 1;
+      const field *prim   = in;
+      const field *metric = in + idealMHD::dof;
+
+      /* primFaceLeft : right face of zone i-1
+       * primFaceRight: left face of zone i */
+      double primFaceLeft[idealMHD::dof], primFaceRight[idealMHD::dof];
+      for (int var=0; var<idealMHD::dof; var++)
+      {
+        double y[6];
+        for (int offset=-3; offset<=2; offset++)
+        {
+          y[offset + 3] = prim[var].at(dir, offset);
+        }
+
+        double unused;
+        reconstruction::faceValues<double>(y[0], y[1], y[2], y[3], y[4],
+                                           unused, primFaceLeft[var]
+                                          );
+        reconstruction::faceValues<double>(y[1], y[2], y[3], y[4], y[5],
+                                           primFaceRight[var], unused
+                                          );
+      }
+
+      double alpha, g, gCov[NDIM][NDIM], gCon0[NDIM], gConDirDir;
+      native::zoneState stateLeft, stateRight;
+      double fluxLeft[idealMHD::dof],  consLeft[idealMHD::dof];
+      double fluxRight[idealMHD::dof], consRight[idealMHD::dof];
+      double minSpeedLeft,  maxSpeedLeft;
+      double minSpeedRight, maxSpeedRight;
+
+      loadMetric(metric, leftGeomOffset, alpha, g, gCov, gCon0, gConDirDir);
+      native::setZone<idealMHD>(primFaceLeft, alpha, gCov, gCon0, stateLeft);
+      native::zoneFluxes<idealMHD>(sdir, g, stateLeft, fluxLeft);
+      native::zoneFluxes<idealMHD>(0,    g, stateLeft, consLeft);
+      charSpeeds(stateLeft, gCon0, gConDirDir, minSpeedLeft, maxSpeedLeft);
+
+      loadMetric(metric, 0, alpha, g, gCov, gCon0, gConDirDir);
+      native::setZone<idealMHD>(primFaceRight, alpha, gCov, gCon0, stateRight);
+      native::zoneFluxes<idealMHD>(sdir, g, stateRight, fluxRight);
+      native::zoneFluxes<idealMHD>(0,    g, stateRight, consRight);
+      charSpeeds(stateRight, gCon0, gConDirDir, minSpeedRight, maxSpeedRight);
+
+      const double minSpeed = std::min(minSpeedLeft, minSpeedRight);
+      const double maxSpeed = std::max(maxSpeedLeft, maxSpeedRight);
+
+      for (int var=0; var<idealMHD::dof; var++)
+      {
+        if (params::riemannSolver == riemannSolvers::HLL)
+        {
+          out[var] =
+            (   maxSpeed * fluxLeft[var]
+              - minSpeed * fluxRight[var]
+              + minSpeed * maxSpeed * (consRight[var] - consLeft[var])
+            )/(maxSpeed - minSpeed);
+        }
+        else if (params::riemannSolver == riemannSolvers::LOCAL_LAX_FRIEDRICH)
+        {
+          out[var] =
+           0.5*(  fluxLeft[var] + fluxRight[var]
+                - std::max(maxSpeed, -minSpeed)*(consRight[var] - consLeft[var])
+               );
+        }
+      }
+    }
+  };
+}
+#endif /* GRIM_NATIVE_KERNELS */
+
+bool timeStepper::hasFusedFaceFluxes() const
+{
+#ifdef GRIM_NATIVE_KERNELS
+  return (!params::conduction && !params::viscosity);
+#else
+  return false;
+#endif
+}
+
+/* Fluxes on the faces i-1/2 along dir. geomFaceLeft and geomFaceRight are
+ * the geometries on the faces i-1/2 and i+1/2 of every zone, and geomFaces
+ * both of them stacked, as passed to riemannFaces.solve(). primFluxSoA
+ * is primFlux.getVarsSoA(), gathered once for all directions. */
+void timeStepper::computeFaceFluxes(const grid &primFlux,
+                                    const array &primFluxSoA,
+                                    const int dir,
+                                    geometry &geomFaceLeft,
+                                    geometry &geomFaceRight,
+                                    geometry &geomFaces,
+                                    riemannSolver &riemannFaces,
+                                    grid &flux,
+                                    int &numReads,
+                                    int &numWrites
+                                   )
+{
+#ifdef GRIM_NATIVE_KERNELS
+  /* Single fused pass for ideal MHD. The EMHD terms need the closure
+   * quantities of the fluidElement and go through the staged path below. */
+  if (fuseFaceFluxes && hasFusedFaceFluxes())
+  {
+    faceFluxKernel kernel;
+    kernel.dir            = dir;
+    kernel.leftGeomOffset = (&geomFaceLeft == &geomFaceRight ? -1 : 0);
+
+    const af::array *in[faceFluxKernel::numInputs];
+    af::array *out[faceFluxKernel::numOutputs];
+    int numIn = 0;
+    for (int var=0; var<idealMHD::dof; var++)
+    {
+      in[numIn++] = &primFlux.vars[var];
+      out[var]    = &flux.vars[var];
+    }
+    in[numIn++] = &geomFaceLeft.alpha;
+    in[numIn++] = &geomFaceLeft.g;
+    for (int mu=0; mu<NDIM; mu++)
+    {
+      for (int nu=0; nu<NDIM; nu++)
+      {
+        in[numIn++] = &geomFaceLeft.gCov[mu][nu];
+      }
+    }
+    for (int mu=0; mu<NDIM; mu++)
+    {
+      in[numIn++] = &geomFaceLeft.gCon[0][mu];
+    }
+    in[numIn++] = &geomFaceLeft.gCon[dir+1][dir+1];
+
+    stencil::apply(kernel, 3, in, out);
+    /* Reads:
+     * -----
+     *  prim[var] : dof
+     *  alpha, g, gCov, gCon : 23
+     *
+     * Writes:
+     * ------
+     * flux[var] : dof */
+    numReads  = numIn;
+    numWrites = idealMHD::dof;
+
+    return;
+  }
+#endif
+
   int numReadsReconstruction, numWritesReconstruction;
   int numReadsRiemann, numWritesRiemann;
-  int numReadsCT, numWritesCT;
 
-  switch (primFlux.dim)
-  {
-    case 1:
-    /* Reconstruction gives, at a point of index i:
-     * primLeft : right-biased stencil reconstructs on face i-/1.2
-     * primRight: left-biased stencil reconstructs on face i+1/2 */
-      reconstruction::reconstruct(primFlux, directions::X1,
-                                  *primLeft, *primRight,
-                                  numReadsReconstruction,
-                                  numWritesReconstruction
-                                 );
-      numReads  = numReadsReconstruction;
-      numWrites = numWritesReconstruction;
+  /* Reconstruction gives, at a point of index i, for every var:
+   * primFacesSoA[2*var]  : right-biased stencil reconstructs on face i-1/2
+   * primFacesSoA[2*var+1]: left-biased stencil reconstructs on face i+1/2 */
+  array primFacesSoA;
+  reconstruction::reconstructFaces(primFluxSoA, dir, primFacesSoA,
+                                   numReadsReconstruction,
+                                   numWritesReconstruction
+                                  );
 
-      riemann->solve(*primLeft, *primRight,
-                     *geomLeft, *geomRight,
-                     directions::X1, *fluxesX1,
+  riemannFaces.solve(primFacesSoA, geomFaces,
+                     dir, flux,
                      numReadsRiemann, numWritesRiemann
                     );
-      numReads  += numReadsRiemann;
-      numWrites += numWritesRiemann;
 
-      applyProblemSpecificFluxFilter(numReads,numWrites);
+  numReads  = numReadsReconstruction  + numReadsRiemann;
+  numWrites = numWritesReconstruction + numWritesRiemann;
+}
 
-      for (int var=0; var < primFlux.numVars; var++)
-      {
-        double filter1D[] = {1, -1, 0}; /* Forward difference */
-    
-        array filterX1 = array(3, 1, 1, 1, filter1D)/(XCoords->dX1);
+void timeStepper::computeDivOfFluxes(const grid &primFlux,
+                                     int &numReads,
+                                     int &numWrites
+                                    )
+{
+  int numReadsFaceFluxes, numWritesFaceFluxes;
+  int numReadsCT, numWritesCT;
+  const int wholeGrid[3] = {0, 0, 0};
 
-        array dFluxX1_dX1 = convolve(fluxesX1->vars[var], filterX1);
+  /* The variables are stacked once for the batched reconstruction in every
+   * direction. The fused ideal MHD path of the native backend reads
+   * primFlux.vars directly and does not need them. */
+  numReads = 0; numWrites = 0;
+  array primFluxSoA;
+  if (!(fuseFaceFluxes && hasFusedFaceFluxes()))
+  {
+    primFluxSoA = primFlux.getVarsSoA();
+    numReads  += primFlux.numVars;
+    numWrites += primFlux.numVars;
+  }
 
-        divFluxes->vars[var] = dFluxX1_dX1;
-        divFluxes->vars[var].eval();
-      }
+  const int tileDirN = (primFlux.dim == 3 ? primFlux.N3Local
+                                          : primFlux.N2Local
+                       );
+  if (   primFlux.dim >= 2 && fluxTileRows > 0
+      && std::max(fluxTileRows, numGhost) < tileDirN
+     )
+  {
+    computeDivOfFluxesInTiles(primFlux, primFluxSoA, numReads, numWrites);
+    return;
+  }
 
+  switch (primFlux.dim)
+  {
+    case 1:
+      computeFaceFluxes(primFlux, primFluxSoA, directions::X1,
+                        *geomLeft, *geomRight, *geomFacesX1,
+                        *riemann,
+                        *fluxesX1,
+                        numReadsFaceFluxes, numWritesFaceFluxes
+                       );
+      numReads  += numReadsFaceFluxes;
+      numWrites += numWritesFaceFluxes;
+
+      applyProblemSpecificFluxFilter(*fluxesX1, *fluxesX2, *fluxesX3,
+                                     wholeGrid, numReads, numWrites
+                                    );
       break;
 
     case 2:
 
       /* directions:: X1 */
-      reconstruction::reconstruct(primFlux, directions::X1,
-                                  *primLeft, *primRight,
-                                  numReadsReconstruction,
-                                  numWritesReconstruction
-                                 );
-      numReads  = numReadsReconstruction;
-      numWrites = numWritesReconstruction;
-
-      riemann->solve(*primLeft, *primRight,
-                     *geomLeft, *geomRight,
-                     directions::X1, *fluxesX1,
-                     numReadsRiemann, numWritesRiemann
-                    );
-      numReads  += numReadsRiemann;
-      numWrites += numWritesRiemann;
+      computeFaceFluxes(primFlux, primFluxSoA, directions::X1,
+                        *geomLeft, *geomRight, *geomFacesX1,
+                        *riemann,
+                        *fluxesX1,
+                        numReadsFaceFluxes, numWritesFaceFluxes
+                       );
+      numReads  += numReadsFaceFluxes;
+      numWrites += numWritesFaceFluxes;
 
       /* directions:: X2 */
-      reconstruction::reconstruct(primFlux, directions::X2,
-                                  *primLeft, *primRight,
-                                  numReadsReconstruction,
-                                  numWritesReconstruction
-                                 );
-      numReads  += numReadsReconstruction;
-      numWrites += numWritesReconstruction;
-
-      riemann->solve(*primLeft,   *primRight,
-                     *geomBottom, *geomTop,
-                     directions::X2, *fluxesX2,
-                     numReadsRiemann, numWritesRiemann
-                    );
-      numReads  += numReadsRiemann;
-      numWrites += numWritesRiemann;
+      computeFaceFluxes(primFlux, primFluxSoA, directions::X2,
+                        *geomBottom, *geomTop, *geomFacesX2,
+                        *riemann,
+                        *fluxesX2,
+                        numReadsFaceFluxes, numWritesFaceFluxes
+                       );
+      numReads  += numReadsFaceFluxes;
+      numWrites += numWritesFaceFluxes;
 
       fluxCT(numReadsCT, numWritesCT);
       numReads  += numReadsCT;
       numWrites += numWritesCT;
 
-      applyProblemSpecificFluxFilter(numReads,numWrites);
-
-      for (int var=0; var < primFlux.numVars; var++)
-      {
-        double filter1D[] = {1, -1, 0}; /* Forward difference */
-    
-        array filterX1 = array(3, 1, 1, 1, filter1D)/(XCoords->dX1);
-        array filterX2 = array(1, 3, 1, 1, filter1D)/(XCoords->dX2);
-
-        array dFluxX1_dX1 = convolve(fluxesX1->vars[var], filterX1);
-        array dFluxX2_dX2 = convolve(fluxesX2->vars[var], filterX2);
-        
-        divFluxes->vars[var] = dFluxX1_dX1 + dFluxX2_dX2;
-        divFluxes->vars[var].eval();
-      }
-
+      applyProblemSpecificFluxFilter(*fluxesX1, *fluxesX2, *fluxesX3,
+                                     wholeGrid, numReads, numWrites
+                                    );
       break;
 
     case 3:
       /* directions:: X1 */
-      reconstruction::reconstruct(primFlux, directions::X1,
-                                  *primLeft, *primRight,
-                                  numReadsReconstruction,
-                                  numWritesReconstruction
-                                 );
-      numReads  = numReadsReconstruction;
-      numWrites = numWritesReconstruction;
-
-      riemann->solve(*primLeft, *primRight,
-                     *geomLeft, *geomRight,
-                     directions::X1, *fluxesX1,
-                     numReadsRiemann, numWritesRiemann
-                    );
-      numReads  += numReadsRiemann;
-      numWrites += numWritesRiemann;
+      computeFaceFluxes(primFlux, primFluxSoA, directions::X1,
+                        *geomLeft, *geomRight, *geomFacesX1,
+                        *riemann,
+                        *fluxesX1,
+                        numReadsFaceFluxes, numWritesFaceFluxes
+                       );
+      numReads  += numReadsFaceFluxes;
+      numWrites += numWritesFaceFluxes;
 
       /* directions:: X2 */
-      reconstruction::reconstruct(primFlux, directions::X2,
-                                  *primLeft, *primRight,
-                                  numReadsReconstruction,
-                                  numWritesReconstruction
-                                 );
-      numReads  += numReadsReconstruction;
-      numWrites += numWritesReconstruction;
-
-      riemann->solve(*primLeft,   *primRight,
-                     *geomBottom, *geomTop,
-                     directions::X2, *fluxesX2,
-                     numReadsRiemann, numWritesRiemann
-                    );
-      numReads  += numReadsRiemann;
-      numWrites += numWritesRiemann;
+      computeFaceFluxes(primFlux, primFluxSoA, directions::X2,
+                        *geomBottom, *geomTop, *geomFacesX2,
+                        *riemann,
+                        *fluxesX2,
+                        numReadsFaceFluxes, numWritesFaceFluxes
+                       );
+      numReads  += numReadsFaceFluxes;
+      numWrites += numWritesFaceFluxes;
 
       /* directions:: X3 */
-      reconstruction::reconstruct(primFlux, directions::X3,
-                                  *primLeft, *primRight,
-                                  numReadsReconstruction,
-                                  numWritesReconstruction
-                                 );
-      numReads  += numReadsReconstruction;
-      numWrites += numWritesReconstruction;
-
-      riemann->solve(*primLeft,   *primRight,
-                     *geomCenter, *geomCenter,
-                     directions::X3, *fluxesX3,
-                     numReadsRiemann, numWritesRiemann
-                    );
-      numReads  += numReadsRiemann;
-      numWrites += numWritesRiemann;
+      computeFaceFluxes(primFlux, primFluxSoA, directions::X3,
+                        *geomCenter, *geomCenter, *geomFacesX3,
+                        *riemann,
+                        *fluxesX3,
+                        numReadsFaceFluxes, numWritesFaceFluxes
+                       );
+      numReads  += numReadsFaceFluxes;
+      numWrites += numWritesFaceFluxes;
 
       fluxCT(numReadsCT, numWritesCT);
       numReads  += numReadsCT;
       numWrites += numWritesCT;
 
-      applyProblemSpecificFluxFilter(numReads,numWrites);
+      applyProblemSpecificFluxFilter(*fluxesX1, *fluxesX2, *fluxesX3,
+                                     wholeGrid, numReads, numWrites
+                                    );
+      break;
+  }
 
-      for (int var=0; var < primFlux.numVars; var++)
-      {
-        double filter1D[] = {1, -1, 0}; /* Forward difference */
-    
-        array filterX1 = array(3, 1, 1, 1, filter1D)/(XCoords->dX1);
-        array filterX2 = array(1, 3, 1, 1, filter1D)/(XCoords->dX2);
-        array filterX3 = array(1, 1, 3, 1, filter1D)/(XCoords->dX3);
-
-        array dFluxX1_dX1 = convolve(fluxesX1->vars[var], filterX1);
-        array dFluxX2_dX2 = convolve(fluxesX2->vars[var], filterX2);
-        array dFluxX3_dX3 = convolve(fluxesX3->vars[var], filterX3);
-
-        divFluxes->vars[var] = dFluxX1_dX1 + dFluxX2_dX2 + dFluxX3_dX3;
-        divFluxes->vars[var].eval();
-      }
+  const grid *fluxes[] = {fluxesX1, fluxesX2, fluxesX3};
+  const double dX[] = {XCoords->dX1, XCoords->dX2, XCoords->dX3};
+  selectPhysicsConfig<divFluxLauncher, divFluxKernelTable>()(fluxes, dX,
+                                                             *divFluxes
+                                                            );
+  /* Reads:
+   * -----
+   *  fluxesX1[var], fluxesX2[var], fluxesX3[var] : dim*numVars
+   *
+   * Writes:
+   * ------
+   * divFluxes[var] : numVars */
+  numReads  += primFlux.dim*primFlux.numVars;
+  numWrites += primFlux.numVars;
+}
 
-      break;
+/* Slab of the tiles: the zones first <= n <= last of the arrays of the grid
+ * along dir, with tileRows interior zones and numGhost on either side */
+void timeStepper::viewFluxTile(const int dir, const int first, const int last)
+{
+  tileGeomFacesX1->viewRows(*geomFacesX1, dir, first, last);
+  tileGeomLeft->viewFace(*tileGeomFacesX1, 0);
+  tileGeomRight->viewFace(*tileGeomFacesX1, 1);
+
+  tileGeomFacesX2->viewRows(*geomFacesX2, dir, first, last);
+  tileGeomBottom->viewFace(*tileGeomFacesX2, 0);
+  tileGeomTop->viewFace(*tileGeomFacesX2, 1);
+
+  if (dim == 3)
+  {
+    tileGeomFacesX3->viewRows(*geomFacesX3, dir, first, last);
+    tileGeomCenter->viewFace(*tileGeomFacesX3, 0);
+  }
+}
+
+void timeStepper::buildFluxTiles(const int rows)
+{
+  deleteFluxTiles();
+  tileRows = rows;
+
+  const int tileN1 = divFluxes->N1Local;
+  const int tileN2 = (dim == 2 ? rows : divFluxes->N2Local);
+  const int tileN3 = (dim == 2 ? 1    : rows);
+
+  tilePrim      = new grid(tileN1, tileN2, tileN3,
+                           dim, numVars, numGhost,
+                           false, false, false, PETSC_COMM_SELF
+                          );
+  tileDivFluxes = new grid(tileN1, tileN2, tileN3,
+                           dim, numVars, numGhost,
+                           false, false, false, PETSC_COMM_SELF
+                          );
+  tileFluxesX1  = new grid(tileN1, tileN2, tileN3,
+                           dim, numVars, numGhost,
+                           false, false, false, PETSC_COMM_SELF
+                          );
+  tileFluxesX2  = new grid(tileN1, tileN2, tileN3,
+                           dim, numVars, numGhost,
+                           false, false, false, PETSC_COMM_SELF
+                          );
+  tileFluxesX3  = new grid(tileN1, tileN2, tileN3,
+                           dim, numVars, numGhost,
+                           false, false, false, PETSC_COMM_SELF
+                          );
+  tileEmfX1     = new grid(tileN1, tileN2, tileN3,
+                           dim, 1, numGhost,
+                           false, false, false, PETSC_COMM_SELF
+                          );
+  tileEmfX2     = new grid(tileN1, tileN2, tileN3,
+                           dim, 1, numGhost,
+                           false, false, false, PETSC_COMM_SELF
+                          );
+  tileEmfX3     = new grid(tileN1, tileN2, tileN3,
+                           dim, 1, numGhost,
+                           false, false, false, PETSC_COMM_SELF
+                          );
+
+  tileGeomFacesX1 = new geometry();
+  tileGeomLeft    = new geometry();
+  tileGeomRight   = new geometry();
+  tileGeomFacesX2 = new geometry();
+  tileGeomBottom  = new geometry();
+  tileGeomTop     = new geometry();
+  if (dim == 3)
+  {
+    tileGeomFacesX3 = new geometry();
+    tileGeomCenter  = new geometry();
   }
+
+  const int dir = (dim == 2 ? directions::X2 : directions::X3);
+  viewFluxTile(dir, 0, rows + 2*numGhost - 1);
+  tileRiemann = new riemannSolver(*tilePrim, *tileGeomLeft);
+}
+
+void timeStepper::deleteFluxTiles()
+{
+  delete tilePrim;
+  delete tileDivFluxes;
+  delete tileFluxesX1;
+  delete tileFluxesX2;
+  delete tileFluxesX3;
+  delete tileEmfX1;
+  delete tileEmfX2;
+  delete tileEmfX3;
+  delete tileRiemann;
+  delete tileGeomLeft;
+  delete tileGeomRight;
+  delete tileGeomBottom;
+  delete tileGeomTop;
+  delete tileGeomCenter;
+  delete tileGeomFacesX1;
+  delete tileGeomFacesX2;
+  delete tileGeomFacesX3;
+
+  tilePrim     = tileDivFluxes = NULL;
+  tileFluxesX1 = tileFluxesX2 = tileFluxesX3 = NULL;
+  tileEmfX1    = tileEmfX2    = tileEmfX3    = NULL;
+  tileGeomFacesX1 = tileGeomFacesX2 = tileGeomFacesX3 = NULL;
+  tileGeomLeft    = tileGeomRight   = NULL;
+  tileGeomBottom  = tileGeomTop     = NULL;
+  tileGeomCenter  = NULL;
+  tileRiemann     = NULL;
+  tileRows        = 0;
 }
 
+/* computeDivOfFluxes() one slab of the grid at a time along the outermost
+ * direction. The fluxes on the faces of the interior zones of a slab only
+ * depend on the prims within numGhost zones of them, and fluxCT on the
+ * fluxes within one zone, so every slab holds numGhost zones of the
+ * neighbouring ones on either side: the fluxes on the faces between two
+ * tiles are computed, filtered and corrected by fluxCT in both, with the
+ * same result. Its interior zones are then copied into divFluxes. */
+void timeStepper::computeDivOfFluxesInTiles(const grid &primFlux,
+                                            const array &primFluxSoA,
+                                            int &numReads,
+                                            int &numWrites
+                                           )
+{
+  const int dir    = (primFlux.dim == 2 ? directions::X2 : directions::X3);
+  const int NLocal = (primFlux.dim == 2 ? primFlux.N2Local
+                                        : primFlux.N3Local
+                     );
+  const int rows   = std::max(fluxTileRows, numGhost);
+  if (rows != tileRows)
+  {
+    buildFluxTiles(rows);
+  }
+
+  const grid *fluxes[] = {tileFluxesX1, tileFluxesX2, tileFluxesX3};
+  const double dX[] = {XCoords->dX1, XCoords->dX2, XCoords->dX3};
+  const divFluxLauncher applyDivFlux
+    = selectPhysicsConfig<divFluxLauncher, divFluxKernelTable>();
+
+  /* Every tile reads and writes a part of the arrays: the counts of the
+   * whole grid are those of one tile */
+  int numReadsTile = 0, numWritesTile = 0;
+  const int numTiles = (NLocal + rows - 1)/rows;
+  for (int tile=0; tile < numTiles; tile++)
+  {
+    /* The last tile ends at the last interior zone, and overlaps the one
+     * before it when rows does not divide NLocal */
+    const int first = std::min(tile*rows, NLocal - rows);
+    const int last  = first + rows + 2*numGhost - 1;
+
+    for (int var=0; var < primFlux.numVars; var++)
+    {
+      tilePrim->vars[var] = stencil::rows(primFlux.vars[var], dir, first, last);
+    }
+    array tilePrimSoA;
+    if (!primFluxSoA.isempty())
+    {
+      tilePrimSoA = stencil::rows(primFluxSoA, dir, first, last);
+    }
+    viewFluxTile(dir, first, last);
+
+    numReadsTile = 0; numWritesTile = 0;
+    int numReadsFaceFluxes, numWritesFaceFluxes;
+
+    /* directions:: X1 */
+    computeFaceFluxes(*tilePrim, tilePrimSoA, directions::X1,
+                      *tileGeomLeft, *tileGeomRight, *tileGeomFacesX1,
+                      *tileRiemann,
+                      *tileFluxesX1,
+                      numReadsFaceFluxes, numWritesFaceFluxes
+                     );
+    numReadsTile  += numReadsFaceFluxes;
+    numWritesTile += numWritesFaceFluxes;
+
+    /* directions:: X2 */
+    computeFaceFluxes(*tilePrim, tilePrimSoA, directions::X2,
+                      *tileGeomBottom, *tileGeomTop, *tileGeomFacesX2,
+                      *tileRiemann,
+                      *tileFluxesX2,
+                      numReadsFaceFluxes, numWritesFaceFluxes
+                     );
+    numReadsTile  += numReadsFaceFluxes;
+    numWritesTile += numWritesFaceFluxes;
+
+    if (primFlux.dim == 3)
+    {
+      /* directions:: X3 */
+      computeFaceFluxes(*tilePrim, tilePrimSoA, directions::X3,
+                        *tileGeomCenter, *tileGeomCenter, *tileGeomFacesX3,
+                        *tileRiemann,
+                        *tileFluxesX3,
+                        numReadsFaceFluxes, numWritesFaceFluxes
+                       );
+      numReadsTile  += numReadsFaceFluxes;
+      numWritesTile += numWritesFaceFluxes;
+    }
+
+    int numReadsCT, numWritesCT;
+    fluxCT(*tileFluxesX1, *tileFluxesX2, *tileFluxesX3,
+           *tileEmfX1, *tileEmfX2, *tileEmfX3,
+           numReadsCT, numWritesCT
+          );
+    numReadsTile  += numReadsCT;
+    numWritesTile += numWritesCT;
+
+    const int tileOffset[3] = {0,
+                               (dir == directions::X2 ? first : 0),
+                               (dir == directions::X3 ? first : 0)
+                              };
+    applyProblemSpecificFluxFilter(*tileFluxesX1, *tileFluxesX2,
+                                   *tileFluxesX3, tileOffset,
+                                   numReadsTile, numWritesTile
+                                  );
+
+    applyDivFlux(fluxes, dX, *tileDivFluxes);
+
+    const af::seq kept(first + numGhost, first + numGhost + rows - 1);
+    const af::seq keptX2 = (dir == directions::X2 ? kept : af::seq(span));
+    const af::seq keptX3 = (dir == directions::X3 ? kept : af::seq(span));
+    for (int var=0; var < primFlux.numVars; var++)
+    {
+      divFluxes->vars[var](span, keptX2, keptX3)
+        = stencil::rows(tileDivFluxes->vars[var], dir,
+                        numGhost, numGhost + rows - 1
+                       );
+    }
+  }
+  /* Reads:
+   * -----
+   *  fluxesX1[var], fluxesX2[var], fluxesX3[var] : dim*numVars
+   *  tileDivFluxes[var] : numVars
+   *
+   * Writes:
+   * ------
+   * tileDivFluxes[var], divFluxes[var] : 2*numVars */
+  numReads  += numReadsTile  + (primFlux.dim + 1)*primFlux.numVars;
+  numWrites += numWritesTile + 2*primFlux.numVars;
+}
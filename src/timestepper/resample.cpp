@@ -0,0 +1,302 @@
+#include "timestepper.hpp"
+#include "../grid/dumpwriter.hpp"
+#include <random>
+#include <algorithm>
+#include <cstdio>
+
+namespace
+{
+  /* Vector potential A3 at the corners of one X1-X2 plane of a file, from
+   * its densities g*B1, g*B2 (N1 x N2 zones, X1 the fastest) and such that
+   * g*B1 = dA3/dX2 and g*B2 = -dA3/dX1. A3 is integrated along X1 at the
+   * bottom from A3 = 0 at the first corner, and then up every column of
+   * corners along X2, through the mean of the zones on either side. A holds
+   * (N1 + 1) x (N2 + 1) corners */
+  void vectorPotential(const std::vector<double> &gB1,
+                       const std::vector<double> &gB2,
+                       const int N1, const int N2,
+                       const double dX1, const double dX2,
+                       std::vector<double> &A
+                      )
+  {
+    const int corners1 = N1 + 1;
+    A.assign((size_t)corners1*(N2 + 1), 0.);
+
+    for (int i=0; i<N1; i++)
+    {
+      A[i + 1] = A[i] - dX1*gB2[i];
+    }
+
+    for (int j=0; j<N2; j++)
+    {
+      for (int i=0; i<corners1; i++)
+      {
+        const int left  = std::max(i - 1, 0);
+        const int right = std::min(i, N1 - 1);
+        const double flux = 0.5*(gB1[left + N1*j] + gB1[right + N1*j]);
+
+        A[i + corners1*(j + 1)] = A[i + corners1*j] + dX2*flux;
+      }
+    }
+  }
+
+  /* Position of corner i of a grid of targetN zones in the corners of a
+   * grid of sourceN zones over the same extent: between corners first and
+   * first + 1, at weight from first */
+  void cornerWeight(const int i, const int targetN, const int sourceN,
+                    int &first, double &weight
+                   )
+  {
+    const double position = (double)i*sourceN/targetN;
+    first  = std::min((int)std::floor(position), sourceN - 1);
+    weight = position - first;
+  }
+}
+
+void timeStepper::loadPrimitives(const std::string fileName)
+{
+  int fileN[3];
+  const int fileDim = dumpWriter::fileDim("primitives", fileName, fileN);
+  primOld->load("primitives", fileName);
+
+  if (   fileDim > 0
+      && (fileN[0] != N1 || fileN[1] != N2 || fileN[2] != N3)
+     )
+  {
+    resampleConserved(fileName, fileDim, fileN);
+  }
+
+  /* The internal energy of an extruded file is given a non-axisymmetric
+   * perturbation: the lowest azimuthal modes, with phases drawn from
+   * params::extrusionSeed, so that it does not depend on the
+   * decomposition */
+  if (dim == 3 && fileDim == 2 && params::extrusionPerturbation > 0.)
+  {
+    PetscPrintf(PETSC_COMM_WORLD,
+                " Extruded 2D file %s, perturbing u by %g\n\n",
+                fileName.c_str(), params::extrusionPerturbation
+               );
+
+    const int numModes = 8;
+    std::mt19937 generator(params::extrusionSeed);
+    std::uniform_real_distribution<double> phase(0., 2.*M_PI);
+
+    array k = af::range(primOld->N1Total, primOld->N2Total,
+                        primOld->N3Total, 1, directions::X3, f64
+                       ) - primOld->numGhostX3 + primOld->kLocalStart;
+    array angle = 2.*M_PI*(k + 0.5)/primOld->N3;
+    array perturbation = 0.*angle;
+    for (int m=1; m<=numModes; m++)
+    {
+      perturbation += af::sin(m*angle + phase(generator))/numModes;
+    }
+    primOld->vars[vars::U] *= 1. + params::extrusionPerturbation*perturbation;
+    primOld->vars[vars::U].eval();
+  }
+}
+
+void timeStepper::resampleConserved(const std::string fileName,
+                                    const int fileDim, const int fileN[3]
+                                   )
+{
+  PetscPrintf(PETSC_COMM_WORLD,
+              " Resampling the conserved variables of %s\n", fileName.c_str()
+             );
+
+  /* 1) Conserved variables at the resolution of the file, written to a
+   * scratch file and read back onto the grid by the conservative
+   * resampling of grid::load() */
+  const std::string consFileName = "resampledConserved.h5";
+  {
+    coordinatesGrid fileXCoords(fileN[0], fileN[1], fileN[2],
+                                fileDim, numGhost,
+                                XCoords->X1Start, XCoords->X1End,
+                                XCoords->X2Start, XCoords->X2End,
+                                XCoords->X3Start, XCoords->X3End
+                               );
+    fileXCoords.setXCoords(locations::CENTER);
+    geometry fileGeom(geomCenter->metric,
+                      geomCenter->blackHoleSpin,
+                      geomCenter->hSlope,
+                      fileXCoords
+                     );
+
+    grid filePrim(fileN[0], fileN[1], fileN[2],
+                  fileDim, numVars, numGhost,
+                  primOld->periodicBoundariesX1,
+                  primOld->periodicBoundariesX2,
+                  primOld->periodicBoundariesX3
+                 );
+    grid fileCons(fileN[0], fileN[1], fileN[2],
+                  fileDim, numVars, numGhost,
+                  primOld->periodicBoundariesX1,
+                  primOld->periodicBoundariesX2,
+                  primOld->periodicBoundariesX3
+                 );
+    filePrim.load("primitives", fileName);
+
+    int numReads, numWrites;
+    fluidElement fileElem(filePrim, fileGeom, numReads, numWrites);
+    fileElem.computeFluxes(0, fileCons, numReads, numWrites);
+    fileCons.dump("conserved", consFileName);
+  }
+  consOld->load("conserved", consFileName);
+
+  /* 2) B1, B2 from the vector potential of the file, interpolated
+   * bilinearly to the corners of the grid and linearly in X3 between the
+   * planes of the file (or averaged over them onto a 2D grid). B3 does not
+   * enter the divergence and keeps its conservative resampling. So do B1,
+   * B2 when the X1-X2 planes are unchanged and only extruded or averaged
+   * along X3, which is linear and keeps them divergence free */
+  const bool samePlanes = fileN[0] == N1 && fileN[1] == N2
+                          && (dim == 2 || fileN[2] == 1);
+  if (dim >= 2 && fileDim >= 2 && !samePlanes)
+  {
+    const int N1Local = primOld->N1Local;
+    const int N2Local = primOld->N2Local;
+    const int N3Local = primOld->N3Local;
+
+    /* Weight of every plane of the file in every local plane */
+    std::vector<double> planeWeights((size_t)N3Local*fileN[2], 0.);
+    for (int k=0; k<N3Local; k++)
+    {
+      double *weights = &planeWeights[(size_t)k*fileN[2]];
+      if (dim == 2 || fileN[2] == 1)
+      {
+        for (int plane=0; plane<fileN[2]; plane++)
+        {
+          weights[plane] = 1./fileN[2];
+        }
+        continue;
+      }
+      const double position
+        = (primOld->kLocalStart + k + 0.5)*fileN[2]/N3 - 0.5;
+      if (position <= 0.)
+      {
+        weights[0] = 1.;
+      }
+      else if (position >= fileN[2] - 1)
+      {
+        weights[fileN[2] - 1] = 1.;
+      }
+      else
+      {
+        const int below = (int)std::floor(position);
+        weights[below]     = below + 1. - position;
+        weights[below + 1] = position - below;
+      }
+    }
+
+    const int corners1 = N1Local + 1;
+    const int corners2 = N2Local + 1;
+    std::vector<double> A((size_t)corners1*corners2*N3Local, 0.);
+
+    const double fileDX1 = (XCoords->X1End - XCoords->X1Start)/fileN[0];
+    const double fileDX2 = (XCoords->X2End - XCoords->X2Start)/fileN[1];
+    std::vector<double> gB1((size_t)fileN[0]*fileN[1]);
+    std::vector<double> gB2((size_t)fileN[0]*fileN[1]);
+    std::vector<double> fileA;
+    for (int plane=0; plane<fileN[2]; plane++)
+    {
+      bool isNeeded = false;
+      for (int k=0; k<N3Local; k++)
+      {
+        isNeeded = isNeeded || planeWeights[plane + (size_t)k*fileN[2]] > 0.;
+      }
+      if (!isNeeded)
+      {
+        continue;
+      }
+
+      const int start[3] = {0, 0, plane};
+      const int count[3] = {fileN[0], fileN[1], 1};
+      dumpWriter::readBlock("conserved", consFileName, vars::B1,
+                            start, count, &gB1[0]
+                           );
+      dumpWriter::readBlock("conserved", consFileName, vars::B2,
+                            start, count, &gB2[0]
+                           );
+      vectorPotential(gB1, gB2, fileN[0], fileN[1], fileDX1, fileDX2, fileA);
+
+      for (int j=0; j<corners2; j++)
+      {
+        int first2; double weight2;
+        cornerWeight(primOld->jLocalStart + j, N2, fileN[1],
+                     first2, weight2
+                    );
+        for (int i=0; i<corners1; i++)
+        {
+          int first1; double weight1;
+          cornerWeight(primOld->iLocalStart + i, N1, fileN[0],
+                       first1, weight1
+                      );
+          const double *corner = &fileA[first1 + (fileN[0] + 1)*first2];
+          const double interpolated
+            =   (1. - weight2)*(  (1. - weight1)*corner[0]
+                                + weight1*corner[1]
+                               )
+              + weight2*(  (1. - weight1)*corner[fileN[0] + 1]
+                         + weight1*corner[fileN[0] + 2]
+                        );
+
+          for (int k=0; k<N3Local; k++)
+          {
+            A[i + corners1*(j + (size_t)corners2*k)]
+              += planeWeights[plane + (size_t)k*fileN[2]]*interpolated;
+          }
+        }
+      }
+    }
+
+    /* The stencil of the vector potential of the initial conditions */
+    std::vector<double> gB1Local((size_t)N1Local*N2Local*N3Local);
+    std::vector<double> gB2Local((size_t)N1Local*N2Local*N3Local);
+    for (int k=0; k<N3Local; k++)
+    {
+      for (int j=0; j<N2Local; j++)
+      {
+        for (int i=0; i<N1Local; i++)
+        {
+          const double *corner = &A[i + corners1*(j + (size_t)corners2*k)];
+          const double A00 = corner[0];
+          const double A10 = corner[1];
+          const double A01 = corner[corners1];
+          const double A11 = corner[corners1 + 1];
+
+          const size_t zone = i + N1Local*(j + (size_t)N2Local*k);
+          gB1Local[zone] = (A01 - A00 + A11 - A10)/(2.*XCoords->dX2);
+          gB2Local[zone] = (A00 - A10 + A01 - A11)/(2.*XCoords->dX1);
+        }
+      }
+    }
+    consOld->vars[vars::B1](domainX1, domainX2, domainX3)
+      = array(N1Local, N2Local, N3Local, &gB1Local[0]);
+    consOld->vars[vars::B2](domainX1, domainX2, domainX3)
+      = array(N1Local, N2Local, N3Local, &gB2Local[0]);
+  }
+
+  int rank;
+  MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+  MPI_Barrier(PETSC_COMM_WORLD);
+  if (rank == 0)
+  {
+    std::remove(consFileName.c_str());
+  }
+
+  /* 3) Primitives: B directly, the others by inverting the conserved
+   * variables, from the resampled primitives */
+  const int magneticVars[3] = {vars::B1, vars::B2, vars::B3};
+  for (int n=0; n<3; n++)
+  {
+    const int var = magneticVars[n];
+    primOld->vars[var](domainX1, domainX2, domainX3)
+      =   consOld->vars[var](domainX1, domainX2, domainX3)
+        / geomCenter->g(domainX1, domainX2, domainX3);
+    primOld->vars[var].eval();
+  }
+
+  boundaryCopies->apply(*primOld);
+  currentStep = timeStepperSwitches::CONSERVED_TO_PRIMITIVE;
+  solve(*primOld);
+  PetscPrintf(PETSC_COMM_WORLD, "\n");
+}
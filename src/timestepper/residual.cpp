@@ -1,10 +1,34 @@
 #include "timestepper.hpp"
 
+template <typename config>
+timeStepper::residualKernel timeStepper::residualKernelTable<config>::get()
+{
+  return &timeStepper::computeResidualImpl<config>;
+}
+
+void timeStepper::selectResidualKernel()
+{
+  computeResidualKernel 
+    = selectPhysicsConfig<residualKernel, residualKernelTable>();
+}
+
 void timeStepper::computeResidual(const grid &primGuess,
                                   grid &residualGuess, 
                                   int &numReads,
                                   int &numWrites
                                  )
+{
+  (this->*computeResidualKernel)(primGuess, residualGuess,
+                                 numReads, numWrites
+                                );
+}
+
+template <typename config>
+void timeStepper::computeResidualImpl(const grid &primGuess,
+                                      grid &residualGuess, 
+                                      int &numReads,
+                                      int &numWrites
+                                     )
 {
   numReads = 0; numWrites = 0;
   int numReadsElemSet, numWritesElemSet;
@@ -34,7 +58,7 @@ void timeStepper::computeResidual(const grid &primGuess,
     numReads  += numReadsImplicitSources  + numReadsTimeDerivSources;
     numWrites += numWritesImplicitSources + numWritesTimeDerivSources; 
 
-    for (int var=0; var<residualGuess.numVars; var++)
+    for (int var=0; var<config::numFluidVars; var++)
     {
       residualGuess.vars[var] = 
         (cons->vars[var] - consOld->vars[var])/(dt/2.)
@@ -53,14 +77,14 @@ void timeStepper::computeResidual(const grid &primGuess,
      * Writes:
      * ------
      * residualGuess[var] : numVars */
-    numReads  += 7*residualGuess.numVars;
+    numReads  += 7*config::numFluidVars;
 
     /* Normalization of the residualGuess */
-    if (params::conduction)
+    if (config::conduction)
     {
-      if(params::highOrderTermsConduction)
+      if (config::highOrderTermsConduction)
       {
-        residualGuess.vars[vars::Q] *=
+        residualGuess.vars[config::Q] *=
            elemOld->temperature 
          * af::sqrt(elemOld->rho*elemOld->chi_emhd*elemOld->tau);
 
@@ -68,16 +92,16 @@ void timeStepper::computeResidual(const grid &primGuess,
       }
       else
       {
-        residualGuess.vars[vars::Q] *= elemOld->tau;
+        residualGuess.vars[config::Q] *= elemOld->tau;
         numReads += 1;
       }
     }
 
-    if (params::viscosity)
+    if (config::viscosity)
     {
-      if(params::highOrderTermsViscosity)
+      if (config::highOrderTermsViscosity)
       {
-        residualGuess.vars[vars::DP] *=
+        residualGuess.vars[config::DP] *=
           af::sqrt(   elemOld->rho*elemOld->nu_emhd
                     * elemOld->temperature*elemOld->tau
                   );
@@ -85,7 +109,7 @@ void timeStepper::computeResidual(const grid &primGuess,
       }
       else
       {
-        residualGuess.vars[vars::DP] *= elemOld->tau;
+        residualGuess.vars[config::DP] *= elemOld->tau;
         numReads += 1;
       }
     }
@@ -110,7 +134,7 @@ void timeStepper::computeResidual(const grid &primGuess,
     numReads  += numReadsImplicitSources  + numReadsTimeDerivSources;
     numWrites += numWritesImplicitSources + numWritesTimeDerivSources; 
 
-    for (int var=0; var < residualGuess.numVars; var++)
+    for (int var=0; var<config::numFluidVars; var++)
     {
       residualGuess.vars[var] = 
         (cons->vars[var] - consOld->vars[var])/dt
@@ -128,14 +152,14 @@ void timeStepper::computeResidual(const grid &primGuess,
      * Writes:
      * ------
      * residualGuess[var] : numVars */
-    numReads  += 7*residualGuess.numVars;
+    numReads  += 7*config::numFluidVars;
 
     /* Normalization of the residualGuess */
-    if (params::conduction)
+    if (config::conduction)
     {
-      if(params::highOrderTermsConduction)
+      if (config::highOrderTermsConduction)
       {
-        residualGuess.vars[vars::Q] *= 
+        residualGuess.vars[config::Q] *= 
           elemHalfStep->temperature
         * af::sqrt(elemHalfStep->rho*elemHalfStep->chi_emhd*elemHalfStep->tau);
 
@@ -143,16 +167,16 @@ void timeStepper::computeResidual(const grid &primGuess,
       }
       else
       {
-        residualGuess.vars[vars::Q] *= elemHalfStep->tau;
+        residualGuess.vars[config::Q] *= elemHalfStep->tau;
         numReads += 1;
       }
     }
 
-    if (params::viscosity)
+    if (config::viscosity)
     {
-      if (params::highOrderTermsViscosity)
+      if (config::highOrderTermsViscosity)
       {
-        residualGuess.vars[vars::DP] *= 
+        residualGuess.vars[config::DP] *= 
           af::sqrt(   elemHalfStep->rho*elemHalfStep->nu_emhd
                     * elemHalfStep->temperature*elemHalfStep->tau
                   );
@@ -161,21 +185,32 @@ void timeStepper::computeResidual(const grid &primGuess,
       }
       else
       {
-        residualGuess.vars[vars::DP] *= elemHalfStep->tau;
+        residualGuess.vars[config::DP] *= elemHalfStep->tau;
         numReads += 1;
       }
     }
 
   } /* End of timeStepperSwitches::FULL_STEP */
 
+  else if (currentStep == timeStepperSwitches::CONSERVED_TO_PRIMITIVE)
+  {
+    /* Only the inversion of consOld, see resampleConserved(). Scaled by dt
+     * as in the steps, for the same tolerance */
+    for (int var=0; var<config::numFluidVars; var++)
+    {
+      residualGuess.vars[var] = (cons->vars[var] - consOld->vars[var])/dt;
+    }
+    numReads += 2*config::numFluidVars;
+  }
+
   std::vector<af::array *> arraysThatNeedEval;
   //Zero the residual in global ghost zones
-  for (int var=0; var<residualGuess.numVars; var++) 
+  for (int var=0; var<config::numFluidVars; var++) 
   {
     residualGuess.vars[var] *= residualMask;
     arraysThatNeedEval.push_back(&residualGuess.vars[var]);
   }
   af::eval(arraysThatNeedEval.size(), &arraysThatNeedEval[0]);
 
-  numWrites += residualGuess.numVars;
+  numWrites += config::numFluidVars;
 }
@@ -0,0 +1,119 @@
+import mpi4py, petsc4py
+from petsc4py import PETSc
+import numpy as np
+import pytest
+import gridPy
+import geometryPy
+import boundaryPy
+import timeStepperPy
+
+petsc4py.init()
+petscComm  = petsc4py.PETSc.COMM_WORLD
+comm = petscComm.tompi4py()
+rank = comm.Get_rank()
+numProcs = comm.Get_size()
+PETSc.Sys.Print("Using %d procs" % numProcs)
+
+# The fused and the staged face fluxes, and the divergence of the fluxes in
+# tiles and on the whole grid, are compared zone by zone, on a small grid (see
+# the fused_fluxes and tiled_fluxes tests in CMakeLists.txt)
+dim = int(pytest.config.getoption('dim'))
+N1  = int(pytest.config.getoption('N1'))
+N2  = int(pytest.config.getoption('N2')) if dim > 1 else 1
+N3  = int(pytest.config.getoption('N3')) if dim > 2 else 1
+
+# Geometry parameters
+blackHoleSpin = float(pytest.config.getoption('blackHoleSpin'))
+hSlope        = float(pytest.config.getoption('hSlope'))
+numGhost = 3
+
+X1Start = 0.; X1End = 1.
+X2Start = 0.; X2End = 1.
+X3Start = 0.; X3End = 1.
+
+boundaryLeft   = boundaryPy.PERIODIC
+boundaryRight  = boundaryPy.PERIODIC
+boundaryTop    = boundaryPy.PERIODIC
+boundaryBottom = boundaryPy.PERIODIC
+boundaryFront  = boundaryPy.PERIODIC
+boundaryBack   = boundaryPy.PERIODIC
+
+time = 0.
+dt   = 0.002
+numVars = 8
+metric = geometryPy.MINKOWSKI
+ts = timeStepperPy.timeStepperPy(N1, N2, N3,
+                                 dim, numVars, numGhost,
+                                 time, dt,
+                                 boundaryLeft, boundaryRight,
+                                 boundaryTop,  boundaryBottom,
+                                 boundaryFront, boundaryBack,
+                                 metric, blackHoleSpin, hSlope,
+                                 X1Start, X1End,
+                                 X2Start, X2End,
+                                 X3Start, X3End
+                                )
+
+# Smooth state with all the fluxes non-zero: rho, u > 0, sub-relativistic
+# velocities and a magnetic field in every direction
+X1Coords, X2Coords, X3Coords = ts.XCoords.getCoords(gridPy.CENTER)
+phase = 2.*np.pi*(X1Coords + X2Coords + X3Coords)
+primVars = np.zeros(ts.primOld.shape)
+primVars[0] = 1.  + 0.1*np.sin(phase)
+primVars[1] = 0.5 + 0.1*np.cos(phase)
+primVars[2] = 0.1*np.sin(phase)
+primVars[3] = 0.2*np.cos(phase)
+primVars[4] = 0.1*np.sin(2.*phase)
+primVars[5] = 0.3 + 0.05*np.cos(phase)
+primVars[6] = 0.2 + 0.05*np.sin(phase)
+primVars[7] = 0.1 + 0.05*np.cos(2.*phase)
+ts.primOld.setVars(primVars)
+
+kStart = numGhost if dim > 2 else 0
+jStart = numGhost if dim > 1 else 0
+def interior(vars):
+  return vars[:, kStart:kStart+N3, jStart:jStart+N2, numGhost:numGhost+N1]
+
+def computeFluxes(fuseFaceFluxes):
+  ts.fuseFaceFluxes = fuseFaceFluxes
+  ts.computeDivOfFluxes(ts.primOld)
+  return [interior(ts.fluxesX1.getVars()),
+          interior(ts.fluxesX2.getVars()),
+          interior(ts.fluxesX3.getVars()),
+          interior(ts.divFluxes.getVars())
+         ]
+
+def test_fused_matches_staged():
+  if (not ts.hasFusedFaceFluxes()):
+    pytest.skip("fused face fluxes need ARCH=Native and ideal MHD")
+
+  fused  = computeFluxes(True)
+  staged = computeFluxes(False)
+  ts.fuseFaceFluxes = True
+
+  for fusedVars, stagedVars in zip(fused[:dim] + fused[3:],
+                                   staged[:dim] + staged[3:]
+                                  ):
+    np.testing.assert_allclose(fusedVars, stagedVars,
+                               rtol=1e-10, atol=1e-12
+                              )
+
+@pytest.mark.parametrize("fuseFaceFluxes", [True, False])
+def test_tiled_matches_untiled(fuseFaceFluxes):
+  if (dim < 2):
+    pytest.skip("the fluxes are only computed in tiles in 2D and 3D")
+  if (fuseFaceFluxes and not ts.hasFusedFaceFluxes()):
+    pytest.skip("fused face fluxes need ARCH=Native and ideal MHD")
+
+  ts.fuseFaceFluxes = fuseFaceFluxes
+  ts.fluxTileRows = 0
+  untiled = computeFluxes(fuseFaceFluxes)[3].copy()
+
+  # 5 does not divide the local zones: the last tile overlaps the one before
+  for fluxTileRows in [3, 5]:
+    ts.fluxTileRows = fluxTileRows
+    tiled = computeFluxes(fuseFaceFluxes)[3]
+    np.testing.assert_allclose(tiled, untiled, rtol=1e-12, atol=1e-14)
+
+  ts.fluxTileRows = 0
+  ts.fuseFaceFluxes = True
@@ -176,6 +176,23 @@ cdef class timeStepperPy(object):
     def __get__(self):
      return self.divB
 
+  property fuseFaceFluxes:
+    def __get__(self):
+     return self.timeStepperPtr.fuseFaceFluxes
+
+    def __set__(self, bint fuseFaceFluxes):
+     self.timeStepperPtr.fuseFaceFluxes = fuseFaceFluxes
+
+  def hasFusedFaceFluxes(self):
+     return self.timeStepperPtr.hasFusedFaceFluxes()
+
+  property fluxTileRows:
+    def __get__(self):
+     return self.timeStepperPtr.fluxTileRows
+
+    def __set__(self, int fluxTileRows):
+     self.timeStepperPtr.fluxTileRows = fluxTileRows
+
 
   def fluxCT(self):
      cdef int numReads  = 0
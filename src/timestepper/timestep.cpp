@@ -12,13 +12,10 @@ void timeStepper::timeStep(int &numReads, int &numWrites)
   af::timer halfStepTimer = af::timer::start();
 
   currentStep = timeStepperSwitches::HALF_STEP;
+  memoryArena::beginPhase("Half step");
   /* Apply boundary conditions on primOld */
   af::timer boundaryTimer = af::timer::start();
-  boundaries::applyBoundaryConditions(boundaryLeft, boundaryRight,
-                                      boundaryTop,  boundaryBottom,
-                                      boundaryFront, boundaryBack,
-                                      *primOld
-                                     );
+  boundaryCopies->apply(*primOld);
   setProblemSpecificBCs(numReads,numWrites);
   double boundaryTime = af::timer::stop(boundaryTimer);
 
@@ -104,6 +101,7 @@ void timeStepper::timeStep(int &numReads, int &numWrites)
   jacobianAssemblyTime = 0.;
   lineSearchTime       = 0.;
   linearSolverTime     = 0.;
+  memoryArena::beginPhase("Half step solver");
   af::timer solverTimer = af::timer::start();
   solve(*prim);
   double solverTime = af::timer::stop(solverTimer);
@@ -122,74 +120,95 @@ void timeStepper::timeStep(int &numReads, int &numWrites)
   double halfStepCommTime = af::timer::stop(halfStepCommTimer);
 
   af::timer halfStepDiagTimer = af::timer::start();
-  halfStepDiagnostics(numReads,numWrites);
+  if (!isWarmUp)
+  {
+    halfStepDiagnostics(numReads,numWrites);
+  }
   double halfStepDiagTime = af::timer::stop(halfStepDiagTimer);
   /* Half step complete */
 
   double halfStepTime = af::timer::stop(halfStepTimer);
 
-  PetscPrintf(PETSC_COMM_WORLD, "\n");
-  PetscPrintf(PETSC_COMM_WORLD, "    ---Performance report--- \n");
-  PetscPrintf(PETSC_COMM_WORLD, "     Boundary Conditions : %g secs, %g %\n",
-                                 boundaryTime, boundaryTime/halfStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Setting elemOld     : %g secs, %g %\n",
-                                 elemOldTime, 
-                                 elemOldTime/halfStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Conserved vars Old  : %g secs, %g %\n",
-                                 consOldTime, consOldTime/halfStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Explicit sources    : %g secs, %g %\n",
-                               explicitSourcesTime, 
-                               explicitSourcesTime/halfStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Divergence of fluxes: %g secs, %g %\n",
-                                 divFluxTime, divFluxTime/halfStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Nonlinear solver    : %g secs, %g %\n",
-                                 solverTime, solverTime/halfStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     |- Jacobian assembly: %g secs, %g %\n",
-                                 jacobianAssemblyTime,
-                                 jacobianAssemblyTime/halfStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     |- Linear solver    : %g secs, %g %\n",
-                                 linearSolverTime, 
-                                 linearSolverTime/halfStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     |- Linesearch       : %g secs, %g %\n",
-                                 lineSearchTime,
-                                 lineSearchTime/halfStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Induction equation  : %g secs, %g %\n",
-                                 inductionEqnTime,
-                                 inductionEqnTime/halfStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Communication       : %g secs, %g %\n",
-                                 halfStepCommTime,
-                                 halfStepCommTime/halfStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Diagnostics         : %g secs, %g %\n",
-                                 halfStepDiagTime,
-                                 halfStepDiagTime/halfStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Half step time      : %g secs\n\n",
-                                 halfStepTime
-             );
+  /* Per rank, for the min/max/mean over the ranks */
+  if (!isWarmUp)
+  {
+    timings::record("Half step/Boundary conditions", boundaryTime);
+    timings::record("Half step/Setting elemOld", elemOldTime);
+    timings::record("Half step/Conserved vars old", consOldTime);
+    timings::record("Half step/Explicit sources", explicitSourcesTime);
+    timings::record("Half step/Divergence of fluxes", divFluxTime);
+    timings::record("Half step/Nonlinear solver", solverTime);
+    timings::record("Half step/Jacobian assembly", jacobianAssemblyTime);
+    timings::record("Half step/Linear solver", linearSolverTime);
+    timings::record("Half step/Linesearch", lineSearchTime);
+    timings::record("Half step/Induction equation", inductionEqnTime);
+    timings::record("Half step/Communication", halfStepCommTime);
+    timings::record("Half step/Diagnostics", halfStepDiagTime);
+    timings::record("Half step/Total", halfStepTime);
+  }
+
+  if (params::printPerformanceReport)
+  {
+    PetscPrintf(PETSC_COMM_WORLD, "\n");
+    PetscPrintf(PETSC_COMM_WORLD, "    ---Performance report--- \n");
+    PetscPrintf(PETSC_COMM_WORLD, "     Boundary Conditions : %g secs, %g %\n",
+                                   boundaryTime, boundaryTime/halfStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Setting elemOld     : %g secs, %g %\n",
+                                   elemOldTime, 
+                                   elemOldTime/halfStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Conserved vars Old  : %g secs, %g %\n",
+                                   consOldTime, consOldTime/halfStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Explicit sources    : %g secs, %g %\n",
+                                 explicitSourcesTime, 
+                                 explicitSourcesTime/halfStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Divergence of fluxes: %g secs, %g %\n",
+                                   divFluxTime, divFluxTime/halfStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Nonlinear solver    : %g secs, %g %\n",
+                                   solverTime, solverTime/halfStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     |- Jacobian assembly: %g secs, %g %\n",
+                                   jacobianAssemblyTime,
+                                   jacobianAssemblyTime/halfStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     |- Linear solver    : %g secs, %g %\n",
+                                   linearSolverTime, 
+                                   linearSolverTime/halfStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     |- Linesearch       : %g secs, %g %\n",
+                                   lineSearchTime,
+                                   lineSearchTime/halfStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Induction equation  : %g secs, %g %\n",
+                                   inductionEqnTime,
+                                   inductionEqnTime/halfStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Communication       : %g secs, %g %\n",
+                                   halfStepCommTime,
+                                   halfStepCommTime/halfStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Diagnostics         : %g secs, %g %\n",
+                                   halfStepDiagTime,
+                                   halfStepDiagTime/halfStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Half step time      : %g secs\n\n",
+                                   halfStepTime
+               );
+  }
 
   /* Now take the full step */
   PetscPrintf(PETSC_COMM_WORLD, "  ---Full step--- \n");
   af::timer fullStepTimer = af::timer::start();
 
   currentStep = timeStepperSwitches::FULL_STEP;
+  memoryArena::beginPhase("Full step");
   /* apply boundary conditions on primHalfStep */
   boundaryTimer = af::timer::start();
-  boundaries::applyBoundaryConditions(boundaryLeft, boundaryRight,
-                                      boundaryTop,  boundaryBottom,
-                                      boundaryFront, boundaryBack,
-                                      *primHalfStep
-                                     );
+  boundaryCopies->apply(*primHalfStep);
   setProblemSpecificBCs(numReads,numWrites);
   boundaryTime = af::timer::stop(boundaryTimer);
 
@@ -253,6 +272,7 @@ void timeStepper::timeStep(int &numReads, int &numWrites)
   jacobianAssemblyTime = 0.;
   lineSearchTime       = 0.;
   linearSolverTime     = 0.;
+  memoryArena::beginPhase("Full step solver");
   solverTimer = af::timer::start();
   solve(*prim);
   solverTime = af::timer::stop(solverTimer);
@@ -270,69 +290,149 @@ void timeStepper::timeStep(int &numReads, int &numWrites)
   double fullStepCommTime = af::timer::stop(fullStepCommTimer);
 
   time += dt;
+  memoryArena::beginPhase("Diagnostics");
   af::timer fullStepDiagTimer = af::timer::start();
-  fullStepDiagnostics(numReads,numWrites);
+  if (!isWarmUp)
+  {
+    fullStepDiagnostics(numReads,numWrites);
+  }
   double fullStepDiagTime = af::timer::stop(fullStepDiagTimer);
 
   /* done */
   double fullStepTime = af::timer::stop(fullStepTimer);
   double timeStepTime = af::timer::stop(timeStepTimer);
 
-  PetscPrintf(PETSC_COMM_WORLD, "\n");
-  PetscPrintf(PETSC_COMM_WORLD, "    ---Performance report--- \n");
-  PetscPrintf(PETSC_COMM_WORLD, "     Boundary Conditions : %g secs, %g %\n",
-                                 boundaryTime, boundaryTime/fullStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Setting elemHalfStep: %g secs, %g %\n",
-                                 elemHalfStepTime, 
-                                 elemHalfStepTime/fullStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Explicit sources    : %g secs, %g %\n",
-                               explicitSourcesTime, 
-                               explicitSourcesTime/fullStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Divergence of fluxes: %g secs, %g %\n",
-                                 divFluxTime, divFluxTime/fullStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Nonlinear solver    : %g secs, %g %\n",
-                                 solverTime, solverTime/fullStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     |- Jacobian assembly: %g secs, %g %\n",
-                                 jacobianAssemblyTime,
-                                 jacobianAssemblyTime/fullStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     |- Linear solver    : %g secs, %g %\n",
-                                 linearSolverTime, 
-                                 linearSolverTime/fullStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     |- Linesearch       : %g secs, %g %\n",
-                                 lineSearchTime,
-                                 lineSearchTime/fullStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Induction equation  : %g secs, %g %\n",
-                                 inductionEqnTime,
-                                 inductionEqnTime/fullStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Communication       : %g secs, %g %\n",
-                                 fullStepCommTime,
-                                 fullStepCommTime/fullStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Diagnostics         : %g secs, %g %\n",
-                                 fullStepDiagTime,
-                                 fullStepDiagTime/fullStepTime * 100
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "     Full step time      : %g secs\n\n",
-                                 fullStepTime
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "   ---Performance / proc : %g Zone cycles/sec/proc\n",
-                                 prim->N1Local
-                               * prim->N2Local
-                               * prim->N3Local / timeStepTime
-             );
-  PetscPrintf(PETSC_COMM_WORLD, "   ---Total Performance  : %g Zone cycles/sec\n",
-                                 N1 * N2 * N3 
-                               / timeStepTime
-             );
+  if (!isWarmUp)
+  {
+    timings::record("Full step/Boundary conditions", boundaryTime);
+    timings::record("Full step/Setting elemHalfStep", elemHalfStepTime);
+    timings::record("Full step/Explicit sources", explicitSourcesTime);
+    timings::record("Full step/Divergence of fluxes", divFluxTime);
+    timings::record("Full step/Nonlinear solver", solverTime);
+    timings::record("Full step/Jacobian assembly", jacobianAssemblyTime);
+    timings::record("Full step/Linear solver", linearSolverTime);
+    timings::record("Full step/Linesearch", lineSearchTime);
+    timings::record("Full step/Induction equation", inductionEqnTime);
+    timings::record("Full step/Communication", fullStepCommTime);
+    timings::record("Full step/Diagnostics", fullStepDiagTime);
+    timings::record("Full step/Total", fullStepTime);
+    timings::record("Time step", timeStepTime);
+  }
+
+  if (params::printPerformanceReport)
+  {
+    PetscPrintf(PETSC_COMM_WORLD, "\n");
+    PetscPrintf(PETSC_COMM_WORLD, "    ---Performance report--- \n");
+    PetscPrintf(PETSC_COMM_WORLD, "     Boundary Conditions : %g secs, %g %\n",
+                                   boundaryTime, boundaryTime/fullStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Setting elemHalfStep: %g secs, %g %\n",
+                                   elemHalfStepTime, 
+                                   elemHalfStepTime/fullStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Explicit sources    : %g secs, %g %\n",
+                                 explicitSourcesTime, 
+                                 explicitSourcesTime/fullStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Divergence of fluxes: %g secs, %g %\n",
+                                   divFluxTime, divFluxTime/fullStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Nonlinear solver    : %g secs, %g %\n",
+                                   solverTime, solverTime/fullStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     |- Jacobian assembly: %g secs, %g %\n",
+                                   jacobianAssemblyTime,
+                                   jacobianAssemblyTime/fullStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     |- Linear solver    : %g secs, %g %\n",
+                                   linearSolverTime, 
+                                   linearSolverTime/fullStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     |- Linesearch       : %g secs, %g %\n",
+                                   lineSearchTime,
+                                   lineSearchTime/fullStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Induction equation  : %g secs, %g %\n",
+                                   inductionEqnTime,
+                                   inductionEqnTime/fullStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Communication       : %g secs, %g %\n",
+                                   fullStepCommTime,
+                                   fullStepCommTime/fullStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Diagnostics         : %g secs, %g %\n",
+                                   fullStepDiagTime,
+                                   fullStepDiagTime/fullStepTime * 100
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "     Full step time      : %g secs\n\n",
+                                   fullStepTime
+               );
+#ifdef GRIM_NATIVE_KERNELS
+    const char *backend = "Native OpenMP/SIMD";
+#else
+    const char *backend = "ArrayFire";
+#endif
+    PetscPrintf(PETSC_COMM_WORLD, "   ---Kernel backend     : %s\n", backend);
+    PetscPrintf(PETSC_COMM_WORLD, "   ---Performance / proc : %g Zone cycles/sec/proc\n",
+                                   prim->N1Local
+                                 * prim->N2Local
+                                 * prim->N3Local / timeStepTime
+               );
+    PetscPrintf(PETSC_COMM_WORLD, "   ---Total Performance  : %g Zone cycles/sec\n",
+                                   N1 * N2 * N3 
+                                 / timeStepTime
+               );
+  }
+  numSteps++;
+  if (!isWarmUp)
+  {
+    timings::endStep(numSteps, time);
+  }
+  memoryArena::endStep();
+}
+
+/* Runs one time step to generate and compile every kernel, then puts back
+ * the state it started from, so that the simulation is not advanced. The
+ * arrays are reference counted and copied on write, so keeping a handle on
+ * them is enough to save them. The diagnostics, which may write files, are
+ * skipped. */
+void timeStepper::warmUp(int &numReads, int &numWrites)
+{
+  const double timeSaved = time;
+  const double dtSaved   = dt;
+  const long long int numStepsSaved = numSteps;
+
+  grid *stateGrids[] = {prim, primHalfStep, primOld, cons, consOld,
+                        primGuessPlusEps, primGuessLineSearchTrial
+                       };
+  const int numStateGrids = sizeof(stateGrids)/sizeof(stateGrids[0]);
+
+  std::vector<array> savedVars;
+  for (int n=0; n < numStateGrids; n++)
+  {
+    for (int var=0; var < stateGrids[n]->numVars; var++)
+    {
+      savedVars.push_back(stateGrids[n]->vars[var]);
+    }
+  }
+
+  isWarmUp = true;
+  timeStep(numReads, numWrites);
+  isWarmUp = false;
+
+  int index = 0;
+  for (int n=0; n < numStateGrids; n++)
+  {
+    for (int var=0; var < stateGrids[n]->numVars; var++)
+    {
+      stateGrids[n]->vars[var] = savedVars[index];
+      index++;
+    }
+  }
+  time = timeSaved;
+  dt   = dtSaved;
+  numSteps = numStepsSaved;
+  af::sync();
 }
 
 double timeStepper::computeDt(int &numReads, int &numWrites)
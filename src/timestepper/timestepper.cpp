@@ -1,6 +1,20 @@
 #include "timestepper.hpp"
+#include "../grid/dumpwriter.hpp"
 #include <fstream>
 
+/* Cache of the geometry at location, reused by later runs with the same grid
+ * and metric. Empty if params::geometryCacheDir is */
+static std::string geometryCacheBase(const std::string location)
+{
+  if (params::geometryCacheDir.empty())
+  {
+    return "";
+  }
+  mkdir(params::geometryCacheDir.c_str(), 0755);
+
+  return params::geometryCacheDir + "/" + location;
+}
+
 timeStepper::timeStepper(const int N1, 
                          const int N2,
                          const int N3,
@@ -33,6 +47,10 @@ timeStepper::timeStepper(const int N1,
   
   this->time = time;
   this->dt = dt;
+  this->isWarmUp = false;
+  this->fuseFaceFluxes = true;
+  this->restarted = false;
+  this->numSteps = 0;
   this->numGhost = numGhost;
   this->dim = dim;
   this->numVars = numVars;
@@ -107,6 +125,15 @@ timeStepper::timeStepper(const int N1,
                           periodicBoundariesX3
                          );
 
+  /* The boundary conditions are the same on every step; primOld and
+   * primHalfStep share the layout */
+  boundaryCopies = new boundaries::copyDescriptors(*primOld);
+  boundaries::addBoundaryCopies(boundaryLeft,  boundaryRight,
+                                boundaryTop,   boundaryBottom,
+                                boundaryFront, boundaryBack,
+                                *primOld, *boundaryCopies
+                               );
+
   cons         = new grid(N1, N2, N3,
                           dim, numVars, numGhost,
                           periodicBoundariesX1,
@@ -149,20 +176,6 @@ timeStepper::timeStepper(const int N1,
                                 periodicBoundariesX3
                                );
 
-  primLeft  = new grid(N1, N2, N3,
-                       dim, numVars, numGhost,
-                       periodicBoundariesX1,
-                       periodicBoundariesX2,
-                       periodicBoundariesX3
-                      );
-
-  primRight = new grid(N1, N2, N3,
-                       dim, numVars, numGhost,
-                       periodicBoundariesX1,
-                       periodicBoundariesX2,
-                       periodicBoundariesX3
-                      );
-
   fluxesX1  = new grid(N1, N2, N3,
                        dim, numVars, numGhost,
                        periodicBoundariesX1,
@@ -238,7 +251,8 @@ timeStepper::timeStepper(const int N1,
   geomLeft    = new geometry(metric,
                              blackHoleSpin,
                              hSlope, 
-                             *XCoords
+                             *XCoords,
+                             geometryCacheBase("left")
                             );
   PetscPrintf(PETSC_COMM_WORLD, "done\n");
 
@@ -247,7 +261,8 @@ timeStepper::timeStepper(const int N1,
   geomRight   = new geometry(metric,
                              blackHoleSpin,
                              hSlope,
-                             *XCoords
+                             *XCoords,
+                             geometryCacheBase("right")
                             );
   PetscPrintf(PETSC_COMM_WORLD, "done\n");
 
@@ -256,7 +271,8 @@ timeStepper::timeStepper(const int N1,
   geomBottom  = new geometry(metric,
                              blackHoleSpin,
                              hSlope,
-                             *XCoords
+                             *XCoords,
+                             geometryCacheBase("bottom")
                             );
   PetscPrintf(PETSC_COMM_WORLD, "done\n");
 
@@ -265,7 +281,8 @@ timeStepper::timeStepper(const int N1,
   geomTop     = new geometry(metric,
                              blackHoleSpin,
                              hSlope, 
-                             *XCoords
+                             *XCoords,
+                             geometryCacheBase("top")
                             );
   PetscPrintf(PETSC_COMM_WORLD, "done\n");
 
@@ -274,7 +291,8 @@ timeStepper::timeStepper(const int N1,
   geomCenter  = new geometry(metric,
                              blackHoleSpin,
                              hSlope,
-                             *XCoords
+                             *XCoords,
+                             geometryCacheBase("center")
                             );
   PetscPrintf(PETSC_COMM_WORLD, "done\n");
 
@@ -283,6 +301,31 @@ timeStepper::timeStepper(const int N1,
   PetscPrintf(PETSC_COMM_WORLD, "done\n\n");
   /* XCoords set to locations::CENTER */
 
+  /* The face geometries never change: they are stacked for the Riemann
+   * solver here, and the geometries of the single faces become views of
+   * the stacks */
+  geomFacesX1 = new geometry();
+  geomFacesX1->stackFaces(*geomLeft, *geomRight);
+  geomLeft->viewFace(*geomFacesX1, 0);
+  geomRight->viewFace(*geomFacesX1, 1);
+
+  geomFacesX2 = NULL;
+  if (dim >= 2)
+  {
+    geomFacesX2 = new geometry();
+    geomFacesX2->stackFaces(*geomBottom, *geomTop);
+    geomBottom->viewFace(*geomFacesX2, 0);
+    geomTop->viewFace(*geomFacesX2, 1);
+  }
+
+  geomFacesX3 = NULL;
+  if (dim == 3)
+  {
+    geomFacesX3 = new geometry();
+    geomFacesX3->stackFaces(*geomCenter, *geomCenter);
+    geomCenter->viewFace(*geomFacesX3, 0);
+  }
+
   int numReads, numWrites;
   elem          = new fluidElement(*prim, *geomCenter,
                                    numReads, numWrites
@@ -296,6 +339,20 @@ timeStepper::timeStepper(const int N1,
 
   riemann = new riemannSolver(*prim, *geomCenter);
 
+  /* The tiles of computeDivOfFluxes() are built on first use */
+  fluxTileRows = params::fluxTileRows;
+  tileRows     = 0;
+  tilePrim     = tileDivFluxes = NULL;
+  tileFluxesX1 = tileFluxesX2 = tileFluxesX3 = NULL;
+  tileEmfX1    = tileEmfX2    = tileEmfX3    = NULL;
+  tileGeomFacesX1 = tileGeomFacesX2 = tileGeomFacesX3 = NULL;
+  tileGeomLeft    = tileGeomRight   = NULL;
+  tileGeomBottom  = tileGeomTop     = NULL;
+  tileGeomCenter  = NULL;
+  tileRiemann     = NULL;
+
+  selectResidualKernel();
+
   int numFluidVars = vars::numFluidVars;
   /* Data structures needed for the nonlinear solver */
   residual        = new grid(N1, N2, N3,
@@ -384,6 +441,8 @@ timeStepper::timeStepper(const int N1,
 
   initialConditions(numReads, numWrites);
 
+  /* A checkpoint left by a wall clock termination (restartFileName and
+   * restartFileTime) restarts the run as well as params::restart */
   struct stat fileInfoName;
   struct stat fileInfoTime;
   if (
@@ -392,6 +451,9 @@ timeStepper::timeStepper(const int N1,
 	(stat(params::restartFileTime.c_str(), &fileInfoTime) == 0) ) 
      )
   {
+    restarted = true;
+    timings::setRestarted(true);
+
     struct stat fileInfo;
     int rank;
     MPI_Comm_rank(PETSC_COMM_WORLD,&rank);
@@ -414,7 +476,21 @@ timeStepper::timeStepper(const int N1,
 	std::ifstream fName(params::restartFileName.c_str());
 	std::string mFileName;
 	fName>>mFileName;
-	primOld->load("primitives",mFileName);
+	/* Raw per-rank files if the decomposition is unchanged, else HDF5 */
+	if (params::rawRestart &&
+	    restartFile::read(*primOld, restartFile::fileBaseOf(mFileName),
+			      this->time, this->dt, this->numSteps
+			     )
+	   )
+	  {
+	    PetscPrintf(PETSC_COMM_WORLD, " Read raw restart files %s\n\n",
+			restartFile::rankFileName(restartFile::fileBaseOf(mFileName)).c_str()
+			);
+	  }
+	else
+	  {
+	    loadPrimitives(mFileName);
+	  }
       }
     else
       {
@@ -438,7 +514,7 @@ timeStepper::timeStepper(const int N1,
 	      }
 	  }
 	
-	primOld->load("primitives", params::restartFile);
+	loadPrimitives(params::restartFile);
       }
     // Need to call the diagnostics to reset the time step !!!
     fullStepDiagnostics(numReads, numWrites);
@@ -450,7 +526,6 @@ timeStepper::~timeStepper()
   delete prim, primHalfStep, primOld, primIC;
   delete cons, consOld;
   delete sourcesExplicit, sourcesImplicit, sourcesImplicitOld, sourcesTimeDer;
-  delete primLeft, primRight;
   delete fluxesX1, fluxesX2, fluxesX3;
   delete divFluxes;
   delete divB;
@@ -458,7 +533,12 @@ timeStepper::~timeStepper()
   delete elem, elemOld, elemHalfStep;
   delete riemann;
   delete geomLeft, geomRight, geomBottom, geomTop, geomCenter;
+  delete geomFacesX1;
+  delete geomFacesX2;
+  delete geomFacesX3;
+  deleteFluxTiles();
   delete dump;
+  delete boundaryCopies;
 
   delete primGuessLineSearchTrial;
   delete primGuessPlusEps;
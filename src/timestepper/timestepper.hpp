@@ -1,9 +1,14 @@
 #ifndef GRIM_TIMESTEPPER_H_
 #define GRIM_TIMESTEPPER_H_
 
+#include <vector>
 #include <sys/stat.h>
 #include "../params.hpp"
 #include "../grid/grid.hpp"
+#include "../grid/stencil.hpp"
+#include "../grid/memoryarena.hpp"
+#include "../grid/restartfile.hpp"
+#include "timings.hpp"
 #include "../physics/physics.hpp"
 #include "../geometry/geometry.hpp"
 #include "../boundary/boundary.hpp"
@@ -13,7 +18,7 @@ namespace timeStepperSwitches
 {
   enum
   {
-    HALF_STEP, FULL_STEP
+    HALF_STEP, FULL_STEP, CONSERVED_TO_PRIMITIVE
   };
 };
 
@@ -39,6 +44,26 @@ class timeStepper
                        int &numReads,
                        int &numWrites
                       );
+
+  /* computeResidual() dispatches to the physicsConfig instantiation matching
+   * the runtime params, selected once in the constructor */
+  typedef void (timeStepper::*residualKernel)(const grid &prim,
+                                              grid &residual,
+                                              int &numReads,
+                                              int &numWrites
+                                             );
+  template <typename config> struct residualKernelTable
+  {
+    static residualKernel get();
+  };
+  residualKernel computeResidualKernel;
+  void selectResidualKernel();
+
+  template <typename config>
+  void computeResidualImpl(const grid &prim, grid &residual,
+                           int &numReads,
+                           int &numWrites
+                          );
   void batchLinearSolve(const array &A, const array &b, array &x);
   double linearSolverTime;
   double lineSearchTime;
@@ -55,8 +80,60 @@ class timeStepper
 
   double bandwidthTest(const int numEvals);
 
+  /* Slab of fluxTileRows interior zones along the outermost direction, with
+   * numGhost zones on either side, on which computeDivOfFluxes() runs every
+   * stage of the fluxes when fluxTileRows > 0. The grids hold the zones of
+   * this rank only and the geometries are views of the face geometries of
+   * the slab. Built by buildFluxTiles() for tileRows interior zones */
+  int tileRows;
+  grid *tilePrim, *tileDivFluxes;
+  grid *tileFluxesX1, *tileFluxesX2, *tileFluxesX3;
+  grid *tileEmfX1, *tileEmfX2, *tileEmfX3;
+  geometry *tileGeomFacesX1, *tileGeomFacesX2, *tileGeomFacesX3;
+  geometry *tileGeomLeft,   *tileGeomRight;
+  geometry *tileGeomBottom, *tileGeomTop;
+  geometry *tileGeomCenter;
+  riemannSolver *tileRiemann;
+  void buildFluxTiles(const int rows);
+  void deleteFluxTiles();
+  void viewFluxTile(const int dir, const int first, const int last);
+  void computeDivOfFluxesInTiles(const grid &prim, const array &primSoA,
+                                 int &numReads, int &numWrites
+                                );
+
+  void fluxCT(grid &fluxX1, grid &fluxX2, grid &fluxX3,
+              grid &emf1, grid &emf2, grid &emf3,
+              int &numReads, int &numWrites
+             );
+  void computeEMF(const grid &fluxX1, const grid &fluxX2,
+                  const grid &fluxX3,
+                  grid &emf1, grid &emf2, grid &emf3,
+                  int &numReadsEMF, int &numWritesEMF
+                 );
+
+  /* Set during warmUp(): the problem-specific diagnostics are skipped */
+  bool isWarmUp;
+
+  /* Loads primOld from a restart file. A 2D file is extruded along X3 for
+   * a 3D run, with a perturbation of u (params::extrusionPerturbation).
+   * A file at another resolution goes through resampleConserved() */
+  void loadPrimitives(const std::string fileName);
+
+  /* Resamples the conserved variables of the primitives in fileName
+   * (fileN zones, fileDim directions) onto the grid instead of the
+   * primitives: every zone gets the mean of the densities sqrt(-g)*cons,
+   * so that their integrals are conserved. B1 and B2 are set from a vector
+   * potential A3 at the corners, interpolated from the one of the file, so
+   * that the divergence of computeDivB() vanishes. primOld, which holds
+   * the resampled primitives, is the guess of the inversion of the
+   * conserved variables. Uses cons and consOld */
+  void resampleConserved(const std::string fileName, const int fileDim,
+                         const int fileN[3]
+                        );
+
   public:
     double dt, time;
+    long long int numSteps;
     int N1, N2, N3, numGhost, dim;
     int numVars;
 
@@ -71,7 +148,6 @@ class timeStepper
     grid *sourcesImplicit;
     grid *sourcesImplicitOld;
     grid *sourcesTimeDer;
-    grid *primLeft, *primRight;
     grid *fluxesX1, *fluxesX2, *fluxesX3;
     grid *emfX1, *emfX2, *emfX3;
     grid *divFluxes;
@@ -82,16 +158,52 @@ class timeStepper
     geometry *geomBottom, *geomTop;
     geometry *geomCenter;
 
+    /* Both faces along every direction, stacked once for the Riemann
+     * solver. X3 has no face geometries and stacks geomCenter with itself.
+     * NULL beyond dim */
+    geometry *geomFacesX1, *geomFacesX2, *geomFacesX3;
+
     fluidElement *elem, *elemOld, *elemHalfStep;
 
     riemannSolver *riemann;
 
+    boundaries::copyDescriptors *boundaryCopies;
+
     void computeDivOfFluxes(const grid &prim,
                             int &numReads, int &numWrites
                            );
+    /* The face fluxes go through the fused pass of the native backend when
+     * hasFusedFaceFluxes() (ARCH=Native and ideal MHD) and fuseFaceFluxes
+     * is set, which it is by default. Unset, they take the staged
+     * reconstruction + Riemann solver path, as on the other backends */
+    bool fuseFaceFluxes;
+    bool hasFusedFaceFluxes() const;
+    void computeFaceFluxes(const grid &prim, const array &primSoA,
+                           const int dir,
+                           geometry &geomFaceLeft,
+                           geometry &geomFaceRight,
+                           geometry &geomFaces,
+                           riemannSolver &riemannFaces,
+                           grid &flux,
+                           int &numReads, int &numWrites
+                          );
+    /* With fluxTileRows > 0 (params::fluxTileRows by default), 2D and 3D
+     * grids go through computeDivOfFluxes() in slabs of fluxTileRows zones
+     * along the outermost direction (X2 in 2D, X3 in 3D): reconstruction,
+     * Riemann solver, fluxCT, flux filter and divergence on one slab before
+     * the next, so that its fluxes stay in cache. Only divFluxes is
+     * updated, on the interior zones along the slabs: fluxesX1, fluxesX2,
+     * fluxesX3 and the emfs are left as they are */
+    int fluxTileRows;
 
     int currentStep;
 
+    /* Set if the primitives were loaded from a restart file, either with
+     * params::restart or from the checkpoint of a wall clock termination.
+     * The outputs of a restarted run append to those of the run it
+     * continues */
+    bool restarted;
+
     timeStepper(const int N1, 
                 const int N2,
                 const int N3,
@@ -113,6 +225,7 @@ class timeStepper
     ~timeStepper();
 
     void timeStep(int &numReads, int &numWrites);
+    void warmUp(int &numReads, int &numWrites);
 
     void fluxCT(int &numReads, int &numWrites);
     void computeEMF(int &numReadsEMF, int &numWritesEMF);
@@ -128,7 +241,14 @@ class timeStepper
     void halfStepDiagnostics(int &numReads, int &numWrites);
     void fullStepDiagnostics(int &numReads, int &numWrites);
     void setProblemSpecificBCs(int &numReads, int &numWrites);
-    void applyProblemSpecificFluxFilter(int &numReads, int &numWrites);
+    /* Applied to the fluxes of the whole grid or of a tile of
+     * computeDivOfFluxes(), whose zone n along every direction d is the
+     * zone n + tileOffset[d] of the arrays of the grid */
+    void applyProblemSpecificFluxFilter(grid &fluxX1, grid &fluxX2,
+                                        grid &fluxX3,
+                                        const int tileOffset[3],
+                                        int &numReads, int &numWrites
+                                       );
     int CheckWallClockTermination();
 };
 
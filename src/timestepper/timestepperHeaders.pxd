@@ -67,3 +67,7 @@ cdef extern from "timestepper.hpp":
     void computeDivOfFluxes(const grid &prim,
                             int &numReads, int &numWrites
                            )
+
+    bint fuseFaceFluxes
+    bint hasFusedFaceFluxes()
+    int fluxTileRows
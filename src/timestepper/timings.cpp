@@ -0,0 +1,212 @@
+#include "timings.hpp"
+#include "../params.hpp"
+#include <fstream>
+#include <map>
+#include <vector>
+#include <petsc.h>
+
+namespace
+{
+  struct phase
+  {
+    std::string name;
+    double seconds; /* summed over the steps since the last report */
+  };
+
+  std::vector<phase> phases;
+  std::map<std::string, int> phaseIndex;
+
+  int  numSteps = 0; /* since the last report */
+  long long int lastStep = 0;
+  double lastTime = 0.;
+  bool isLogStarted = false;
+  bool isRestarted  = false;
+
+  struct valueRank
+  {
+    double value;
+    int rank;
+  };
+
+  bool isJSON()
+  {
+    const std::string suffix = ".json";
+    const std::string &fileName = params::timingLogFile;
+    return    fileName.size() >= suffix.size()
+           && fileName.compare(fileName.size() - suffix.size(),
+                               suffix.size(), suffix
+                              ) == 0;
+  }
+
+  /* Truncated by a new run, appended to by a restarted one */
+  void openLog(std::ofstream &log)
+  {
+    bool append = false;
+    if (isRestarted && !isLogStarted)
+    {
+      std::ifstream existing(params::timingLogFile.c_str());
+      append = existing.good() && existing.peek() != EOF;
+    }
+    else if (isLogStarted)
+    {
+      append = true;
+    }
+
+    log.open(params::timingLogFile.c_str(),
+             append ? std::ios::app : std::ios::trunc
+            );
+    log.precision(10);
+    if (!append && !isJSON())
+    {
+      log << "step,time,numSteps,phase,min,max,mean,minRank,maxRank\n";
+    }
+    isLogStarted = true;
+  }
+
+  void report()
+  {
+    const int numPhases = phases.size();
+    if (numSteps == 0 || numPhases == 0)
+    {
+      return;
+    }
+
+    int rank, size;
+    MPI_Comm_rank(PETSC_COMM_WORLD, &rank);
+    MPI_Comm_size(PETSC_COMM_WORLD, &size);
+
+    std::vector<valueRank> local(numPhases), minima(numPhases),
+                           maxima(numPhases);
+    std::vector<double> perStep(numPhases), sums(numPhases);
+    for (int n=0; n<numPhases; n++)
+    {
+      perStep[n] = phases[n].seconds/numSteps;
+      local[n].value = perStep[n];
+      local[n].rank  = rank;
+    }
+    MPI_Reduce(&local[0], &minima[0], numPhases, MPI_DOUBLE_INT, MPI_MINLOC,
+               0, PETSC_COMM_WORLD
+              );
+    MPI_Reduce(&local[0], &maxima[0], numPhases, MPI_DOUBLE_INT, MPI_MAXLOC,
+               0, PETSC_COMM_WORLD
+              );
+    MPI_Reduce(&perStep[0], &sums[0], numPhases, MPI_DOUBLE, MPI_SUM,
+               0, PETSC_COMM_WORLD
+              );
+
+    if (rank == 0)
+    {
+      std::ofstream log;
+      openLog(log);
+      if (isJSON())
+      {
+        log << "{\"step\": " << lastStep << ", \"time\": " << lastTime
+            << ", \"numSteps\": " << numSteps << ", \"phases\": [";
+      }
+      for (int n=0; n<numPhases; n++)
+      {
+        const double mean = sums[n]/size;
+        if (isJSON())
+        {
+          log << (n > 0 ? ", " : "")
+              << "{\"phase\": \"" << phases[n].name << "\""
+              << ", \"min\": "     << minima[n].value
+              << ", \"max\": "     << maxima[n].value
+              << ", \"mean\": "    << mean
+              << ", \"minRank\": " << minima[n].rank
+              << ", \"maxRank\": " << maxima[n].rank << "}";
+        }
+        else
+        {
+          log << lastStep << "," << lastTime << "," << numSteps << ","
+              << phases[n].name << ","
+              << minima[n].value << "," << maxima[n].value << "," << mean
+              << "," << minima[n].rank << "," << maxima[n].rank << "\n";
+        }
+      }
+      if (isJSON())
+      {
+        log << "]}\n";
+      }
+    }
+
+    if (params::printPerformanceReport)
+    {
+      PetscPrintf(PETSC_COMM_WORLD,
+                  "\n   ---Timings over %d procs, per step, last %d steps---\n",
+                  size, numSteps
+                 );
+      PetscPrintf(PETSC_COMM_WORLD,
+                  "     %-34s %10s %10s %10s %6s\n",
+                  "Phase", "min", "mean", "max", "rank"
+                 );
+      for (int n=0; n<numPhases; n++)
+      {
+        PetscPrintf(PETSC_COMM_WORLD,
+                    "     %-34s %10.4g %10.4g %10.4g %6d\n",
+                    phases[n].name.c_str(), minima[n].value, sums[n]/size,
+                    maxima[n].value, maxima[n].rank
+                   );
+      }
+    }
+
+    for (int n=0; n<numPhases; n++)
+    {
+      phases[n].seconds = 0.;
+    }
+    numSteps = 0;
+  }
+}
+
+void timings::record(const std::string phaseName, const double seconds)
+{
+  if (params::timingReportEveryNSteps <= 0)
+  {
+    return;
+  }
+
+  std::map<std::string, int>::iterator found = phaseIndex.find(phaseName);
+  if (found == phaseIndex.end())
+  {
+    phase newPhase;
+    newPhase.name    = phaseName;
+    newPhase.seconds = 0.;
+    found = phaseIndex.insert(std::make_pair(phaseName,
+                                             (int)phases.size()
+                                            )
+                             ).first;
+    phases.push_back(newPhase);
+  }
+  phases[found->second].seconds += seconds;
+}
+
+void timings::endStep(const long long int step, const double time)
+{
+  if (params::timingReportEveryNSteps <= 0)
+  {
+    return;
+  }
+
+  numSteps++;
+  lastStep = step;
+  lastTime = time;
+  if (step % params::timingReportEveryNSteps == 0)
+  {
+    report();
+  }
+}
+
+void timings::setRestarted(const bool restarted)
+{
+  isRestarted = restarted;
+}
+
+void timings::finalize()
+{
+  if (params::timingReportEveryNSteps <= 0)
+  {
+    return;
+  }
+
+  report();
+}
@@ -0,0 +1,39 @@
+#ifndef GRIM_TIMINGS_H_
+#define GRIM_TIMINGS_H_
+
+#include <string>
+
+/* Registry of the wall clock time spent in every phase of the time step, on
+ * every rank. The times recorded during a step are summed per phase; every
+ * params::timingReportEveryNSteps steps, the time per step of each phase is
+ * reduced over the ranks to its min, max and mean, along with the ranks of
+ * the min and the max, and rank 0 appends them to params::timingLogFile. A
+ * max well above the mean points at a phase that is imbalanced.
+ *
+ * The log is CSV, one line per phase and report:
+ *   step,time,numSteps,phase,min,max,mean,minRank,maxRank
+ * or, if timingLogFile ends with ".json", JSON lines, one object per report
+ * with the phases in the order they were first recorded. A restarted run
+ * appends to the log of the run it continues.
+ *
+ * Every rank must record the same phases, and call endStep() as many times:
+ * the reductions are collective. With timingReportEveryNSteps = 0 nothing is
+ * recorded. */
+namespace timings
+{
+  /* Adds seconds to phase, for the current step */
+  void record(const std::string phase, const double seconds);
+
+  /* Closes a step. Reports when the step count is a multiple of
+   * params::timingReportEveryNSteps */
+  void endStep(const long long int step, const double time);
+
+  /* A restarted run appends to the log instead of truncating it. Set by
+   * the timeStepper when it loads a restart, see timeStepper::restarted */
+  void setRestarted(const bool restarted);
+
+  /* Reports the steps left since the last report. Collective */
+  void finalize();
+}
+
+#endif /* GRIM_TIMINGS_H_ */